@@ -0,0 +1,211 @@
+#include "ActuatorController.h"
+#include <string.h>
+
+ActuatorController::ActuatorController(Callback<void(uint8_t, uint32_t)> apply)
+    : _apply(apply), _thread(osPriorityHigh, 3072) {
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        Channel& ch = _channels[i];
+        ch.head = 0;
+        ch.count = 0;
+        ch.active = false;
+        ch.level = 0;
+        ch.rest_level = 0;
+        ch.end_us = 0;
+    }
+    _clock.start();
+    _thread.start(callback(&_queue, &events::EventQueue::dispatch_forever));
+}
+
+ActuatorController::~ActuatorController() {
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+        _channels[i].timeout.detach();
+    }
+    _queue.break_dispatch();
+    if (_thread.get_state() == Thread::Running) {
+        _thread.join();
+    }
+}
+
+uint64_t ActuatorController::nowUs() const {
+    return (uint64_t)_clock.elapsed_time().count();
+}
+
+void ActuatorController::output(uint8_t channel, uint32_t level) {
+    // 他のコマンドが同じ出力を変更している場合があるため、毎回書き込む
+    _channels[channel].level = level;
+    _apply(channel, level);
+}
+
+void ActuatorController::startStep(uint8_t channel, const ActuatorStep& step, uint64_t start_us) {
+    Channel& ch = _channels[channel];
+    ch.active = true;
+    ch.end_us = start_us + step.duration_us;
+    output(channel, step.level);
+
+    // 終了時刻にTimeoutを張る（既に過ぎていれば即時）
+    typedef void (ActuatorController::*TimeoutHandler)();
+    static const TimeoutHandler handlers[ACTUATOR_COUNT] = {
+        &ActuatorController::onTimeout<ACTUATOR_MIST>, &ActuatorController::onTimeout<ACTUATOR_AIR>,
+        &ActuatorController::onTimeout<ACTUATOR_SSR1>, &ActuatorController::onTimeout<ACTUATOR_SSR2>,
+        &ActuatorController::onTimeout<ACTUATOR_SSR3>, &ActuatorController::onTimeout<ACTUATOR_SSR4>,
+        &ActuatorController::onTimeout<ACTUATOR_RGB1>, &ActuatorController::onTimeout<ACTUATOR_RGB2>,
+        &ActuatorController::onTimeout<ACTUATOR_RGB3>, &ActuatorController::onTimeout<ACTUATOR_RGB4>
+    };
+    uint64_t now_us = nowUs();
+    uint64_t delay_us = ch.end_us > now_us ? ch.end_us - now_us : 0;
+    ch.timeout.attach(callback(this, handlers[channel]), std::chrono::microseconds(delay_us));
+}
+
+bool ActuatorController::enqueue(Channel& ch, const ActuatorStep& step) {
+    if (ch.count >= ACTUATOR_MAX_STEPS) {
+        return false;
+    }
+    ch.steps[(ch.head + ch.count) % ACTUATOR_MAX_STEPS] = step;
+    ch.count++;
+    return true;
+}
+
+void ActuatorController::finish(uint8_t channel) {
+    Channel& ch = _channels[channel];
+    ch.timeout.detach();
+    ch.active = false;
+    ch.head = 0;
+    ch.count = 0;
+    output(channel, ch.rest_level);
+}
+
+bool ActuatorController::setLevel(uint8_t channel, uint32_t level) {
+    if (channel >= ACTUATOR_COUNT) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    _channels[channel].rest_level = level;
+    finish(channel);
+    return true;
+}
+
+bool ActuatorController::setRestLevel(uint8_t channel, uint32_t level) {
+    if (channel >= ACTUATOR_COUNT) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    _channels[channel].rest_level = level;
+    return true;
+}
+
+bool ActuatorController::pulse(uint8_t channel, uint32_t level, uint32_t duration_us, ActuatorPulseMode mode) {
+    if (channel >= ACTUATOR_COUNT || duration_us == 0 || mode >= ACTUATOR_MODE_COUNT) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    Channel& ch = _channels[channel];
+    ActuatorStep step = {level, duration_us};
+    uint64_t now_us = nowUs();
+
+    if (ch.active) {
+        if (mode == ACTUATOR_QUEUE) {
+            return enqueue(ch, step);
+        }
+        if (mode == ACTUATOR_EXTEND && ch.level == level && ch.count == 0) {
+            // 終了時刻を延長（残り時間の方が長ければそのまま）
+            if (now_us + duration_us > ch.end_us) {
+                startStep(channel, step, now_us);
+            }
+            return true;
+        }
+    }
+
+    // 予約を破棄して今から開始
+    ch.head = 0;
+    ch.count = 0;
+    startStep(channel, step, now_us);
+    return true;
+}
+
+bool ActuatorController::sequence(uint8_t channel, const ActuatorStep* steps, uint8_t count, ActuatorPulseMode mode) {
+    if (channel >= ACTUATOR_COUNT || count == 0 || count > ACTUATOR_MAX_STEPS || mode >= ACTUATOR_MODE_COUNT) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (steps[i].duration_us == 0) {
+            return false;
+        }
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    Channel& ch = _channels[channel];
+
+    int first = 0;
+    if (mode == ACTUATOR_QUEUE && ch.active) {
+        if (ch.count + count > ACTUATOR_MAX_STEPS) {
+            return false;
+        }
+    } else {
+        ch.head = 0;
+        ch.count = 0;
+        startStep(channel, steps[0], nowUs());
+        first = 1;
+    }
+    for (int i = first; i < count; i++) {
+        enqueue(ch, steps[i]);
+    }
+    return true;
+}
+
+bool ActuatorController::stop(uint8_t channel) {
+    if (channel >= ACTUATOR_COUNT) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    finish(channel);
+    return true;
+}
+
+bool ActuatorController::getStatus(uint8_t channel, ActuatorStatus& status) const {
+    if (channel >= ACTUATOR_COUNT) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    const Channel& ch = _channels[channel];
+    uint64_t now_us = nowUs();
+    status.level = ch.level;
+    status.rest_level = ch.rest_level;
+    status.active = ch.active;
+    status.remaining_us = (ch.active && ch.end_us > now_us) ? (uint32_t)(ch.end_us - now_us) : 0;
+    status.queued = ch.count;
+    return true;
+}
+
+const char* ActuatorController::getPulseModeName(uint8_t mode) {
+    static const char* const names[ACTUATOR_MODE_COUNT] = {"retrigger", "extend", "queue"};
+    return mode < ACTUATOR_MODE_COUNT ? names[mode] : "unknown";
+}
+
+int ActuatorController::parsePulseMode(const char* name) {
+    for (int i = 0; i < ACTUATOR_MODE_COUNT; i++) {
+        if (strcmp(name, getPulseModeName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ActuatorController::onDeadline(uint8_t channel) {
+    ScopedLock<Mutex> lock(_mutex);
+    Channel& ch = _channels[channel];
+
+    // 割り込み後に延長・再トリガされていれば張り直し済みのTimeoutに任せる
+    if (!ch.active || nowUs() < ch.end_us) {
+        return;
+    }
+
+    if (ch.count > 0) {
+        // 次のパルスは前のパルスの終了時刻から開始（遅れを累積させない）
+        ActuatorStep step = ch.steps[ch.head];
+        ch.head = (ch.head + 1) % ACTUATOR_MAX_STEPS;
+        ch.count--;
+        startStep(channel, step, ch.end_us);
+    } else {
+        ch.active = false;
+        output(channel, ch.rest_level);
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef ACTUATOR_CONTROLLER_H
+#define ACTUATOR_CONTROLLER_H
+
+#include "mbed.h"
+
+// チャンネルごとに予約できるパルスの最大数
+#define ACTUATOR_MAX_STEPS 16
+
+/**
+ * アクチュエータのチャンネル
+ */
+enum ActuatorChannel : uint8_t {
+    ACTUATOR_MIST = 0,      // ミスト（0=OFF, 1=ON）
+    ACTUATOR_AIR,           // エアー（0=OFF, 1=LOW, 2=HIGH）
+    ACTUATOR_SSR1,          // SSR1-4のデューティ比（0-100）
+    ACTUATOR_SSR2,
+    ACTUATOR_SSR3,
+    ACTUATOR_SSR4,
+    ACTUATOR_RGB1,          // RGB LED 1-4の色（0xRRGGBB）
+    ACTUATOR_RGB2,
+    ACTUATOR_RGB3,
+    ACTUATOR_RGB4,
+    ACTUATOR_COUNT
+};
+
+/**
+ * 実行中のパルスに新しいパルスが来たときの扱い
+ */
+enum ActuatorPulseMode : uint8_t {
+    ACTUATOR_RETRIGGER = 0, // 予約を破棄して今から指定時間
+    ACTUATOR_EXTEND,        // 同じレベルなら終了時刻を延長（短くはしない）
+    ACTUATOR_QUEUE,         // 予約の末尾に追加
+    ACTUATOR_MODE_COUNT
+};
+
+/**
+ * パルスの1区間
+ */
+struct ActuatorStep {
+    uint32_t level;
+    uint32_t duration_us;
+};
+
+/**
+ * チャンネルの状態
+ */
+struct ActuatorStatus {
+    uint32_t level;         // 現在の出力レベル
+    uint32_t rest_level;    // パルス終了後に戻るレベル
+    bool active;            // パルス実行中か
+    uint32_t remaining_us;  // 現在のパルスの残り時間
+    uint8_t queued;         // 予約中のパルス数
+};
+
+/**
+ * Timer-driven actuator controller for mist, air and timed SSR/RGB pulses
+ * Each channel runs a queue of timed pulses. A Timeout fires at the end of
+ * the current pulse and a high-priority thread switches the output, so the
+ * pulse length does not depend on the network receive loop. Consecutive
+ * pulses are chained from the previous deadline to avoid drift.
+ */
+class ActuatorController {
+public:
+    /**
+     * Constructor
+     * @param apply 出力を切り替える関数（チャンネル, レベル）。呼び出し元スレッドまたはアクチュエータスレッドから呼ばれる
+     */
+    explicit ActuatorController(Callback<void(uint8_t, uint32_t)> apply);
+    ~ActuatorController();
+
+    /**
+     * Set the steady level (cancels pulses)
+     * @param channel ActuatorChannel
+     * @param level Output level (also used after later pulses end)
+     * @return true if successful, false if failed
+     */
+    bool setLevel(uint8_t channel, uint32_t level);
+
+    /**
+     * Set the level used after pulses end, without changing the output
+     * @param channel ActuatorChannel
+     * @param level Output level after the current and queued pulses
+     * @return true if successful, false if failed
+     */
+    bool setRestLevel(uint8_t channel, uint32_t level);
+
+    /**
+     * Start a pulse
+     * @param channel ActuatorChannel
+     * @param level Output level during the pulse
+     * @param duration_us Pulse length (microseconds, > 0)
+     * @param mode How to combine with a pulse in progress
+     * @return true if successful, false if failed (invalid parameter or queue full)
+     */
+    bool pulse(uint8_t channel, uint32_t level, uint32_t duration_us, ActuatorPulseMode mode);
+
+    /**
+     * Start a pulse sequence
+     * @param channel ActuatorChannel
+     * @param steps Pulses in order
+     * @param count Number of pulses (1-ACTUATOR_MAX_STEPS)
+     * @param mode ACTUATOR_QUEUE appends, otherwise replaces the current pulses
+     * @return true if successful, false if failed
+     */
+    bool sequence(uint8_t channel, const ActuatorStep* steps, uint8_t count, ActuatorPulseMode mode);
+
+    /**
+     * Cancel pulses and return to the steady level
+     * @param channel ActuatorChannel
+     * @return true if successful, false if failed
+     */
+    bool stop(uint8_t channel);
+
+    /**
+     * Get the channel status
+     * @param channel ActuatorChannel
+     * @param status Output status
+     * @return true if successful, false if failed
+     */
+    bool getStatus(uint8_t channel, ActuatorStatus& status) const;
+
+    // パルスモードの名前変換
+    static const char* getPulseModeName(uint8_t mode);
+    static int parsePulseMode(const char* name);  // 不正な名前は-1
+
+private:
+    struct Channel {
+        ActuatorStep steps[ACTUATOR_MAX_STEPS];  // 予約中のパルス（リングバッファ）
+        uint8_t head;
+        uint8_t count;
+        bool active;
+        uint32_t level;
+        uint32_t rest_level;
+        uint64_t end_us;        // 現在のパルスの終了時刻（_clock基準）
+        Timeout timeout;
+    };
+
+    Channel _channels[ACTUATOR_COUNT];
+    Callback<void(uint8_t, uint32_t)> _apply;
+    mutable Mutex _mutex;
+    Timer _clock;
+    events::EventQueue _queue;
+    Thread _thread;
+
+    uint64_t nowUs() const;
+    void output(uint8_t channel, uint32_t level);
+    void startStep(uint8_t channel, const ActuatorStep& step, uint64_t start_us);
+    bool enqueue(Channel& ch, const ActuatorStep& step);
+    void finish(uint8_t channel);
+
+    // Timeout割り込み（チャンネルごとの実体、スレッドへ処理を渡す）
+    template <uint8_t CHANNEL>
+    void onTimeout() {
+        _queue.call(callback(this, &ActuatorController::onDeadline), CHANNEL);
+    }
+    void onDeadline(uint8_t channel);
+};
+
+#endif // ACTUATOR_CONTROLLER_H
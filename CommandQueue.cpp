@@ -0,0 +1,136 @@
+#include "CommandQueue.h"
+#include <string.h>
+
+CommandQueue::CommandQueue(uint16_t capacity, uint16_t command_size)
+    : _capacity(capacity), _command_size(command_size),
+      _slots(new Slot[capacity]), _commands(new char[(size_t)capacity * command_size]),
+      _head(0), _tail(0), _max_depth(0), _queued(0), _dropped(0), _max_wait_us(0) {
+}
+
+CommandQueue::~CommandQueue() {
+    delete[] _slots;
+    delete[] _commands;
+}
+
+bool CommandQueue::push(const char* command, size_t length, const SocketAddress& sender, uint64_t rx_us) {
+    uint32_t head = _head;
+    uint32_t used = head - _tail;
+    if (used >= _capacity || !fits(length)) {
+        _dropped++;
+        return false;
+    }
+
+    uint32_t index = head % _capacity;
+    char* text = _commands + (size_t)index * _command_size;
+    memcpy(text, command, length);
+    text[length] = '\0';
+    _slots[index].sender = sender;
+    _slots[index].rx_us = rx_us;
+
+    // スロットを書き終えてから公開（シングルコアのためコンパイラの並べ替えだけ防ぐ）
+    __asm volatile ("" ::: "memory");
+    _head = head + 1;
+
+    _queued++;
+    if (used + 1 > _max_depth) {
+        _max_depth = used + 1;
+    }
+    return true;
+}
+
+char* CommandQueue::front(SocketAddress& sender, uint64_t& rx_us) {
+    uint32_t tail = _tail;
+    if (_head == tail) {
+        return NULL;
+    }
+    __asm volatile ("" ::: "memory");
+    uint32_t index = tail % _capacity;
+    sender = _slots[index].sender;
+    rx_us = _slots[index].rx_us;
+    return _commands + (size_t)index * _command_size;
+}
+
+uint64_t CommandQueue::frontTime() const {
+    __asm volatile ("" ::: "memory");
+    return _slots[_tail % _capacity].rx_us;
+}
+
+void CommandQueue::pop(uint32_t wait_us) {
+    if (wait_us > _max_wait_us) {
+        _max_wait_us = wait_us;
+    }
+    // スロットを使い終えてから返す
+    __asm volatile ("" ::: "memory");
+    _tail = _tail + 1;
+}
+
+uint16_t CommandQueue::depth() const {
+    return (uint16_t)(_head - _tail);
+}
+
+void CommandQueue::getStats(CommandQueueStats& stats) const {
+    stats.depth = depth();
+    stats.capacity = _capacity;
+    stats.max_depth = _max_depth;
+    stats.queued = _queued;
+    stats.dropped = _dropped;
+    stats.max_wait_us = _max_wait_us;
+}
+
+void CommandQueue::resetStats() {
+    // 統計は表示用のため、受信スレッドの更新と重なっても問題ない
+    _max_depth = depth();
+    _queued = 0;
+    _dropped = 0;
+    _max_wait_us = 0;
+}
+
+CommandLanes::CommandLanes(uint16_t priority_capacity, uint16_t priority_command_size,
+                           uint16_t normal_capacity, uint16_t normal_command_size)
+    : _priority(priority_capacity, priority_command_size), _normal(normal_capacity, normal_command_size),
+      _normal_barrier(0) {
+}
+
+bool CommandLanes::push(const char* command, size_t length, bool priority, const SocketAddress& sender, uint64_t rx_us) {
+    // 優先スロットに収まらない、または通常レーンに先行の優先コマンドが残っている場合は通常レーンへ
+    if (priority && _priority.fits(length) && _normal.reached(_normal_barrier)) {
+        return _priority.push(command, length, sender, rx_us);
+    }
+    if (!_normal.push(command, length, sender, rx_us)) {
+        return false;
+    }
+    if (priority) {
+        _normal_barrier = _normal.pushed();
+    }
+    return true;
+}
+
+CommandQueue* CommandLanes::next() {
+    if (_priority.depth() > 0) {
+        return &_priority;
+    }
+    if (_normal.depth() > 0) {
+        return &_normal;
+    }
+    return NULL;
+}
+
+CommandQueue* CommandLanes::next(CommandLanes& a, CommandLanes& b) {
+    CommandQueue* lanes[2][2] = {{&a._priority, &b._priority}, {&a._normal, &b._normal}};
+    for (int i = 0; i < 2; i++) {
+        CommandQueue* x = lanes[i][0];
+        CommandQueue* y = lanes[i][1];
+        if (x->depth() == 0) {
+            if (y->depth() > 0) {
+                return y;
+            }
+            continue;
+        }
+        if (y->depth() == 0) {
+            return x;
+        }
+        // 同じ種類のレーン同士は受信順
+        return (int64_t)(y->frontTime() - x->frontTime()) < 0 ? y : x;
+    }
+    return NULL;
+}
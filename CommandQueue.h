@@ -0,0 +1,138 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include "mbed.h"
+#include "netsocket/SocketAddress.h"
+
+/**
+ * キューの統計
+ */
+struct CommandQueueStats {
+    uint16_t depth;         // 現在のコマンド数
+    uint16_t capacity;      // 容量
+    uint16_t max_depth;     // 最大のコマンド数
+    uint32_t queued;        // 受け付けたコマンド
+    uint32_t dropped;       // 満杯で破棄したコマンド
+    uint32_t max_wait_us;   // 受信から実行開始までの最大待ち時間
+};
+
+/**
+ * Bounded single-producer / single-consumer command queue
+ * The UDP receive thread pushes received commands and the executor thread
+ * takes them in order. Slots are allocated once at construction; the two
+ * threads only share the head and tail counters (each written by one side),
+ * so no lock is needed. A full queue rejects the new command instead of
+ * blocking the receiver.
+ */
+class CommandQueue {
+public:
+    /**
+     * Constructor
+     * @param capacity Number of slots
+     * @param command_size Maximum command length including the terminator
+     */
+    CommandQueue(uint16_t capacity, uint16_t command_size);
+    ~CommandQueue();
+
+    /**
+     * Append a command (receive thread only)
+     * @param command Command text
+     * @param length Command length
+     * @param sender Sender address
+     * @param rx_us Receive time (local time)
+     * @return true if queued, false if the queue is full or the command does not fit
+     */
+    bool push(const char* command, size_t length, const SocketAddress& sender, uint64_t rx_us);
+
+    /**
+     * Oldest command (executor thread only)
+     * The slot stays valid and writable until pop().
+     * @return Command text, or NULL if the queue is empty
+     */
+    char* front(SocketAddress& sender, uint64_t& rx_us);
+
+    /**
+     * Receive time of the oldest command (executor thread only, queue must not be empty)
+     */
+    uint64_t frontTime() const;
+
+    /**
+     * Release the oldest command (executor thread only)
+     * @param wait_us Time from reception to the start of execution
+     */
+    void pop(uint32_t wait_us);
+
+    bool fits(size_t length) const { return length < _command_size; }
+    uint16_t depth() const;
+
+    // 通し番号による実行順の判定（pushed: これまでに追加した件数、reached: count件目までpop済みか）
+    uint32_t pushed() const { return _head; }
+    bool reached(uint32_t count) const { return (int32_t)(_tail - count) >= 0; }
+
+    void getStats(CommandQueueStats& stats) const;
+    void resetStats();
+
+private:
+    struct Slot {
+        SocketAddress sender;
+        uint64_t rx_us;
+    };
+
+    const uint16_t _capacity;
+    const uint16_t _command_size;
+    Slot* _slots;
+    char* _commands;            // _capacity × _command_size
+
+    volatile uint32_t _head;    // 書き込み位置（受信スレッドのみ更新）
+    volatile uint32_t _tail;    // 読み出し位置（実行スレッドのみ更新）
+
+    uint16_t _max_depth;
+    uint32_t _queued;
+    uint32_t _dropped;
+    uint32_t _max_wait_us;
+};
+
+/**
+ * Priority / normal lane pair
+ * The executor empties the priority lane before taking one normal command.
+ * A priority command too long for a priority slot is queued in the normal
+ * lane instead; until it has been executed, later priority commands follow
+ * it into the normal lane, so commands keep their arrival order
+ * (e.g. "wave 1,load,..." is never overtaken by the next "wave 1,play").
+ */
+class CommandLanes {
+public:
+    CommandLanes(uint16_t priority_capacity, uint16_t priority_command_size,
+                 uint16_t normal_capacity, uint16_t normal_command_size);
+
+    /**
+     * Append a command (receive thread only)
+     * @param priority true for a priority command
+     * @return true if queued, false if the lane is full or the command does not fit
+     */
+    bool push(const char* command, size_t length, bool priority, const SocketAddress& sender, uint64_t rx_us);
+
+    /**
+     * Lane to execute next (executor thread only)
+     * @return Priority lane if not empty, then the normal lane, or NULL if both are empty
+     */
+    CommandQueue* next();
+
+    /**
+     * Lane to execute next across two lane pairs (executor thread only)
+     * Priority lanes come first; between the pairs, the command received first runs first.
+     * @return Lane to execute, or NULL if all lanes are empty
+     */
+    static CommandQueue* next(CommandLanes& a, CommandLanes& b);
+
+    CommandQueue& priority() { return _priority; }
+    CommandQueue& normal() { return _normal; }
+    bool contains(const CommandQueue* queue) const { return queue == &_priority || queue == &_normal; }
+
+private:
+    CommandQueue _priority;
+    CommandQueue _normal;
+    uint32_t _normal_barrier;   // 通常レーンに入れた最後の優先コマンドの通し番号（実行まで優先レーンを使わない）
+};
+
+#endif // COMMAND_QUEUE_H
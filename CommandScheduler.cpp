@@ -0,0 +1,254 @@
+#include "CommandScheduler.h"
+#include <string.h>
+
+CommandScheduler::CommandScheduler(const TimeSync& time, SSRDriver& ssr_driver, Callback<void(const char*)> executor,
+                                   Mutex& executor_lock)
+    : _count(0), _free_count(SCHED_MAX_ENTRIES), _order(0), _policy(SCHED_LATE_RUN),
+      _tolerance_us(SCHED_DEFAULT_TOLERANCE_US), _executed(0), _late(0), _dropped(0), _max_late_us(0),
+      _time(time), _ssr_driver(ssr_driver), _executor(executor), _executor_lock(executor_lock),
+      _thread(osPriorityAboveNormal, 6144) {
+    for (int i = 0; i < SCHED_MAX_ENTRIES; i++) {
+        _free[i] = (uint8_t)i;
+    }
+    _thread.start(callback(this, &CommandScheduler::threadFunc));
+}
+
+CommandScheduler::~CommandScheduler() {
+    _timeout.detach();
+    _flags.set(SCHED_FLAG_EXIT);
+    if (_thread.get_state() == Thread::Running) {
+        _thread.join();
+    }
+}
+
+bool CommandScheduler::resolve(uint8_t base, uint64_t target, uint64_t now_us, uint64_t& due_us) const {
+    if (base == SCHED_DEVICE_TIME) {
+        due_us = _time.toLocal(target);
+        return true;
+    }
+
+    // 現在の半周期の開始から半周期長ずつ進めて目的の半周期の開始を予測
+    uint32_t index, elapsed_us, half_cycle_us;
+    if (!_ssr_driver.getHalfCycleTiming(index, elapsed_us, half_cycle_us)) {
+        return false;
+    }
+    int32_t ahead = (int32_t)((uint32_t)target - index);
+    int64_t start_us = (int64_t)(now_us - elapsed_us) + (int64_t)ahead * half_cycle_us;
+    due_us = (uint64_t)(start_us - SCHED_ZC_LEAD_US);
+    return true;
+}
+
+bool CommandScheduler::earlier(uint8_t a, uint8_t b) const {
+    const Entry& ea = _entries[a];
+    const Entry& eb = _entries[b];
+    if (ea.due_us != eb.due_us) {
+        return ea.due_us < eb.due_us;
+    }
+    return (int32_t)(ea.order - eb.order) < 0;
+}
+
+void CommandScheduler::siftUp(uint16_t pos) {
+    while (pos > 0) {
+        uint16_t parent = (pos - 1) / 2;
+        if (!earlier(_heap[pos], _heap[parent])) {
+            break;
+        }
+        uint8_t tmp = _heap[pos];
+        _heap[pos] = _heap[parent];
+        _heap[parent] = tmp;
+        pos = parent;
+    }
+}
+
+void CommandScheduler::siftDown(uint16_t pos) {
+    for (;;) {
+        uint16_t smallest = pos;
+        uint16_t left = pos * 2 + 1;
+        uint16_t right = left + 1;
+        if (left < _count && earlier(_heap[left], _heap[smallest])) {
+            smallest = left;
+        }
+        if (right < _count && earlier(_heap[right], _heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        uint8_t tmp = _heap[pos];
+        _heap[pos] = _heap[smallest];
+        _heap[smallest] = tmp;
+        pos = smallest;
+    }
+}
+
+uint8_t CommandScheduler::push(uint8_t base, uint64_t target, uint64_t due_us, bool late, const char* command, size_t length) {
+    uint8_t slot = _free[--_free_count];
+    Entry& e = _entries[slot];
+    e.due_us = due_us;
+    e.target = target;
+    e.order = _order++;
+    e.base = base;
+    e.late = late;
+    memcpy(e.command, command, length + 1);
+    _heap[_count] = slot;
+    siftUp(_count);
+    _count++;
+    return slot;
+}
+
+SchedResult CommandScheduler::schedule(uint8_t base, uint64_t target, const char* command, int64_t& lead_us) {
+    lead_us = 0;
+    size_t length = strlen(command);
+    if (base > SCHED_HALF_CYCLE || length == 0 || length >= SCHED_COMMAND_MAX) {
+        return SCHED_RESULT_INVALID;
+    }
+
+    ScopedLock<Mutex> lock(_mutex);
+    uint64_t now_us = TimeSync::localUs();
+    uint64_t due_us;
+    if (!resolve(base, target, now_us, due_us)) {
+        return SCHED_RESULT_INVALID;
+    }
+    lead_us = (int64_t)(due_us - now_us);
+    if (lead_us > (int64_t)SCHED_MAX_AHEAD_US) {
+        return SCHED_RESULT_INVALID;
+    }
+    if (_free_count == 0) {
+        return SCHED_RESULT_FULL;
+    }
+
+    SchedResult result = SCHED_RESULT_QUEUED;
+    if (lead_us < -(int64_t)_tolerance_us) {
+        if (_policy == SCHED_LATE_DROP) {
+            _dropped++;
+            return SCHED_RESULT_DROPPED;
+        }
+        // 今の時刻で予約し直して即時実行
+        _late++;
+        base = SCHED_DEVICE_TIME;
+        target = _time.toDevice(now_us);
+        due_us = now_us;
+        result = SCHED_RESULT_LATE;
+    }
+
+    // 先頭になった場合はスレッドを起こしてTimeoutを張り直す
+    if (push(base, target, due_us, result == SCHED_RESULT_LATE, command, length) == _heap[0]) {
+        _flags.set(SCHED_FLAG_WAKE);
+    }
+    return result;
+}
+
+void CommandScheduler::clear() {
+    ScopedLock<Mutex> lock(_mutex);
+    _timeout.detach();
+    while (_count > 0) {
+        _free[_free_count++] = _heap[--_count];
+    }
+}
+
+bool CommandScheduler::setLatePolicy(uint8_t policy, uint32_t tolerance_us) {
+    if (policy >= SCHED_LATE_POLICY_COUNT) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    _policy = policy;
+    _tolerance_us = tolerance_us;
+    return true;
+}
+
+void CommandScheduler::getStatus(SchedStatus& status) const {
+    ScopedLock<Mutex> lock(_mutex);
+    status.pending = _count;
+    status.executed = _executed;
+    status.late = _late;
+    status.dropped = _dropped;
+    status.max_late_us = _max_late_us;
+    status.policy = _policy;
+    status.tolerance_us = _tolerance_us;
+}
+
+const char* CommandScheduler::getLatePolicyName(uint8_t policy) {
+    static const char* const names[SCHED_LATE_POLICY_COUNT] = {"run", "drop"};
+    return policy < SCHED_LATE_POLICY_COUNT ? names[policy] : "unknown";
+}
+
+int CommandScheduler::parseLatePolicy(const char* name) {
+    for (int i = 0; i < SCHED_LATE_POLICY_COUNT; i++) {
+        if (strcmp(name, getLatePolicyName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void CommandScheduler::onTimeout() {
+    // 割り込みコンテキスト: スレッドを起こすだけ
+    _flags.set(SCHED_FLAG_WAKE);
+}
+
+void CommandScheduler::threadFunc() {
+    for (;;) {
+        uint32_t flags = _flags.wait_any(SCHED_FLAG_WAKE | SCHED_FLAG_EXIT);
+        if (flags & osFlagsError) {
+            continue;
+        }
+        if (flags & SCHED_FLAG_EXIT) {
+            break;
+        }
+
+        // 期限に達したコマンドを順に実行し、次のコマンドの時刻にTimeoutを張る
+        for (;;) {
+            char command[SCHED_COMMAND_MAX];
+            // 実行の排他を先に取得し、取得後の時刻で期限と遅れを判定する
+            // （実行中のコマンドを待って期限を過ぎた場合も遅延時の扱いに従う）
+            ScopedLock<Mutex> executor_lock(_executor_lock);
+            {
+                ScopedLock<Mutex> lock(_mutex);
+                if (_count == 0) {
+                    _timeout.detach();
+                    break;
+                }
+                uint8_t slot = _heap[0];
+                Entry& e = _entries[slot];
+                uint64_t now_us = TimeSync::localUs();
+
+                // 予約後のデバイス時刻の補正・電源周期の変化を反映（遅くなった場合は並べ直す）
+                uint64_t due_us;
+                int64_t shift_us = resolve(e.base, e.target, now_us, due_us) ? (int64_t)(due_us - e.due_us) : 0;
+                if (shift_us > SCHED_RESOLVE_SLACK_US || shift_us < -SCHED_RESOLVE_SLACK_US) {
+                    e.due_us = due_us;
+                    if (shift_us > 0) {
+                        siftDown(0);
+                        continue;
+                    }
+                }
+                if (now_us < e.due_us) {
+                    _timeout.attach(callback(this, &CommandScheduler::onTimeout),
+                                    std::chrono::microseconds(e.due_us - now_us));
+                    break;
+                }
+
+                uint64_t late_us = now_us - e.due_us;
+                bool late = !e.late && late_us > _tolerance_us;
+                memcpy(command, e.command, SCHED_COMMAND_MAX);
+                _heap[0] = _heap[--_count];
+                _free[_free_count++] = slot;
+                siftDown(0);
+                if (late && _policy == SCHED_LATE_DROP) {
+                    _dropped++;
+                    continue;
+                }
+                if (late) {
+                    _late++;
+                }
+                if (late_us > _max_late_us) {
+                    _max_late_us = late_us > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)late_us;
+                }
+                _executed++;
+            }
+
+            // コマンドの実行中は_mutexを保持しない（実行中の予約・状態取得を待たせない）
+            _executor(command);
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef COMMAND_SCHEDULER_H
+#define COMMAND_SCHEDULER_H
+
+#include "mbed.h"
+#include "TimeSync.h"
+#include "SSRDriver.h"
+
+// 予約できるコマンド数とコマンド長
+#define SCHED_MAX_ENTRIES 64
+#define SCHED_COMMAND_MAX 64
+// 半周期指定のコマンドは半周期の開始よりこれだけ前に実行（デューティ変更をその半周期に間に合わせる）
+#ifndef SCHED_ZC_LEAD_US
+#define SCHED_ZC_LEAD_US 1500
+#endif
+// 実行前に時刻を求め直したときに、これ以下のずれは無視（読み出しタイミングによる揺れ）
+#define SCHED_RESOLVE_SLACK_US 50
+// これより先の時刻は時刻基準の誤りとして受け付けない
+#define SCHED_MAX_AHEAD_US 600000000ULL
+// 遅れの許容値の初期値（これ以内の遅れは遅延扱いにせず即時実行）
+#define SCHED_DEFAULT_TOLERANCE_US 2000
+
+/**
+ * 実行時刻の基準
+ */
+enum SchedTimeBase : uint8_t {
+    SCHED_DEVICE_TIME = 0,  // デバイス時刻（マイクロ秒）
+    SCHED_HALF_CYCLE        // 半周期番号（その半周期の開始に合わせる）
+};
+
+/**
+ * 期限を過ぎて届いたコマンドの扱い
+ */
+enum SchedLatePolicy : uint8_t {
+    SCHED_LATE_RUN = 0,     // 即時実行して遅延として記録
+    SCHED_LATE_DROP,        // 破棄
+    SCHED_LATE_POLICY_COUNT
+};
+
+/**
+ * 予約の結果
+ */
+enum SchedResult : uint8_t {
+    SCHED_RESULT_QUEUED = 0,    // 予約した（許容範囲内の遅れは即時実行）
+    SCHED_RESULT_LATE,          // 遅れて届いたため即時実行
+    SCHED_RESULT_DROPPED,       // 遅れて届いたため破棄
+    SCHED_RESULT_FULL,          // 予約が満杯
+    SCHED_RESULT_INVALID        // 時刻・コマンドが不正（ゼロクロス未検出を含む）
+};
+
+/**
+ * スケジューラの状態
+ */
+struct SchedStatus {
+    uint16_t pending;       // 実行待ちのコマンド数
+    uint32_t executed;      // 実行したコマンド数
+    uint32_t late;          // 遅れて届いた・実行が遅れたため遅延として実行したコマンド数
+    uint32_t dropped;       // 遅れて届いた・実行が遅れたため破棄したコマンド数
+    uint32_t max_late_us;   // 予定時刻から実行開始（排他の取得後）までの最大遅れ（予約したコマンド）
+    uint8_t policy;         // SchedLatePolicy
+    uint32_t tolerance_us;
+};
+
+/**
+ * Execute-at command scheduler
+ * Commands carrying a device time or a half-cycle index are kept in a
+ * min-heap ordered by their local due time. A Timeout armed for the earliest
+ * entry wakes a dedicated thread, which re-resolves the due time (the device
+ * clock may have been slewed and the mains period may have changed) and runs
+ * the command through the executor, so network jitter does not reach the
+ * actuation time.
+ */
+class CommandScheduler {
+public:
+    /**
+     * Constructor
+     * @param time デバイス時刻
+     * @param ssr_driver 半周期番号の取得に使用
+     * @param executor コマンドを実行する関数（スケジューラスレッドから呼ばれる）
+     * @param executor_lock 実行の排他（取得してから期限を判定して実行する）
+     */
+    CommandScheduler(const TimeSync& time, SSRDriver& ssr_driver, Callback<void(const char*)> executor,
+                     Mutex& executor_lock);
+    ~CommandScheduler();
+
+    /**
+     * Schedule a command
+     * @param base SchedTimeBase
+     * @param target Device time (us) or half-cycle index
+     * @param command Command to execute
+     * @param lead_us Output: time until the due time (negative if late)
+     * @return SchedResult
+     */
+    SchedResult schedule(uint8_t base, uint64_t target, const char* command, int64_t& lead_us);
+
+    /**
+     * Remove all pending commands
+     */
+    void clear();
+
+    /**
+     * Set how late commands are handled
+     * @param policy SchedLatePolicy
+     * @param tolerance_us Lateness treated as on time
+     * @return true if successful, false if the policy is invalid
+     */
+    bool setLatePolicy(uint8_t policy, uint32_t tolerance_us);
+
+    /**
+     * Get the scheduler status
+     * @param status Output status
+     */
+    void getStatus(SchedStatus& status) const;
+
+    // 遅延時の扱いの名前変換
+    static const char* getLatePolicyName(uint8_t policy);
+    static int parseLatePolicy(const char* name);  // 不正な名前は-1
+
+private:
+    struct Entry {
+        uint64_t due_us;        // 実行時刻（ローカル時刻）
+        uint64_t target;
+        uint32_t order;         // 同じ時刻は予約順
+        uint8_t base;
+        bool late;              // 遅れて届き、今の時刻で予約し直した（遅延として計上済み）
+        char command[SCHED_COMMAND_MAX];
+    };
+
+    // スレッドフラグ
+    static const uint32_t SCHED_FLAG_WAKE = 0x01;
+    static const uint32_t SCHED_FLAG_EXIT = 0x02;
+
+    Entry _entries[SCHED_MAX_ENTRIES];
+    uint8_t _heap[SCHED_MAX_ENTRIES];   // _entriesの添字の二分ヒープ（先頭が最も早い）
+    uint8_t _free[SCHED_MAX_ENTRIES];   // 空きエントリの添字
+    uint16_t _count;
+    uint16_t _free_count;
+    uint32_t _order;
+
+    uint8_t _policy;
+    uint32_t _tolerance_us;
+    uint32_t _executed;
+    uint32_t _late;
+    uint32_t _dropped;
+    uint32_t _max_late_us;
+
+    const TimeSync& _time;
+    SSRDriver& _ssr_driver;
+    Callback<void(const char*)> _executor;
+    Mutex& _executor_lock;
+    mutable Mutex _mutex;        // ヒープと統計を保護（コマンド実行中は保持しない）
+    Timeout _timeout;
+    EventFlags _flags;
+    Thread _thread;
+
+    bool resolve(uint8_t base, uint64_t target, uint64_t now_us, uint64_t& due_us) const;
+    bool earlier(uint8_t a, uint8_t b) const;
+    void siftUp(uint16_t pos);
+    void siftDown(uint16_t pos);
+    uint8_t push(uint8_t base, uint64_t target, uint64_t due_us, bool late, const char* command, size_t length);
+    void threadFunc();
+    void onTimeout();
+};
+
+#endif // COMMAND_SCHEDULER_H
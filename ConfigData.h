@@ -33,6 +33,20 @@ struct ConfigData {
 
     // 16バイトのメンバー
     char netbios_name[16];          // NETBIOS名（最大15文字 + 終端文字）
+
+    // SSR→LEDリンクマトリクス（旧データとの互換のため末尾に追加し、読み込み時に個別検証）
+    uint8_t link_matrix_magic;          // LINK_MATRIX_MAGICのとき以下が有効
+    uint8_t link_source[7];             // 出力先ごとの連動元（bit0-3: SSR番号 0=なし/1-4, bit4-7: カーブ）
+                                        // 出力先: 0-3=RGB LED1-4, 4-6=WS2812系統1-3
+    RGBColorData ws2812_link_colors_0[3];   // 0%時の色（WS2812系統1-3）
+    RGBColorData ws2812_link_colors_100[3]; // 100%時の色（WS2812系統1-3）
+
+    // マルチキャスト（旧データとの互換のため末尾に追加し、読み込み時に個別検証）
+    uint8_t multicast_magic;            // MULTICAST_MAGICのとき以下が有効
+    uint8_t unit_index;                 // ユニット番号（0-254、UNIT_INDEX_NONE=未設定）
+    uint16_t multicast_port;            // マルチキャスト受信ポート
+    uint32_t multicast_groups[2];       // 参加するグループ（ネットワークバイトオーダー、0=なし）
+                                        // 0=全台共通（fleet）、1=ユニット個別（zone）
 };
 
 #endif 
\ No newline at end of file
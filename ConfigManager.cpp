@@ -12,6 +12,9 @@ char ConfigManager::_ip_buffer[16];
 char ConfigManager::_netmask_buffer[16];
 char ConfigManager::_gateway_buffer[16];
 
+// 93C46は64ワード。設定はEEPROM_CONFIG_ADDRワード目から末尾までに収める
+static_assert(sizeof(ConfigData) <= (64 - EEPROM_CONFIG_ADDR) * 2, "ConfigData does not fit in the EEPROM");
+
 ConfigManager::ConfigManager() {
     // まずEEPROMから設定を読み込む
     if (!loadConfig(true)) {
@@ -29,11 +32,7 @@ bool ConfigManager::loadConfig(bool create_if_not_exist) {
     log_printf(LOG_LEVEL_DEBUG, "Loading configuration from EEPROM...");
     _used_default = false;
     
-    // ワード単位（16ビット）でサイズを計算
-    const size_t config_size_words = (sizeof(_data) + 1) / 2;  // バイト数を2で割って切り上げ
-    log_printf(LOG_LEVEL_DEBUG, "Config size: %d bytes (%d words)", sizeof(_data), config_size_words);
-    
-    if (!_eeprom.read_data(EEPROM_CONFIG_ADDR, (uint8_t*)&_data, config_size_words * 2)) {
+    if (!readConfig(_data)) {
         log_printf(LOG_LEVEL_ERROR, "Failed to read from EEPROM");
         if (create_if_not_exist) {
             log_printf(LOG_LEVEL_INFO, "Creating default configuration...");
@@ -44,6 +43,25 @@ bool ConfigManager::loadConfig(bool create_if_not_exist) {
         return false;
     }
     log_printf(LOG_LEVEL_DEBUG, "Successfully read from EEPROM");
+    return validateConfig(create_if_not_exist);
+}
+
+bool ConfigManager::loadConfig(const ConfigData& data) {
+    _used_default = false;
+    _data = data;
+    return validateConfig(false);
+}
+
+bool ConfigManager::readConfig(ConfigData& data) {
+    ScopedLock<Mutex> lock(_eeprom_mutex);
+    // ワード単位（16ビット）でサイズを計算
+    const size_t config_size_words = (sizeof(data) + 1) / 2;  // バイト数を2で割って切り上げ
+    log_printf(LOG_LEVEL_DEBUG, "Config size: %d bytes (%d words)", sizeof(data), config_size_words);
+    return _eeprom.read_data(EEPROM_CONFIG_ADDR, (uint8_t*)&data, config_size_words * 2);
+}
+
+bool ConfigManager::validateConfig(bool create_if_not_exist) {
+    _link_revision++;  // 読み込んだ色・リンク設定で補間テーブルを作り直す
 
     // 全バイトが0または0xFFなら異常値とみなす
     bool all_zero = true, all_ff = true;
@@ -168,14 +186,38 @@ bool ConfigManager::loadConfig(bool create_if_not_exist) {
         return false;
     }
 
+    // リンクマトリクスのバリデーション
+    // 追加前の設定には存在しないため、不正な場合は他の設定を残したまま既定値を補う
+    if (!validateLinkMatrix()) {
+        log_printf(LOG_LEVEL_INFO, "Link matrix not found, using default (RGB LED1-4 follow SSR1)");
+        setDefaultLinkMatrix();
+        if (create_if_not_exist) {
+            saveConfig();
+        }
+    }
+
+    // マルチキャスト設定のバリデーション（リンクマトリクスと同様に後から追加した項目）
+    if (!validateMulticast()) {
+        log_printf(LOG_LEVEL_INFO, "Multicast settings not found, using default (no groups, port %d)", DEFAULT_MULTICAST_PORT);
+        setDefaultMulticast();
+        if (create_if_not_exist) {
+            saveConfig();
+        }
+    }
+
     log_printf(LOG_LEVEL_DEBUG, "Configuration validation completed successfully");
     return true;
 }
 
 bool ConfigManager::saveConfig() {
+    return writeConfig(_data);
+}
+
+bool ConfigManager::writeConfig(const ConfigData& data) {
+    ScopedLock<Mutex> lock(_eeprom_mutex);
     // ワード単位（16ビット）でサイズを計算
-    const size_t config_size_words = (sizeof(_data) + 1) / 2;  // バイト数を2で割って切り上げ
-    return _eeprom.write_data(EEPROM_CONFIG_ADDR, (const uint8_t*)&_data, config_size_words * 2);
+    const size_t config_size_words = (sizeof(data) + 1) / 2;  // バイト数を2で割って切り上げ
+    return _eeprom.write_data(EEPROM_CONFIG_ADDR, (const uint8_t*)&data, config_size_words * 2);
 }
 
 void ConfigManager::createDefaultConfig() {
@@ -225,6 +267,12 @@ void ConfigManager::createDefaultConfig() {
     // ランダムRGBアイドル（10秒単位）。デフォルト: 3 (=30秒) に設定
     _data.random_rgb_timeout_10s = 3;
     
+    // リンクマトリクス
+    setDefaultLinkMatrix();
+
+    // マルチキャスト
+    setDefaultMulticast();
+    
     // 設定を保存
     saveConfig();
 }
@@ -303,6 +351,7 @@ void ConfigManager::setSSRLinkColor0(int led_id, uint8_t r, uint8_t g, uint8_t b
         _data.ssr_link_colors_0[led_id-1].r = r;
         _data.ssr_link_colors_0[led_id-1].g = g;
         _data.ssr_link_colors_0[led_id-1].b = b;
+        _link_revision++;
     }
 }
 
@@ -311,6 +360,7 @@ void ConfigManager::setSSRLinkColor100(int led_id, uint8_t r, uint8_t g, uint8_t
         _data.ssr_link_colors_100[led_id-1].r = r;
         _data.ssr_link_colors_100[led_id-1].g = g;
         _data.ssr_link_colors_100[led_id-1].b = b;
+        _link_revision++;
     }
 }
 
@@ -346,6 +396,208 @@ RGBColorData ConfigManager::calculateLEDColorForSSR(int led_id, int duty) const
             return result;
         }
 
+void ConfigManager::setDefaultLinkMatrix() {
+    // 従来の動作: RGB LED1-4がSSR1に線形で連動、WS2812は連動なし
+    _data.link_matrix_magic = LINK_MATRIX_MAGIC;
+    for (int i = 0; i < SSR_LINK_TARGETS; i++) {
+        _data.link_source[i] = (i < SSR_LINK_TARGET_WS2812) ? 1 : 0;
+    }
+    for (int i = 0; i < 3; i++) {
+        _data.ws2812_link_colors_0[i] = {0, 0, 255};
+        _data.ws2812_link_colors_100[i] = {255, 0, 0};
+    }
+    _link_revision++;
+}
+
+bool ConfigManager::validateLinkMatrix() const {
+    if (_data.link_matrix_magic != LINK_MATRIX_MAGIC) {
+        return false;
+    }
+    for (int i = 0; i < SSR_LINK_TARGETS; i++) {
+        if ((_data.link_source[i] & 0x0F) > 4 || (_data.link_source[i] >> 4) >= SSR_LINK_CURVE_COUNT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConfigManager::setDefaultMulticast() {
+    // グループには参加せず、ユニット番号も未設定（従来どおりユニキャストのみ）
+    _data.multicast_magic = MULTICAST_MAGIC;
+    _data.unit_index = UNIT_INDEX_NONE;
+    _data.multicast_port = DEFAULT_MULTICAST_PORT;
+    for (int i = 0; i < MULTICAST_GROUPS; i++) {
+        _data.multicast_groups[i] = 0;
+    }
+}
+
+static bool isMulticastAddress(uint32_t addr) {
+    // 224.0.0.0/4（ネットワークバイトオーダー）
+    return (ntohl(addr) & 0xF0000000UL) == 0xE0000000UL;
+}
+
+bool ConfigManager::validateMulticast() const {
+    if (_data.multicast_magic != MULTICAST_MAGIC || _data.multicast_port == 0) {
+        return false;
+    }
+    for (int i = 0; i < MULTICAST_GROUPS; i++) {
+        if (_data.multicast_groups[i] != 0 && !isMulticastAddress(_data.multicast_groups[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConfigManager::setUnitIndex(int index) {
+    if (index < -1 || index >= UNIT_INDEX_NONE) {
+        return false;
+    }
+    _data.unit_index = index < 0 ? UNIT_INDEX_NONE : (uint8_t)index;
+    return true;
+}
+
+uint32_t ConfigManager::getMulticastGroup(int group) const {
+    if (group < 0 || group >= MULTICAST_GROUPS) {
+        return 0;
+    }
+    return _data.multicast_groups[group];
+}
+
+bool ConfigManager::setMulticastGroup(int group, const char* ip) {
+    if (group < 0 || group >= MULTICAST_GROUPS) {
+        return false;
+    }
+    if (strcmp(ip, "off") == 0) {
+        _data.multicast_groups[group] = 0;
+        return true;
+    }
+    ip4_addr_t addr;
+    if (!ip4addr_aton(ip, &addr) || !isMulticastAddress(addr.addr)) {
+        return false;
+    }
+    _data.multicast_groups[group] = addr.addr;
+    return true;
+}
+
+bool ConfigManager::setMulticastPort(int port) {
+    if (port < 1 || port > 65535) {
+        return false;
+    }
+    _data.multicast_port = (uint16_t)port;
+    return true;
+}
+
+const char* ConfigManager::getMulticastGroupName(int group) {
+    static const char* const names[MULTICAST_GROUPS] = {"fleet", "zone"};
+    return (group >= 0 && group < MULTICAST_GROUPS) ? names[group] : "unknown";
+}
+
+int ConfigManager::parseMulticastGroup(const char* name) {
+    for (int i = 0; i < MULTICAST_GROUPS; i++) {
+        if (strcmp(name, getMulticastGroupName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ConfigManager::setSSRLinkSource(int target, uint8_t ssr_id, uint8_t curve) {
+    if (target < 0 || target >= SSR_LINK_TARGETS || ssr_id > 4 || curve >= SSR_LINK_CURVE_COUNT) {
+        return false;
+    }
+    _data.link_source[target] = (uint8_t)((curve << 4) | ssr_id);
+    _link_revision++;
+    return true;
+}
+
+uint8_t ConfigManager::getSSRLinkSource(int target) const {
+    if (target < 0 || target >= SSR_LINK_TARGETS) {
+        return 0;
+    }
+    return _data.link_source[target] & 0x0F;
+}
+
+uint8_t ConfigManager::getSSRLinkCurve(int target) const {
+    if (target < 0 || target >= SSR_LINK_TARGETS) {
+        return SSR_LINK_CURVE_LINEAR;
+    }
+    return _data.link_source[target] >> 4;
+}
+
+bool ConfigManager::setSSRLinkTargetColor0(int target, uint8_t r, uint8_t g, uint8_t b) {
+    if (target >= 0 && target < SSR_LINK_TARGET_WS2812) {
+        setSSRLinkColor0(target + 1, r, g, b);
+        return true;
+    }
+    if (target >= SSR_LINK_TARGET_WS2812 && target < SSR_LINK_TARGETS) {
+        _data.ws2812_link_colors_0[target - SSR_LINK_TARGET_WS2812] = {r, g, b};
+        _link_revision++;
+        return true;
+    }
+    return false;
+}
+
+bool ConfigManager::setSSRLinkTargetColor100(int target, uint8_t r, uint8_t g, uint8_t b) {
+    if (target >= 0 && target < SSR_LINK_TARGET_WS2812) {
+        setSSRLinkColor100(target + 1, r, g, b);
+        return true;
+    }
+    if (target >= SSR_LINK_TARGET_WS2812 && target < SSR_LINK_TARGETS) {
+        _data.ws2812_link_colors_100[target - SSR_LINK_TARGET_WS2812] = {r, g, b};
+        _link_revision++;
+        return true;
+    }
+    return false;
+}
+
+RGBColorData ConfigManager::getSSRLinkTargetColor0(int target) const {
+    if (target >= 0 && target < SSR_LINK_TARGET_WS2812) {
+        return _data.ssr_link_colors_0[target];
+    }
+    if (target >= SSR_LINK_TARGET_WS2812 && target < SSR_LINK_TARGETS) {
+        return _data.ws2812_link_colors_0[target - SSR_LINK_TARGET_WS2812];
+    }
+    return {0, 0, 0};
+}
+
+RGBColorData ConfigManager::getSSRLinkTargetColor100(int target) const {
+    if (target >= 0 && target < SSR_LINK_TARGET_WS2812) {
+        return _data.ssr_link_colors_100[target];
+    }
+    if (target >= SSR_LINK_TARGET_WS2812 && target < SSR_LINK_TARGETS) {
+        return _data.ws2812_link_colors_100[target - SSR_LINK_TARGET_WS2812];
+    }
+    return {0, 0, 0};
+}
+
+const char* ConfigManager::getSSRLinkCurveName(uint8_t curve) {
+    static const char* const names[SSR_LINK_CURVE_COUNT] = {"linear", "easein", "easeout", "step"};
+    return curve < SSR_LINK_CURVE_COUNT ? names[curve] : "unknown";
+}
+
+int ConfigManager::parseSSRLinkCurve(const char* name) {
+    for (int i = 0; i < SSR_LINK_CURVE_COUNT; i++) {
+        if (strcmp(name, getSSRLinkCurveName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* ConfigManager::getSSRLinkTargetName(int target) {
+    static const char* const names[SSR_LINK_TARGETS] = {"rgb1", "rgb2", "rgb3", "rgb4", "ws1", "ws2", "ws3"};
+    return (target >= 0 && target < SSR_LINK_TARGETS) ? names[target] : "unknown";
+}
+
+int ConfigManager::parseSSRLinkTarget(const char* name) {
+    for (int i = 0; i < SSR_LINK_TARGETS; i++) {
+        if (strcmp(name, getSSRLinkTargetName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 void ConfigManager::setSSRLinkTransitionTime(uint16_t ms) {
     _data.ssr_link_transition_ms = ms;
 }
@@ -426,6 +678,17 @@ void ConfigManager::printNetworkConfig() const {
     log_printf(LOG_LEVEL_INFO, "Default Gateway: %s", getGateway());
     log_printf(LOG_LEVEL_INFO, "UDP Port: %d", _data.udp_port);
     log_printf(LOG_LEVEL_INFO, "NETBIOS Name: %s", _data.netbios_name);
+    if (_data.unit_index == UNIT_INDEX_NONE) {
+        log_printf(LOG_LEVEL_INFO, "Unit Index: none");
+    } else {
+        log_printf(LOG_LEVEL_INFO, "Unit Index: %d", _data.unit_index);
+    }
+    for (int i = 0; i < MULTICAST_GROUPS; i++) {
+        ip4_addr_t addr;
+        addr.addr = _data.multicast_groups[i];
+        log_printf(LOG_LEVEL_INFO, "Multicast %s: %s", getMulticastGroupName(i), addr.addr ? ip4addr_ntoa(&addr) : "off");
+    }
+    log_printf(LOG_LEVEL_INFO, "Multicast Port: %d", _data.multicast_port);
 }
 
 void ConfigManager::printSSRLinkConfig() const {
@@ -435,6 +698,14 @@ void ConfigManager::printSSRLinkConfig() const {
         log_printf(LOG_LEVEL_INFO, "LED%d 0%%: R=%d G=%d B=%d", i + 1, _data.ssr_link_colors_0[i].r, _data.ssr_link_colors_0[i].g, _data.ssr_link_colors_0[i].b);
         log_printf(LOG_LEVEL_INFO, "LED%d 100%%: R=%d G=%d B=%d", i + 1, _data.ssr_link_colors_100[i].r, _data.ssr_link_colors_100[i].g, _data.ssr_link_colors_100[i].b);
     }
+    for (int i = 0; i < SSR_LINK_TARGETS; i++) {
+        uint8_t ssr = getSSRLinkSource(i);
+        if (ssr == 0) {
+            log_printf(LOG_LEVEL_INFO, "Link %s: none", getSSRLinkTargetName(i));
+        } else {
+            log_printf(LOG_LEVEL_INFO, "Link %s: SSR%d (%s)", getSSRLinkTargetName(i), ssr, getSSRLinkCurveName(getSSRLinkCurve(i)));
+        }
+    }
     log_printf(LOG_LEVEL_INFO, "Random RGB idle timeout: %u (x10s)", _data.random_rgb_timeout_10s);
 }
 
@@ -12,6 +12,28 @@
 #define EEPROM_CONFIG_ADDR 8
 #define DEFAULT_NETBIOS_NAME "HASHILUS-HACC"
 
+// SSR→LEDリンクマトリクス
+#define LINK_MATRIX_MAGIC 0xA5
+#define SSR_LINK_TARGETS 7          // 出力先数（RGB LED1-4 + WS2812系統1-3）
+#define SSR_LINK_TARGET_WS2812 4    // WS2812系統1の出力先番号（0始まり）
+
+// マルチキャスト
+#define MULTICAST_MAGIC 0x5A
+#define MULTICAST_GROUPS 2          // 0=全台共通（fleet）、1=ユニット個別（zone）
+#define DEFAULT_MULTICAST_PORT 5556
+#define UNIT_INDEX_NONE 0xFF
+
+/**
+ * リンクのカラーカーブ（デューティ比→補間位置）
+ */
+enum SSRLinkCurve : uint8_t {
+    SSR_LINK_CURVE_LINEAR = 0,  // 線形
+    SSR_LINK_CURVE_EASE_IN,     // 2乗（低デューティ側で緩やか）
+    SSR_LINK_CURVE_EASE_OUT,    // 逆2乗（高デューティ側で緩やか）
+    SSR_LINK_CURVE_STEP,        // 50%以上で100%側の色
+    SSR_LINK_CURVE_COUNT
+};
+
 /**
  * 設定管理クラス
  * JSON形式の設定ファイルを読み書きし、アプリケーション設定を管理する
@@ -25,11 +47,17 @@ public:
     bool saveConfig();
     bool loadConfig(bool force = false);
 
+    // EEPROMの読み書きだけを分けて行う（呼び出し側の排他を外したまま時間のかかる転送を行うため）
+    void getSnapshot(ConfigData& data) const { data = _data; }
+    bool writeConfig(const ConfigData& data);  // スナップショットを保存
+    bool readConfig(ConfigData& data);         // 検証せずに読み出す
+    bool loadConfig(const ConfigData& data);   // 読み出した内容を検証して反映
+
     int getDebugLevel() const { return _data.debug_level; }
-    void setDebugLevel(int level) { 
+    void setDebugLevel(int level, bool auto_save = true) { 
         if (level >= 0 && level <= 3) {
             _data.debug_level = level;
-            saveConfig();  // 変更を即座に保存
+            if (auto_save) saveConfig();  // 変更を即座に保存
         }
     }
     int getUDPPort() const { return _data.udp_port; }
@@ -65,9 +93,37 @@ public:
     RGBColorData getSSRLinkColor100(int led_id) const;  // 100%時の色を取得
     RGBColorData calculateLEDColorForSSR(int led_id, int duty) const;  // デューティ比に応じた色を計算
 
+    // SSR→LEDリンクマトリクス（target: 0-3=RGB LED1-4, 4-6=WS2812系統1-3）
+    bool setSSRLinkSource(int target, uint8_t ssr_id, uint8_t curve);  // 連動元SSR（0=なし）とカーブを設定
+    uint8_t getSSRLinkSource(int target) const;  // 連動元SSR番号（0=なし）
+    uint8_t getSSRLinkCurve(int target) const;   // カーブ（SSRLinkCurve）
+    bool setSSRLinkTargetColor0(int target, uint8_t r, uint8_t g, uint8_t b);    // 出力先の0%時の色を設定
+    bool setSSRLinkTargetColor100(int target, uint8_t r, uint8_t g, uint8_t b);  // 出力先の100%時の色を設定
+    RGBColorData getSSRLinkTargetColor0(int target) const;
+    RGBColorData getSSRLinkTargetColor100(int target) const;
+    // リンク設定（色・マトリクス）の変更ごとに増加（補間テーブル再計算の判定用）
+    uint32_t getSSRLinkRevision() const { return _link_revision; }
+    static const char* getSSRLinkCurveName(uint8_t curve);
+    static int parseSSRLinkCurve(const char* name);  // 不正な名前は-1
+    static const char* getSSRLinkTargetName(int target);
+    static int parseSSRLinkTarget(const char* name);  // "rgb1"-"rgb4", "ws1"-"ws3"、不正な名前は-1
+
+    // マルチキャスト（group: 0=fleet, 1=zone）
+    uint8_t getUnitIndex() const { return _data.unit_index; }  // UNIT_INDEX_NONE=未設定
+    bool setUnitIndex(int index);  // 0-254、-1で未設定
+    uint32_t getMulticastGroup(int group) const;  // 0=なし
+    bool setMulticastGroup(int group, const char* ip);  // "off"で解除、マルチキャストアドレスのみ
+    uint16_t getMulticastPort() const { return _data.multicast_port; }
+    bool setMulticastPort(int port);
+    static const char* getMulticastGroupName(int group);
+    static int parseMulticastGroup(const char* name);  // "fleet", "zone"、不正な名前は-1
+
     // ランダムRGBアイドル設定（10秒単位、0=無効、最大255）
     uint8_t getRandomRGBTimeout10s() const { return _data.random_rgb_timeout_10s; }
-    void setRandomRGBTimeout10s(uint8_t value) { _data.random_rgb_timeout_10s = value; saveConfig(); }
+    void setRandomRGBTimeout10s(uint8_t value, bool auto_save = true) {
+        _data.random_rgb_timeout_10s = value;
+        if (auto_save) saveConfig();
+    }
 
     int8_t getSSRPWMFrequency(uint8_t channel = 0) const { 
         if (channel >= 1 && channel <= 4) {
@@ -106,7 +162,9 @@ public:
 private:
     ConfigData _data;
     Eeprom93C46 _eeprom;
+    Mutex _eeprom_mutex;  // EEPROMの転送を直列化（UDPとシリアルの両方から保存されるため）
     bool _used_default = false;
+    volatile uint32_t _link_revision = 0;  // リンク設定の変更カウンタ
     static char _ip_buffer[16];  // IPアドレス文字列用バッファ
     static char _netmask_buffer[16];  // ネットマスク文字列用バッファ
     static char _gateway_buffer[16];  // ゲートウェイ文字列用バッファ
@@ -119,6 +177,11 @@ private:
     bool validateNetmask(uint32_t netmask) const;
     bool validateGateway(uint32_t gateway) const;
     bool validateNetBIOSName(const char* name) const;
+    void setDefaultLinkMatrix();
+    bool validateLinkMatrix() const;
+    void setDefaultMulticast();
+    bool validateMulticast() const;
+    bool validateConfig(bool create_if_not_exist);
 };
 
 #endif // CONFIG_MANAGER_H 
\ No newline at end of file
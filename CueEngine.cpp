@@ -0,0 +1,146 @@
+#include "CueEngine.h"
+#include <string.h>
+
+CueEngine::CueEngine(Callback<void(const char*)> executor, Mutex& executor_lock)
+    : _count(0), _next(0), _running(false), _started(false), _start_us(0), _executed(0), _max_late_us(0),
+      _executor(executor), _executor_lock(executor_lock), _thread(osPriorityAboveNormal, 6144) {
+    _clock.start();
+    _thread.start(callback(this, &CueEngine::threadFunc));
+}
+
+CueEngine::~CueEngine() {
+    _timeout.detach();
+    _flags.set(CUE_FLAG_EXIT);
+    if (_thread.get_state() == Thread::Running) {
+        _thread.join();
+    }
+}
+
+int CueEngine::add(uint32_t offset_ms, const char* command) {
+    size_t length = strlen(command);
+    if (length == 0 || length >= CUE_COMMAND_MAX) {
+        return -1;
+    }
+
+    ScopedLock<Mutex> lock(_mutex);
+    if (_running || _count >= CUE_MAX_ENTRIES) {
+        return -1;
+    }
+
+    // 同じ時刻のエントリの後ろに挿入
+    int index = _count;
+    while (index > 0 && _entries[index - 1].offset_ms > offset_ms) {
+        _entries[index] = _entries[index - 1];
+        index--;
+    }
+    _entries[index].offset_ms = offset_ms;
+    memcpy(_entries[index].command, command, length + 1);
+    _count++;
+    return index;
+}
+
+void CueEngine::clear() {
+    ScopedLock<Mutex> lock(_mutex);
+    _timeout.detach();
+    _running = false;
+    _count = 0;
+    _next = 0;
+}
+
+bool CueEngine::go(uint32_t delay_ms) {
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        if (_count == 0) {
+            return false;
+        }
+        _timeout.detach();
+        _start_us = (uint64_t)_clock.elapsed_time().count() + (uint64_t)delay_ms * 1000;
+        _next = 0;
+        _executed = 0;
+        _max_late_us = 0;
+        _running = true;
+        _started = true;
+    }
+    _flags.set(CUE_FLAG_WAKE);
+    return true;
+}
+
+void CueEngine::stop() {
+    ScopedLock<Mutex> lock(_mutex);
+    _timeout.detach();
+    _running = false;
+}
+
+void CueEngine::getStatus(CueStatus& status) const {
+    ScopedLock<Mutex> lock(_mutex);
+    status.count = _count;
+    status.next = _next;
+    status.running = _running;
+    int64_t elapsed_us = (int64_t)_clock.elapsed_time().count() - (int64_t)_start_us;
+    status.elapsed_ms = _started ? (int32_t)(elapsed_us / 1000) : 0;
+    status.executed = _executed;
+    status.max_late_us = _max_late_us;
+}
+
+bool CueEngine::getEntry(uint16_t index, uint32_t& offset_ms, char* command, size_t size) const {
+    ScopedLock<Mutex> lock(_mutex);
+    if (index >= _count || size == 0) {
+        return false;
+    }
+    offset_ms = _entries[index].offset_ms;
+    strncpy(command, _entries[index].command, size - 1);
+    command[size - 1] = '\0';
+    return true;
+}
+
+void CueEngine::onTimeout() {
+    // 割り込みコンテキスト: スレッドを起こすだけ
+    _flags.set(CUE_FLAG_WAKE);
+}
+
+void CueEngine::threadFunc() {
+    for (;;) {
+        uint32_t flags = _flags.wait_any(CUE_FLAG_WAKE | CUE_FLAG_EXIT);
+        if (flags & osFlagsError) {
+            continue;
+        }
+        if (flags & CUE_FLAG_EXIT) {
+            break;
+        }
+
+        // 期限に達したエントリを順に実行し、次のエントリの時刻にTimeoutを張る
+        for (;;) {
+            char command[CUE_COMMAND_MAX];
+            // 実行の排他を先に取得し、取得後の時刻で期限と遅れを判定する
+            // （実行中のコマンドを待った時間も遅れに含める）
+            ScopedLock<Mutex> executor_lock(_executor_lock);
+            {
+                ScopedLock<Mutex> lock(_mutex);
+                if (!_running) {
+                    break;
+                }
+                if (_next >= _count) {
+                    _running = false;
+                    break;
+                }
+                uint64_t now_us = _clock.elapsed_time().count();
+                uint64_t due_us = _start_us + (uint64_t)_entries[_next].offset_ms * 1000;
+                if (now_us < due_us) {
+                    _timeout.attach(callback(this, &CueEngine::onTimeout),
+                                    std::chrono::microseconds(due_us - now_us));
+                    break;
+                }
+                uint32_t late_us = (uint32_t)(now_us - due_us);
+                if (late_us > _max_late_us) {
+                    _max_late_us = late_us;
+                }
+                memcpy(command, _entries[_next].command, CUE_COMMAND_MAX);
+                _next++;
+                _executed++;
+            }
+
+            // コマンドの実行中は_mutexを保持しない（実行中のstop/statusを待たせない）
+            _executor(command);
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef CUE_ENGINE_H
+#define CUE_ENGINE_H
+
+#include "mbed.h"
+
+// キューリストの最大エントリ数とコマンド長
+#define CUE_MAX_ENTRIES 128
+#define CUE_COMMAND_MAX 64
+
+/**
+ * キューの実行状態
+ */
+struct CueStatus {
+    uint16_t count;         // 登録済みエントリ数
+    uint16_t next;          // 次に実行するエントリ
+    bool running;           // 再生中か
+    int32_t elapsed_ms;     // 再生開始（go + 遅延）からの経過時間（開始前は負）
+    uint32_t executed;      // 今回の再生で実行したエントリ数
+    uint32_t max_late_us;   // 予定時刻から実行開始（排他の取得後）までの最大遅れ
+};
+
+/**
+ * Cue list engine
+ * Commands are uploaded in advance with a time offset and started with go().
+ * A Timeout armed for the next due entry wakes a dedicated thread, which runs
+ * the command through the executor (the same handlers as network commands),
+ * so network jitter does not reach the show timing.
+ */
+class CueEngine {
+public:
+    /**
+     * Constructor
+     * @param executor コマンドを実行する関数（キュースレッドから呼ばれる）
+     * @param executor_lock 実行の排他（取得してから遅れを測って実行する）
+     */
+    CueEngine(Callback<void(const char*)> executor, Mutex& executor_lock);
+    ~CueEngine();
+
+    /**
+     * Add an entry (entries are kept sorted by offset, equal offsets keep insertion order)
+     * @param offset_ms 再生開始からの時刻（ミリ秒）
+     * @param command 実行するコマンド
+     * @return Index of the added entry, or -1 (list full, command too long or playing)
+     */
+    int add(uint32_t offset_ms, const char* command);
+
+    /**
+     * Stop playback and remove all entries
+     */
+    void clear();
+
+    /**
+     * Start playback from the first entry
+     * @param delay_ms 再生開始までの遅延（ミリ秒）
+     * @return true if successful, false if the list is empty
+     */
+    bool go(uint32_t delay_ms = 0);
+
+    /**
+     * Stop playback (remaining entries are not executed)
+     */
+    void stop();
+
+    /**
+     * Get the playback status
+     * @param status Output status
+     */
+    void getStatus(CueStatus& status) const;
+
+    /**
+     * Get an entry
+     * @param index Entry index
+     * @param offset_ms Output offset
+     * @param command Output command buffer
+     * @param size Size of the command buffer
+     * @return true if successful, false if the index is out of range
+     */
+    bool getEntry(uint16_t index, uint32_t& offset_ms, char* command, size_t size) const;
+
+private:
+    struct Entry {
+        uint32_t offset_ms;
+        char command[CUE_COMMAND_MAX];
+    };
+
+    // スレッドフラグ
+    static const uint32_t CUE_FLAG_WAKE = 0x01;  // 期限到来・再生開始・停止
+    static const uint32_t CUE_FLAG_EXIT = 0x02;
+
+    Entry _entries[CUE_MAX_ENTRIES];
+    uint16_t _count;
+    uint16_t _next;
+    bool _running;
+    bool _started;               // 1度でも再生したか（経過時間の表示用）
+    uint64_t _start_us;          // 再生開始時刻（_clock基準）
+    uint32_t _executed;
+    uint32_t _max_late_us;
+
+    Callback<void(const char*)> _executor;
+    Mutex& _executor_lock;
+    mutable Mutex _mutex;        // エントリと再生状態を保護（コマンド実行中は保持しない）
+    Timer _clock;
+    Timeout _timeout;
+    EventFlags _flags;
+    Thread _thread;
+
+    void threadFunc();
+    void onTimeout();
+};
+
+#endif // CUE_ENGINE_H
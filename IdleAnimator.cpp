@@ -93,9 +93,9 @@ void IdleAnimator::onChangeColor() {
         uint8_t r, g, b;
         pickBrightRandom(r, g, b);
         if (_fade_ms.count() > 0) {
-            _rgb->setColorWithTransition(id, r, g, b, (uint16_t)_fade_ms.count());
+            _rgb->setColorWithTransition(id, r, g, b, (uint16_t)_fade_ms.count(), RGB_SOURCE_IDLE);
         } else {
-            _rgb->setColor(id, r, g, b);
+            _rgb->setColor(id, r, g, b, RGB_SOURCE_IDLE);
         }
     }
 
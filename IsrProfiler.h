@@ -0,0 +1,192 @@
+#ifndef ISR_PROFILER_H
+#define ISR_PROFILER_H
+
+#include "mbed.h"
+
+/**
+ * 計測対象の割り込みハンドラ
+ */
+enum IsrProfileId : uint8_t {
+    ISR_PROF_ZEROX_EDGE = 0,     // zeroxEdgeHandler（zeroxControlHandlerを含む）
+    ISR_PROF_ZEROX_CONTROL,      // zeroxControlHandler
+    ISR_PROF_DELAYED_CONTROL,    // delayedControlHandler（zeroxControlHandlerを含む）
+    ISR_PROF_TURN_ON,            // turnOnSSR0〜3
+    ISR_PROF_TURN_OFF,           // turnOffSSR0〜3
+    ISR_PROF_COUNT
+};
+
+/**
+ * 割り込みハンドラの実行サイクル統計
+ */
+struct IsrProfileStats {
+    uint32_t count;     // 計測回数
+    uint32_t min;       // 最小サイクル数
+    uint32_t max;       // 最大サイクル数
+    uint64_t total;     // 合計サイクル数（平均算出用）
+};
+
+/**
+ * ISR cycle-count profiler
+ * Uses the Cortex-A9 PMU cycle counter (PMCCNTR).
+ * Statistics are written only from interrupt context; threads read them
+ * through a per-entry sequence counter and request resets with a flag,
+ * so neither side takes a lock or masks interrupts. A sample that nests
+ * inside an update of the same entry is dropped.
+ */
+class IsrProfiler {
+public:
+    IsrProfiler() {
+        for (int i = 0; i < ISR_PROF_COUNT; i++) {
+            _entry[i].seq = 0;
+            _entry[i].reset_request = false;
+            clearStats(_entry[i].stats);
+        }
+    }
+
+    /**
+     * Enable the PMU cycle counter (call once from privileged mode)
+     */
+    static void enableCycleCounter() {
+#if defined(__ARM_ARCH_7A__)
+        uint32_t pmcr;
+        __asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+        pmcr |= (1u << 0) | (1u << 2);  // E: 有効化, C: サイクルカウンタリセット
+        pmcr &= ~(1u << 3);             // D: 64分周なし
+        __asm volatile ("mcr p15, 0, %0, c9, c12, 0" :: "r"(pmcr));
+        __asm volatile ("mcr p15, 0, %0, c9, c12, 1" :: "r"(1u << 31));  // PMCNTENSET: サイクルカウンタ
+#endif
+    }
+
+    /**
+     * Read the cycle counter
+     * @return Current CPU cycle count (0 on non-ARMv7-A builds)
+     */
+    static inline uint32_t cycles() {
+#if defined(__ARM_ARCH_7A__)
+        uint32_t value;
+        __asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r"(value));
+        return value;
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * Record one handler execution (interrupt context only)
+     * @param id Handler
+     * @param elapsed Elapsed cycles
+     */
+    void record(uint8_t id, uint32_t elapsed) {
+        if (id >= ISR_PROF_COUNT) {
+            return;
+        }
+        Entry& e = _entry[id];
+
+        // 更新の開始（奇数）をLDREX/STREXで確保。ゼロクロス割り込みがTimeout割り込みの
+        // 更新中に同じエントリを記録しようとした場合は、その1回を捨てる（割り込みは禁止しない）
+        uint32_t seq = e.seq;
+        if ((seq & 1) || !core_util_atomic_cas_u32(&e.seq, &seq, seq + 1)) {
+            return;
+        }
+        __asm volatile ("" ::: "memory");
+        if (e.reset_request) {
+            clearStats(e.stats);
+            e.reset_request = false;
+        }
+        IsrProfileStats& s = e.stats;
+        s.count++;
+        s.total += elapsed;
+        if (elapsed < s.min) {
+            s.min = elapsed;
+        }
+        if (elapsed > s.max) {
+            s.max = elapsed;
+        }
+        __asm volatile ("" ::: "memory");
+        e.seq = seq + 2;  // 偶数: 更新完了
+    }
+
+    /**
+     * Get a consistent copy of the statistics (thread context)
+     * @param id Handler
+     * @param stats Output statistics
+     * @return true if successful, false otherwise
+     */
+    bool getStats(uint8_t id, IsrProfileStats& stats) const {
+        if (id >= ISR_PROF_COUNT) {
+            return false;
+        }
+        const Entry& e = _entry[id];
+
+        if (e.reset_request) {
+            // リセット要求中（次の計測で割り込み側がクリア）
+            clearStats(stats);
+            return true;
+        }
+
+        uint32_t seq;
+        do {
+            seq = e.seq;
+            __asm volatile ("" ::: "memory");  // 統計の読み出しをseqの前後で順序固定
+            stats = e.stats;
+            __asm volatile ("" ::: "memory");
+        } while ((seq & 1) || seq != e.seq);
+
+        return true;
+    }
+
+    /**
+     * Request a reset of all statistics (applied by the next record)
+     */
+    void requestReset() {
+        for (int i = 0; i < ISR_PROF_COUNT; i++) {
+            core_util_atomic_store_bool(&_entry[i].reset_request, true);
+        }
+    }
+
+    /**
+     * Get the handler name
+     * @param id Handler
+     * @return Name string
+     */
+    static const char* getName(uint8_t id) {
+        static const char* const names[ISR_PROF_COUNT] = {
+            "zerox_edge", "zerox_control", "delayed_control", "turn_on", "turn_off"
+        };
+        return id < ISR_PROF_COUNT ? names[id] : "unknown";
+    }
+
+private:
+    struct Entry {
+        volatile uint32_t seq;          // シーケンス番号（奇数は更新中）
+        volatile bool reset_request;    // リセット要求（スレッド側がセット）
+        IsrProfileStats stats;
+    };
+    Entry _entry[ISR_PROF_COUNT];
+
+    static void clearStats(IsrProfileStats& s) {
+        s.count = 0;
+        s.min = 0xFFFFFFFF;
+        s.max = 0;
+        s.total = 0;
+    }
+};
+
+/**
+ * Scoped measurement helper (records on destruction, so early returns are covered)
+ */
+class IsrProfileScope {
+public:
+    IsrProfileScope(IsrProfiler& profiler, uint8_t id)
+        : _profiler(profiler), _id(id), _start(IsrProfiler::cycles()) {}
+    ~IsrProfileScope() {
+        _profiler.record(_id, IsrProfiler::cycles() - _start);
+    }
+
+private:
+    IsrProfiler& _profiler;
+    uint8_t _id;
+    uint32_t _start;
+};
+
+#endif // ISR_PROFILER_H
@@ -1,12 +1,129 @@
 #include "RGBLEDDriver.h"
 #include "SerialController.h"
+#include "WS2812Driver.h"
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// コンパイル時に生成する補間カーブ・ガンマテーブル（実行時の浮動小数点演算なし）
+// ---------------------------------------------------------------------------
+
+// 補間カーブのテーブル分割数（進捗Q16の上位8ビットで引き、下位8ビットで補間）
+constexpr int EASE_LUT_STEPS = 256;
+
+constexpr double PI_HALF = 1.5707963267948966;
+
+// sin(x)（0 <= x <= π/2、テイラー展開）
+constexpr double ctSin(double x) {
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// x^(1/5)（0 <= x <= 1、ニュートン法）
+constexpr double ctFifthRoot(double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    double y = 1.0;
+    for (int i = 0; i < 64; i++) {
+        double y4 = y * y * y * y;
+        y = (4.0 * y + x / y4) / 5.0;
+    }
+    return y;
+}
+
+// 補間カーブ（0 <= p <= 1）
+constexpr double ctEase(int easing, double p) {
+    switch (easing) {
+        case RGB_EASE_IN:
+            return p * p;
+        case RGB_EASE_OUT:
+            return 1.0 - (1.0 - p) * (1.0 - p);
+        case RGB_EASE_IN_OUT:
+            return p < 0.5 ? 2.0 * p * p : 1.0 - 2.0 * (1.0 - p) * (1.0 - p);
+        case RGB_EASE_STEP:
+            return p >= 1.0 ? 1.0 : 0.0;
+        case RGB_EASE_CUBIC_IN:
+            return p * p * p;
+        case RGB_EASE_CUBIC_OUT:
+            return 1.0 - (1.0 - p) * (1.0 - p) * (1.0 - p);
+        case RGB_EASE_CUBIC_IN_OUT:
+            return p < 0.5 ? 4.0 * p * p * p : 1.0 - 4.0 * (1.0 - p) * (1.0 - p) * (1.0 - p);
+        case RGB_EASE_SINE_IN:
+            return 1.0 - ctSin((1.0 - p) * PI_HALF);
+        case RGB_EASE_SINE_OUT:
+            return ctSin(p * PI_HALF);
+        case RGB_EASE_SINE_IN_OUT:
+            return p < 0.5 ? (1.0 - ctSin((1.0 - 2.0 * p) * PI_HALF)) / 2.0
+                           : (1.0 + ctSin((2.0 * p - 1.0) * PI_HALF)) / 2.0;
+        case RGB_EASE_LINEAR:
+        default:
+            return p;
+    }
+}
+
+// 出力ガンマ（0 <= x <= 1 → 明るさ 0-1）
+constexpr double ctGamma(int gamma, double x) {
+    switch (gamma) {
+        case RGB_GAMMA_POWER22:
+            return x * x * ctFifthRoot(x);
+        case RGB_GAMMA_CIE: {
+            double l = x * 100.0;
+            if (l <= 8.0) {
+                return l / 903.3;
+            }
+            double f = (l + 16.0) / 116.0;
+            return f * f * f;
+        }
+        case RGB_GAMMA_LINEAR:
+        default:
+            return x;
+    }
+}
+
+constexpr uint16_t ctToU16(double v) {
+    return v <= 0.0 ? 0 : (v >= 1.0 ? 65535 : (uint16_t)(v * 65535.0 + 0.5));
+}
+
+struct EasingTable {
+    uint16_t v[RGB_EASE_COUNT][EASE_LUT_STEPS + 1];  // Q16（65535=1.0）
+    constexpr EasingTable() : v() {
+        for (int e = 0; e < RGB_EASE_COUNT; e++) {
+            for (int i = 0; i <= EASE_LUT_STEPS; i++) {
+                v[e][i] = ctToU16(ctEase(e, (double)i / EASE_LUT_STEPS));
+            }
+        }
+    }
+};
+
+struct GammaTable {
+    uint16_t v[RGB_GAMMA_COUNT][256];  // 8ビット色→16ビット線形値
+    constexpr GammaTable() : v() {
+        for (int g = 0; g < RGB_GAMMA_COUNT; g++) {
+            for (int i = 0; i < 256; i++) {
+                v[g][i] = ctToU16(ctGamma(g, i / 255.0));
+            }
+        }
+    }
+};
+
+constexpr EasingTable EASING_LUT;
+constexpr GammaTable GAMMA_LUT;
+
+}  // namespace
 
 RGBLEDDriver::RGBLEDDriver(SSRDriver& ssr_driver, ConfigManager* config_manager,
                           PinName rgb1_r_pin, PinName rgb1_g_pin, PinName rgb1_b_pin,
                           PinName rgb2_r_pin, PinName rgb2_g_pin, PinName rgb2_b_pin,
                           PinName rgb3_r_pin, PinName rgb3_g_pin, PinName rgb3_b_pin,
                           PinName rgb4_r_pin, PinName rgb4_g_pin, PinName rgb4_b_pin)
-    : _thread_running(false), _ssr_driver(ssr_driver), _config_manager(config_manager) {
+    : _transition_thread(osPriorityAboveNormal), _thread_running(false),
+      _ssr_driver(ssr_driver), _config_manager(config_manager) {
     
     // Initialize RGB LED pins
     _rgb_pins[0][0] = new PwmOut(rgb1_r_pin);
@@ -25,7 +142,7 @@ RGBLEDDriver::RGBLEDDriver(SSRDriver& ssr_driver, ConfigManager* config_manager,
     _rgb_pins[3][1] = new PwmOut(rgb4_g_pin);
     _rgb_pins[3][2] = new PwmOut(rgb4_b_pin);
     
-    // LED4用のデジタル出力ピンを初期化（2値制御用）
+    // LED4用のデジタル出力ピンを初期化（BAMで階調制御）
     _led4_digital_pins[0] = new DigitalOut(rgb4_r_pin);
     _led4_digital_pins[1] = new DigitalOut(rgb4_g_pin);
     _led4_digital_pins[2] = new DigitalOut(rgb4_b_pin);
@@ -40,43 +157,95 @@ RGBLEDDriver::RGBLEDDriver(SSRDriver& ssr_driver, ConfigManager* config_manager,
     _led4_digital_pins[1]->write(0);
     _led4_digital_pins[2]->write(0);
     
+    for (int c = 0; c < 3; c++) {
+        _led4_target[c] = 0;
+        _led4_frame[c] = 0;
+        _led4_bam_err[c] = 0;
+    }
+    _led4_dither = false;
+    _led4_bam_running = false;
+    _led4_bam_bit = 0;
+    
     // Initial settings
     _period_us = DEFAULT_PERIOD_US;
     
     // Initialize: turn off all LEDs and set PWM period
     for (int i = 0; i < 4; i++) {
+        _gamma[i] = RGB_DEFAULT_GAMMA;
         for (int j = 0; j < 3; j++) {
             _rgb_pins[i][j]->period_us(_period_us);
             _rgb_pins[i][j]->write(0.0f);
             _colors[i][j] = 0;
+            _levels[i][j] = 0;
+            _linear[i][j] = 0;
+            _dither_err[i][j] = 0;
+            _pwm_out[i][j] = 0;
         }
     }
 
     // トランジション状態の初期化
     for (int i = 0; i < 4; i++) {
         _transitions[i].active = false;
-        _transitions[i].start_r = 0;
-        _transitions[i].start_g = 0;
-        _transitions[i].start_b = 0;
-        _transitions[i].target_r = 0;
-        _transitions[i].target_g = 0;
-        _transitions[i].target_b = 0;
+        for (int c = 0; c < 3; c++) {
+            _transitions[i].start[c] = 0;
+            _transitions[i].target[c] = 0;
+        }
         _transitions[i].start_time = 0;
         _transitions[i].duration_ms = 0;
     }
 
+    // メールボックスの初期化
+    for (int src = 0; src < RGB_SOURCE_COUNT; src++) {
+        for (int i = 0; i < 4; i++) {
+            _mailbox[src][i].seq = 0;
+            memset(&_mailbox[src][i].request, 0, sizeof(TransitionRequest));
+            _mailbox_seen[src][i] = 0;
+        }
+    }
+    _mailbox_stamp = 0;
+    _notify_head = 0;
+    _notify_tail = 0;
+
+    // キーフレームアニメーションの初期化
+    for (int i = 0; i < 4; i++) {
+        _anim[i].active = false;
+        _anim[i].count = 0;
+        _anim_pending[i].active = false;
+        _anim_pending[i].count = 0;
+    }
+    _anim_load_mask = 0;
+    _anim_stop_mask = 0;
+    _anim_active_mask = 0;
+    _transition_active_mask = 0;
+
+    // SSR連動の初期化（起動直後に全出力先を一度反映する）
+    _link_table_revision = 0;
+    for (int i = 0; i < SSR_LINK_TARGETS; i++) {
+        _link_last_duty[i] = -1;
+    }
+    if (_config_manager) {
+        rebuildSSRLinkTables();
+    }
+    _thread_flags.set(LINK_FLAG_CONFIG);
+    _ssr_driver.setDutyChangeCallback(callback(this, &RGBLEDDriver::onSSRDutyChange));
+
     // トランジション更新スレッドを開始
     _thread_running = true;
     _transition_thread.start(callback(this, &RGBLEDDriver::transitionThreadFunc));
 }
 
 RGBLEDDriver::~RGBLEDDriver() {
+    _ssr_driver.setDutyChangeCallback(nullptr);
+
     // スレッドを停止
     _thread_running = false;
+    _thread_flags.set(THREAD_FLAG_STOP);
     if (_transition_thread.get_state() == Thread::Running) {
         _transition_thread.join();
     }
 
+    _led4_bam_timeout.detach();
+
     // Free memory for PWM pins
     for (int i = 0; i < 4; i++) {
         for (int j = 0; j < 3; j++) {
@@ -90,49 +259,175 @@ RGBLEDDriver::~RGBLEDDriver() {
     }
 }
 
-bool RGBLEDDriver::setColor(uint8_t id, uint8_t r, uint8_t g, uint8_t b) {
-    // Check id
-    if (id < 1 || id > 4) {
-        return false;
+bool RGBLEDDriver::setColor(uint8_t id, uint8_t r, uint8_t g, uint8_t b, RGBCommandSource source) {
+    // 出力状態（PWMの変化検出・LED4のBAM）はトランジションスレッドだけが触る
+    // 他スレッドからは0msのトランジションとして要求し、実行中のトランジション・キーフレームも止める
+    return setColorWithTransition(id, r, g, b, 0, source);
+}
+
+void RGBLEDDriver::writeColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+    // 静止した色なのでディザリングせずに出力
+    const uint16_t levels[3] = {(uint16_t)(r << 8), (uint16_t)(g << 8), (uint16_t)(b << 8)};
+    writeLevels(index, levels, false);
+}
+
+uint16_t RGBLEDDriver::levelFromLinear(uint8_t gamma, uint16_t linear) {
+    const uint16_t* lut = GAMMA_LUT.v[gamma];
+    if (linear >= lut[255]) {
+        return 0xFF00;
     }
     
-    // Convert to index
-    uint8_t index = id - 1;
+    // lut[lo] <= linear < lut[hi] となる区間を二分探索
+    int lo = 0;
+    int hi = 255;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (lut[mid] <= linear) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    uint32_t span = lut[hi] - lut[lo];
+    uint32_t frac = span ? ((uint32_t)(linear - lut[lo]) << 8) / span : 0;
+    return (uint16_t)((lo << 8) + (frac > 255 ? 255 : frac));
+}
+
+void RGBLEDDriver::writeLevels(uint8_t index, const uint16_t levels[3], bool dither) {
+    for (int c = 0; c < 3; c++) {
+        uint16_t level = levels[c];
+        _levels[index][c] = level;
+        
+        _colors[index][c] = (level >= 0xFF00) ? 255 : (uint8_t)((level + 0x80) >> 8);
+        
+        // 8.8の色レベルをガンマテーブルの補間で16ビット線形値へ
+        const uint16_t* lut = GAMMA_LUT.v[_gamma[index]];
+        uint8_t idx = level >> 8;
+        uint32_t frac = level & 0xFF;
+        uint32_t lin = lut[idx];
+        if (idx < 255 && frac != 0) {
+            lin += ((lut[idx + 1] - lut[idx]) * frac) >> 8;
+        }
+        _linear[index][c] = (uint16_t)lin;
+        
+        if (index == 3) {
+            // LED4はBAM割り込みが出力（フレーム先頭で取り込み）
+            _led4_target[c] = (uint16_t)lin;
+            continue;
+        }
+        
+        // PWMの分解能へ量子化
+        uint32_t out;
+        if (dither) {
+            // 誤差拡散: 表せない下位ビットを次の更新へ繰り越す
+            uint32_t acc = lin + _dither_err[index][c];
+            out = acc >> RGB_DITHER_BITS;
+            _dither_err[index][c] = acc & ((1 << RGB_DITHER_BITS) - 1);
+        } else {
+            out = (lin + (1 << (RGB_DITHER_BITS - 1))) >> RGB_DITHER_BITS;
+            _dither_err[index][c] = 0;
+        }
+        if (out > RGB_PWM_MAX) {
+            out = RGB_PWM_MAX;
+        }
+        
+        // 値が変わったチャンネルのみ出力を更新
+        if (out != _pwm_out[index][c]) {
+            _pwm_out[index][c] = out;
+            _rgb_pins[index][c]->write(out * (1.0f / RGB_PWM_MAX));
+        }
+    }
     
-    // Save color values
-    _colors[index][0] = r;
-    _colors[index][1] = g;
-    _colors[index][2] = b;
+    if (index == 3) {
+        updateLED4Output(dither);
+    }
+}
+
+void RGBLEDDriver::updateLED4Output(bool dither) {
+    // _led4_bam_runningの確認とTimeoutのattach/detachは排他していないため、
+    // 呼び出しはトランジションスレッドに限る（他スレッドはsetColor・メールボックス経由）
+    MBED_ASSERT(ThisThread::get_id() == _transition_thread.get_id());
+    _led4_dither = dither;
     
-    // LED4の場合は2値制御（0=OFF、1以上=ON）
-    if (id == 4) {
-        _led4_digital_pins[0]->write(r > 0 ? 1 : 0);
-        _led4_digital_pins[1]->write(g > 0 ? 1 : 0);
-        _led4_digital_pins[2]->write(b > 0 ? 1 : 0);
-    } else {
-        // LED1-3は通常のPWM制御
-        _rgb_pins[index][0]->write(r / 255.0f);
-        _rgb_pins[index][1]->write(g / 255.0f);
-        _rgb_pins[index][2]->write(b / 255.0f);
+    // ディザリングなしで全チャンネルが消灯/全点灯に丸まる場合は割り込み不要
+    bool modulate = false;
+    int static_level[3];
+    for (int c = 0; c < 3; c++) {
+        uint32_t frame = ((uint32_t)_led4_target[c] + (1 << (RGB_LED4_BAM_SHIFT - 1))) >> RGB_LED4_BAM_SHIFT;
+        if (dither ? (_led4_target[c] != 0 && _led4_target[c] != 0xFFFF)
+                   : (frame != 0 && frame < RGB_LED4_BAM_MAX)) {
+            modulate = true;
+        }
+        static_level[c] = frame != 0 ? 1 : 0;
     }
     
-    return true;
+    if (modulate) {
+        if (!_led4_bam_running) {
+            _led4_bam_bit = 0;
+            _led4_bam_running = true;
+            _led4_bam_timeout.attach(callback(this, &RGBLEDDriver::led4BamHandler),
+                                     std::chrono::microseconds(RGB_LED4_BAM_UNIT_US));
+        }
+        return;
+    }
+    
+    if (_led4_bam_running) {
+        // detach後は割り込みが実行されないため、以降の直接出力と競合しない
+        _led4_bam_timeout.detach();
+        _led4_bam_running = false;
+        for (int c = 0; c < 3; c++) {
+            _led4_bam_err[c] = 0;
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        _led4_digital_pins[c]->write(static_level[c]);
+    }
 }
 
-bool RGBLEDDriver::turnOff(uint8_t id) {
+void RGBLEDDriver::led4BamHandler() {
+    uint8_t bit = _led4_bam_bit;
+    
+    if (bit == 0) {
+        // フレーム先頭で最新の目標値を取り込み
+        bool dither = _led4_dither;
+        for (int c = 0; c < 3; c++) {
+            uint32_t acc = _led4_target[c];
+            if (dither) {
+                // 誤差拡散: BAMで表せない下位ビットを次のフレームへ繰り越す
+                acc += _led4_bam_err[c];
+                _led4_bam_err[c] = acc & ((1 << RGB_LED4_BAM_SHIFT) - 1);
+            } else {
+                acc += 1 << (RGB_LED4_BAM_SHIFT - 1);
+                _led4_bam_err[c] = 0;
+            }
+            uint32_t frame = acc >> RGB_LED4_BAM_SHIFT;
+            _led4_frame[c] = frame > RGB_LED4_BAM_MAX ? RGB_LED4_BAM_MAX : (uint8_t)frame;
+        }
+    }
+    
+    // ビットnのスロットは UNIT_US << n の間、そのビットの値を出力
+    for (int c = 0; c < 3; c++) {
+        _led4_digital_pins[c]->write((_led4_frame[c] >> bit) & 1);
+    }
+    _led4_bam_bit = (bit + 1 < RGB_LED4_BAM_BITS) ? bit + 1 : 0;
+    _led4_bam_timeout.attach(callback(this, &RGBLEDDriver::led4BamHandler),
+                             std::chrono::microseconds(RGB_LED4_BAM_UNIT_US << bit));
+}
+
+bool RGBLEDDriver::turnOff(uint8_t id, RGBCommandSource source) {
     // Check id
     if (id < 1 || id > 4) {
         return false;
     }
     
     // Set color to 0 (turn off)
-    return setColor(id, 0, 0, 0);
+    return setColor(id, 0, 0, 0, source);
 }
 
-void RGBLEDDriver::allOff() {
+void RGBLEDDriver::allOff(RGBCommandSource source) {
     // Turn off all LEDs
     for (uint8_t i = 1; i <= 4; i++) {
-        turnOff(i);
+        turnOff(i, source);
     }
 }
 
@@ -170,93 +465,517 @@ void RGBLEDDriver::setPeriod(uint32_t period_us) {
     }
 }
 
-bool RGBLEDDriver::setColorWithTransition(uint8_t id, uint8_t target_r, uint8_t target_g, uint8_t target_b, uint16_t transition_ms) {
-    // Check id
-    if (id < 1 || id > 4) {
+bool RGBLEDDriver::setColorWithTransition(uint8_t id, uint8_t target_r, uint8_t target_g, uint8_t target_b, uint16_t transition_ms,
+                                          RGBCommandSource source, uint8_t easing, uint8_t gamma) {
+    // Check parameters
+    if (id < 1 || id > 4 || source >= RGB_SOURCE_COUNT || easing >= RGB_EASE_COUNT ||
+        (gamma >= RGB_GAMMA_COUNT && gamma != RGB_GAMMA_KEEP)) {
         return false;
     }
     
-    // Convert to index
-    uint8_t index = id - 1;
+    // 送信元専用のスロットに書き込んで公開（ロックなし）
+    MailboxSlot& slot = _mailbox[source][id - 1];
+    uint32_t stamp = core_util_atomic_incr_u32(&_mailbox_stamp, 1);
+    
+    slot.seq++;  // 奇数: 書き込み中
+    __asm volatile ("" ::: "memory");
+    slot.request.stamp = stamp;
+    slot.request.r = target_r;
+    slot.request.g = target_g;
+    slot.request.b = target_b;
+    slot.request.easing = easing;
+    slot.request.gamma = gamma;
+    slot.request.duration_ms = transition_ms;
+    __asm volatile ("" ::: "memory");
+    slot.seq++;  // 偶数: 公開
+    
+    // 待機中のトランジションスレッドを起こす
+    _thread_flags.set(TRANSITION_FLAG_START);
+    
+    return true;
+}
+
+void RGBLEDDriver::startTransition(uint8_t index, uint8_t r, uint8_t g, uint8_t b, uint16_t duration_ms,
+                                   uint8_t easing, uint8_t gamma) {
+    Transition& t = _transitions[index];
     
-    // 現在の色を取得
-    uint8_t current_r, current_g, current_b;
-    getColor(id, &current_r, &current_g, &current_b);
-    
-    // トランジション状態を設定
-    _transitions[index].active = true;
-    _transitions[index].start_r = current_r;
-    _transitions[index].start_g = current_g;
-    _transitions[index].start_b = current_b;
-    _transitions[index].target_r = target_r;
-    _transitions[index].target_g = target_g;
-    _transitions[index].target_b = target_b;
-    _transitions[index].start_time = us_ticker_read() / 1000;  // 現在時刻（ミリ秒）
-    _transitions[index].duration_ms = transition_ms;
+    // 現在のレベルから開始（8ビット未満の途中値も引き継ぐ）
+    if (gamma != RGB_GAMMA_KEEP && gamma != _gamma[index]) {
+        // ガンマを切り替える場合は明るさが変わらないよう新しいガンマでのレベルに換算
+        for (int c = 0; c < 3; c++) {
+            t.start[c] = levelFromLinear(gamma, _linear[index][c]);
+        }
+        _gamma[index] = gamma;
+    } else {
+        for (int c = 0; c < 3; c++) {
+            t.start[c] = _levels[index][c];
+        }
+    }
+    t.target[0] = r;
+    t.target[1] = g;
+    t.target[2] = b;
+    t.easing = easing;
+    t.start_time = nowMs();  // 現在時刻（ミリ秒）
+    t.duration_ms = duration_ms;
+    t.active = true;
+    core_util_atomic_fetch_or_u8(&_transition_active_mask, 1 << index);
     
+    // 新しいトランジションはキーフレーム再生より優先
+    if (_anim[index].active) {
+        _anim[index].active = false;
+        core_util_atomic_fetch_and_u8(&_anim_active_mask, (uint8_t)~(1 << index));
+    }
+}
+
+void RGBLEDDriver::drainMailbox() {
+    for (int i = 0; i < 4; i++) {
+        // 同じLEDに複数の送信元から要求があれば最後に発行されたものを採用
+        bool found = false;
+        TransitionRequest latest;
+        
+        for (int src = 0; src < RGB_SOURCE_COUNT; src++) {
+            const MailboxSlot& slot = _mailbox[src][i];
+            TransitionRequest req;
+            uint32_t seq;
+            bool valid = false;
+            for (;;) {
+                seq = slot.seq;
+                if (seq & 1) {
+                    break;  // 書き込み中（書き込み完了時のフラグで再度起床する）
+                }
+                __asm volatile ("" ::: "memory");
+                req = slot.request;
+                __asm volatile ("" ::: "memory");
+                if (seq == slot.seq) {
+                    valid = true;
+                    break;
+                }
+            }
+            if (!valid || seq == _mailbox_seen[src][i]) {
+                continue;
+            }
+            _mailbox_seen[src][i] = seq;
+            
+            if (!found || (int32_t)(req.stamp - latest.stamp) > 0) {
+                latest = req;
+                found = true;
+            }
+        }
+        
+        if (found) {
+            startTransition(i, latest.r, latest.g, latest.b, latest.duration_ms, latest.easing, latest.gamma);
+        }
+    }
+}
+
+bool RGBLEDDriver::requestOutputNotify(uint32_t tag) {
+    uint32_t head = _notify_head;
+    if (head - _notify_tail >= OUTPUT_NOTIFY_SLOTS) {
+        return false;
+    }
+    _notify_tags[head % OUTPUT_NOTIFY_SLOTS] = tag;
+    __asm volatile ("" ::: "memory");
+    _notify_head = head + 1;
+    _thread_flags.set(OUTPUT_FLAG_NOTIFY);
     return true;
 }
 
-void RGBLEDDriver::updateSSRLinkColors() {
+void RGBLEDDriver::completeOutputNotify() {
+    // 通知要求より前にメールボックスへ書かれた要求は、ここで取り出して出力まで済ませる
+    uint32_t head = _notify_head;
+    __asm volatile ("" ::: "memory");
+    drainMailbox();
+    updateTransitions();
+
+    while (_notify_tail != head) {
+        uint32_t tag = _notify_tags[_notify_tail % OUTPUT_NOTIFY_SLOTS];
+        __asm volatile ("" ::: "memory");
+        _notify_tail = _notify_tail + 1;
+        if (_output_notify) {
+            _output_notify(tag);
+        }
+    }
+}
+
+void RGBLEDDriver::onSSRDutyChange(uint8_t mask) {
+    // 割り込みコンテキストから呼ばれるため、フラグを立てるだけ
+    _thread_flags.set(mask & LINK_FLAG_SSR_MASK);
+}
+
+void RGBLEDDriver::requestSSRLinkRefresh() {
+    _thread_flags.set(LINK_FLAG_CONFIG);
+}
+
+void RGBLEDDriver::rebuildSSRLinkTables() {
+    for (int t = 0; t < SSR_LINK_TARGETS; t++) {
+        RGBColorData c0 = _config_manager->getSSRLinkTargetColor0(t);
+        RGBColorData c1 = _config_manager->getSSRLinkTargetColor100(t);
+        uint8_t curve = _config_manager->getSSRLinkCurve(t);
+
+        for (int duty = 0; duty <= 100; duty++) {
+            // カーブ適用後の補間位置（0-100）
+            int w;
+            switch (curve) {
+                case SSR_LINK_CURVE_EASE_IN:
+                    w = duty * duty / 100;
+                    break;
+                case SSR_LINK_CURVE_EASE_OUT:
+                    w = 100 - (100 - duty) * (100 - duty) / 100;
+                    break;
+                case SSR_LINK_CURVE_STEP:
+                    w = duty >= 50 ? 100 : 0;
+                    break;
+                case SSR_LINK_CURVE_LINEAR:
+                default:
+                    w = duty;
+                    break;
+            }
+            _link_table[t][duty].r = c0.r + (c1.r - c0.r) * w / 100;
+            _link_table[t][duty].g = c0.g + (c1.g - c0.g) * w / 100;
+            _link_table[t][duty].b = c0.b + (c1.b - c0.b) * w / 100;
+        }
+    }
+}
+
+void RGBLEDDriver::updateSSRLinkColors(uint32_t flags) {
     if (!_config_manager || !_config_manager->isSSRLinkEnabled()) {
         return;
     }
 
-    // SSR1（チャンネル1）のデューティ比を取得
-    static int last_duty = -1;  // 前回のデューティ比を保存
-    int duty = _ssr_driver.getDutyLevel(1);
+    // 色・リンク設定が変わっていればテーブルを作り直して全出力先を更新
+    bool refresh_all = (flags & LINK_FLAG_CONFIG) != 0;
+    uint32_t revision = _config_manager->getSSRLinkRevision();
+    if (revision != _link_table_revision) {
+        rebuildSSRLinkTables();
+        _link_table_revision = revision;
+        refresh_all = true;
+    }
+
+    uint16_t transition_ms = _config_manager->getSSRLinkTransitionTime();
+    for (int t = 0; t < SSR_LINK_TARGETS; t++) {
+        uint8_t ssr_id = _config_manager->getSSRLinkSource(t);
+        if (ssr_id == 0) {
+            continue;
+        }
+        if (!refresh_all && !(flags & (1u << (ssr_id - 1)))) {
+            continue;
+        }
+
+        int duty = _ssr_driver.getDutyLevel(ssr_id);
+        if (duty > 100) {
+            duty = 100;
+        }
+        if (!refresh_all && duty == _link_last_duty[t]) {
+            continue;
+        }
+        _link_last_duty[t] = duty;
+
+        const RGBColorData& c = _link_table[t][duty];
+        if (t < SSR_LINK_TARGET_WS2812) {
+            // RGB LEDはトランジション付きで設定（このスレッド内なので直接開始）
+            startTransition(t, c.r, c.g, c.b, transition_ms);
+        } else if (_ws2812_driver) {
+            // WS2812は系統全体をWS2812Driverの出力スレッドで更新（SPI転送でフェードを止めない）
+            uint8_t system = t - SSR_LINK_TARGET_WS2812 + 1;
+            _ws2812_driver->requestSystemColor(system, c.r, c.g, c.b);
+        }
+    }
+}
+
+void RGBLEDDriver::updateTransitions() {
+    uint32_t current_time = nowMs();
+
+    for (int i = 0; i < 4; i++) {
+        Transition& t = _transitions[i];
+        if (!t.active) continue;
+
+        uint32_t elapsed = current_time - t.start_time;
+        if (elapsed >= t.duration_ms) {
+            // トランジション完了
+            writeColor(i, t.target[0], t.target[1], t.target[2]);
+            t.active = false;
+            core_util_atomic_fetch_and_u8(&_transition_active_mask, (uint8_t)~(1 << i));
+        } else {
+            // トランジション中（進捗はQ16固定小数点、レベルは8.8固定小数点）
+            uint32_t linear_progress = (uint32_t)(((uint64_t)elapsed << 16) / t.duration_ms);
+            int32_t progress = (int32_t)applyEasing(t.easing, linear_progress);
+            uint16_t levels[3];
+            for (int c = 0; c < 3; c++) {
+                int32_t delta = ((int32_t)t.target[c] << 8) - (int32_t)t.start[c];
+                levels[c] = (uint16_t)(t.start[c] + (((int64_t)delta * progress) >> 16));
+            }
+            writeLevels(i, levels, true);
+        }
+    }
+}
+
+bool RGBLEDDriver::isAnimating() const {
+    for (int i = 0; i < 4; i++) {
+        if (_transitions[i].active || _anim[i].active) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RGBLEDDriver::loadKeyframes(uint8_t id, const RGBKeyframe* frames, uint8_t count, RGBKeyframeMode mode) {
+    // Check parameters
+    if (id < 1 || id > 4 || frames == nullptr || count < 1 || count > RGB_KEYFRAME_MAX ||
+        mode >= RGB_KEYFRAME_MODE_COUNT) {
+        return false;
+    }
+    for (int k = 0; k < count; k++) {
+        if (frames[k].easing >= RGB_EASE_COUNT) {
+            return false;
+        }
+        if (k > 0 && frames[k].time_ms < frames[k - 1].time_ms) {
+            return false;  // 時刻は昇順
+        }
+    }
+    
+    uint8_t index = id - 1;
+    {
+        ScopedLock<Mutex> lock(_anim_mutex);
+        KeyframeAnim& pending = _anim_pending[index];
+        pending.mode = mode;
+        pending.count = count;
+        memcpy(pending.frames, frames, count * sizeof(RGBKeyframe));
+        _anim_load_mask |= (1 << index);
+        _anim_stop_mask &= ~(1 << index);
+    }
+    core_util_atomic_fetch_or_u8(&_anim_active_mask, 1 << index);
+    
+    _thread_flags.set(KEYFRAME_FLAG_REQUEST);
+    return true;
+}
+
+bool RGBLEDDriver::stopKeyframes(uint8_t id) {
+    if (id < 1 || id > 4) {
+        return false;
+    }
     
-    // デューティ比が変更された場合のみ更新
-    if (duty != last_duty) {
-        ThisThread::sleep_for(5ms);  // 出力完了を待つ
-        last_duty = duty;
+    uint8_t index = id - 1;
+    {
+        ScopedLock<Mutex> lock(_anim_mutex);
+        _anim_stop_mask |= (1 << index);
+        _anim_load_mask &= ~(1 << index);
+    }
+    
+    _thread_flags.set(KEYFRAME_FLAG_REQUEST);
+    return true;
+}
+
+bool RGBLEDDriver::isKeyframeActive(uint8_t id) const {
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    return (_anim_active_mask & (1 << (id - 1))) != 0;
+}
+
+bool RGBLEDDriver::isTransitionActive(uint8_t id) const {
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    return (_transition_active_mask & (1 << (id - 1))) != 0;
+}
+
+void RGBLEDDriver::applyKeyframeRequests() {
+    ScopedLock<Mutex> lock(_anim_mutex);
+    
+    for (int i = 0; i < 4; i++) {
+        uint8_t bit = 1 << i;
+        if (_anim_stop_mask & bit) {
+            _anim[i].active = false;
+        }
+        if (_anim_load_mask & bit) {
+            _anim[i] = _anim_pending[i];
+            _anim[i].start_time = nowMs();
+            _anim[i].active = true;
+            _transitions[i].active = false;  // キーフレーム再生を優先
+            core_util_atomic_fetch_and_u8(&_transition_active_mask, (uint8_t)~bit);
+        }
+    }
+    _anim_stop_mask = 0;
+    _anim_load_mask = 0;
+    
+    uint8_t active = 0;
+    for (int i = 0; i < 4; i++) {
+        if (_anim[i].active) {
+            active |= (1 << i);
+        }
+    }
+    core_util_atomic_store_u8(&_anim_active_mask, active);
+}
+
+uint32_t RGBLEDDriver::applyEasing(uint8_t easing, uint32_t p) {
+    const uint32_t one = 1u << 16;
+    if (p >= one) {
+        return one;
+    }
+    if (easing == RGB_EASE_LINEAR || easing >= RGB_EASE_COUNT) {
+        return p;
+    }
+    
+    // 上位8ビットで区間を選び、下位8ビットで線形補間
+    const uint16_t* lut = EASING_LUT.v[easing];
+    uint32_t idx = p >> 8;
+    uint32_t frac = p & 0xFF;
+    int32_t v0 = lut[idx];
+    int32_t v1 = lut[idx + 1];
+    return (uint32_t)(v0 + (((v1 - v0) * (int32_t)frac) >> 8));
+}
+
+uint8_t RGBLEDDriver::getGamma(uint8_t id) const {
+    if (id < 1 || id > 4) {
+        return RGB_GAMMA_KEEP;
+    }
+    return _gamma[id - 1];
+}
+
+const char* RGBLEDDriver::getEasingName(uint8_t easing) {
+    static const char* const names[RGB_EASE_COUNT] = {
+        "linear", "in", "out", "s", "step",
+        "cubicin", "cubicout", "cubic", "sinein", "sineout", "sine"
+    };
+    return easing < RGB_EASE_COUNT ? names[easing] : "unknown";
+}
+
+int RGBLEDDriver::parseEasing(const char* name) {
+    if (isdigit((unsigned char)name[0])) {
+        int n = atoi(name);
+        return n < RGB_EASE_COUNT ? n : -1;
+    }
+    for (int i = 0; i < RGB_EASE_COUNT; i++) {
+        if (strcmp(name, getEasingName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* RGBLEDDriver::getGammaName(uint8_t gamma) {
+    static const char* const names[RGB_GAMMA_COUNT] = {"linear", "gamma22", "cie"};
+    return gamma < RGB_GAMMA_COUNT ? names[gamma] : "unknown";
+}
+
+int RGBLEDDriver::parseGamma(const char* name) {
+    for (int i = 0; i < RGB_GAMMA_COUNT; i++) {
+        if (strcmp(name, getGammaName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void RGBLEDDriver::updateKeyframes() {
+    uint32_t current_time = nowMs();
+    uint8_t finished = 0;
+    
+    for (int i = 0; i < 4; i++) {
+        KeyframeAnim& a = _anim[i];
+        if (!a.active) continue;
         
-        // 各RGB LEDに対して、SSR1の出力に応じて色を更新
-        for (int i = 1; i <= 4; i++) {
-            // 0%と100%の色を取得
-            RGBColorData color0 = _config_manager->getSSRLinkColor0(i);
-            RGBColorData color100 = _config_manager->getSSRLinkColor100(i);
-            
-            // デューティ比に応じて色を補間
-            uint8_t r = color0.r + (color100.r - color0.r) * duty / 100;
-            uint8_t g = color0.g + (color100.g - color0.g) * duty / 100;
-            uint8_t b = color0.b + (color100.b - color0.b) * duty / 100;
-            
-            // トランジション付きで色を設定
-            setColorWithTransition(i, r, g, b, _config_manager->getSSRLinkTransitionTime());
+        const RGBKeyframe* f = a.frames;
+        uint32_t total = f[a.count - 1].time_ms;
+        uint32_t t = current_time - a.start_time;
+        
+        // 再生位置を求める
+        if (a.mode == RGB_KEYFRAME_ONCE || total == 0) {
+            if (t >= total) {
+                // 再生完了: 最後の色を保持
+                writeColor(i, f[a.count - 1].r, f[a.count - 1].g, f[a.count - 1].b);
+                a.active = false;
+                finished |= (1 << i);
+                continue;
+            }
+        } else {
+            uint32_t period = (a.mode == RGB_KEYFRAME_PINGPONG) ? total * 2 : total;
+            if (t >= period) {
+                // 開始時刻を周期の整数倍だけ進めて経過時間の桁あふれを防ぐ
+                a.start_time += (t / period) * period;
+                t %= period;
+            }
+            if (t > total) {
+                t = period - t;  // 往復再生の復路
+            }
+        }
+        
+        // 区間を探す（f[k-1].time_ms <= t < f[k].time_ms）
+        int k = 1;
+        while (k < a.count && f[k].time_ms <= t) {
+            k++;
+        }
+        if (k >= a.count) {
+            writeColor(i, f[a.count - 1].r, f[a.count - 1].g, f[a.count - 1].b);
+            continue;
+        }
+        if (t < f[0].time_ms) {
+            writeColor(i, f[0].r, f[0].g, f[0].b);
+            continue;
         }
+        
+        const RGBKeyframe& from = f[k - 1];
+        const RGBKeyframe& to = f[k];
+        uint32_t span = to.time_ms - from.time_ms;
+        uint32_t progress = (uint32_t)(((uint64_t)(t - from.time_ms) << 16) / span);
+        int32_t w = (int32_t)applyEasing(to.easing, progress);
+        
+        // レベルは8.8固定小数点
+        const uint8_t c_from[3] = {from.r, from.g, from.b};
+        const uint8_t c_to[3] = {to.r, to.g, to.b};
+        uint16_t levels[3];
+        for (int c = 0; c < 3; c++) {
+            levels[c] = (uint16_t)((c_from[c] << 8) + (((c_to[c] - c_from[c]) * w) >> 8));
+        }
+        writeLevels(i, levels, true);
+    }
+    
+    if (finished) {
+        core_util_atomic_fetch_and_u8(&_anim_active_mask, (uint8_t)~finished);
     }
 }
 
+uint32_t RGBLEDDriver::nowMs() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        Kernel::Clock::now().time_since_epoch()).count();
+}
+
 void RGBLEDDriver::transitionThreadFunc() {
     while (_thread_running) {
-        uint32_t current_time = us_ticker_read() / 1000;  // 現在時刻（ミリ秒）
-        
-        // トランジションの更新
-        for (int i = 0; i < 4; i++) {
-            if (!_transitions[i].active) continue;
-            
-            Transition& t = _transitions[i];
-            uint32_t elapsed = current_time - t.start_time;
-            
-            if (elapsed >= t.duration_ms) {
-                // トランジション完了
-                setColor(i + 1, t.target_r, t.target_g, t.target_b);
-                t.active = false;
-            } else {
-                // トランジション中
-                float progress = (float)elapsed / t.duration_ms;
-                uint8_t r = t.start_r + (t.target_r - t.start_r) * progress;
-                uint8_t g = t.start_g + (t.target_g - t.start_g) * progress;
-                uint8_t b = t.start_b + (t.target_b - t.start_b) * progress;
-                setColor(i + 1, r, g, b);
-            }
+        // トランジション・キーフレーム再生中は更新間隔ごとに起床、なければイベントが来るまで待機
+        uint32_t flags;
+        if (isAnimating()) {
+            flags = _thread_flags.wait_any_for(THREAD_FLAGS_ALL, std::chrono::milliseconds(TRANSITION_UPDATE_INTERVAL_MS));
+        } else {
+            flags = _thread_flags.wait_any(THREAD_FLAGS_ALL);
+        }
+        if (flags & osFlagsError) {
+            flags = 0;  // タイムアウト（次のトランジションステップ）
         }
 
-        // SSR-LEDリンクの更新
-        updateSSRLinkColors();
-        
-        // 更新間隔を待機
-        ThisThread::sleep_for(TRANSITION_UPDATE_INTERVAL_MS);
+        // SSR-LEDリンクの更新（デューティ比変更・設定変更の通知があった場合のみ）
+        uint32_t link_flags = flags & (LINK_FLAG_SSR_MASK | LINK_FLAG_CONFIG);
+        if (link_flags != 0) {
+            updateSSRLinkColors(link_flags);
+        }
+
+        // 他スレッドからのトランジション要求を取り出す
+        if (flags & TRANSITION_FLAG_START) {
+            drainMailbox();
+        }
+
+        // キーフレームの読み込み・停止要求
+        if (flags & KEYFRAME_FLAG_REQUEST) {
+            applyKeyframeRequests();
+        }
+
+        // トランジション・キーフレームの更新
+        updateTransitions();
+        updateKeyframes();
+
+        // 書き込み完了の通知（トリガの遅延計測）
+        if (flags & OUTPUT_FLAG_NOTIFY) {
+            completeOutputNotify();
+        }
     }
-} 
\ No newline at end of file
+}
@@ -5,6 +5,93 @@
 #include "SSRDriver.h"
 #include "ConfigManager.h"
 
+class WS2812Driver;
+
+// PWM出力の量子化ビット数（16ビットの内部値との差分をディザリング）
+#define RGB_PWM_BITS 10
+#define RGB_PWM_MAX ((1 << RGB_PWM_BITS) - 1)
+#define RGB_DITHER_BITS (16 - RGB_PWM_BITS)
+
+// LED4（デジタル出力）のビット角度変調（BAM）の階調ビット数と最小スロット幅
+// 1フレーム = ((1 << BITS) - 1) * UNIT_US（既定 63 * 40us = 2.52ms、約400Hz）
+#ifndef RGB_LED4_BAM_BITS
+#define RGB_LED4_BAM_BITS 6
+#endif
+#ifndef RGB_LED4_BAM_UNIT_US
+#define RGB_LED4_BAM_UNIT_US 40
+#endif
+#define RGB_LED4_BAM_MAX ((1 << RGB_LED4_BAM_BITS) - 1)
+#define RGB_LED4_BAM_SHIFT (16 - RGB_LED4_BAM_BITS)
+
+// キーフレームアニメーションの最大キーフレーム数（LEDごと）
+#define RGB_KEYFRAME_MAX 16
+
+/**
+ * キーフレームアニメーションの再生モード
+ */
+enum RGBKeyframeMode : uint8_t {
+    RGB_KEYFRAME_ONCE = 0,      // 1回再生して最後の色を保持
+    RGB_KEYFRAME_LOOP,          // 最後まで再生したら先頭から繰り返し
+    RGB_KEYFRAME_PINGPONG,      // 往復再生
+    RGB_KEYFRAME_MODE_COUNT
+};
+
+/**
+ * キーフレーム間の補間カーブ
+ */
+enum RGBEasing : uint8_t {
+    RGB_EASE_LINEAR = 0,        // 線形
+    RGB_EASE_IN,                // 2乗（ゆっくり始まる）
+    RGB_EASE_OUT,               // 逆2乗（ゆっくり終わる）
+    RGB_EASE_IN_OUT,            // Sカーブ
+    RGB_EASE_STEP,              // 補間なし（キーフレーム時刻で切り替え）
+    RGB_EASE_CUBIC_IN,          // 3乗（ゆっくり始まる）
+    RGB_EASE_CUBIC_OUT,         // 逆3乗（ゆっくり終わる）
+    RGB_EASE_CUBIC_IN_OUT,      // 3乗のSカーブ
+    RGB_EASE_SINE_IN,           // 正弦（ゆっくり始まる）
+    RGB_EASE_SINE_OUT,          // 正弦（ゆっくり終わる）
+    RGB_EASE_SINE_IN_OUT,       // 正弦のSカーブ
+    RGB_EASE_COUNT
+};
+
+/**
+ * 出力ガンマ（色値0-255→LEDの明るさ）
+ * LEDごとに保持し、トランジション開始時に切り替えられる
+ */
+enum RGBGamma : uint8_t {
+    RGB_GAMMA_LINEAR = 0,       // 色値に比例したデューティ比（従来の出力）
+    RGB_GAMMA_POWER22,          // 2.2乗
+    RGB_GAMMA_CIE,              // CIE L*（知覚的に均等な明るさ）
+    RGB_GAMMA_COUNT,
+    RGB_GAMMA_KEEP = 0xFF       // 現在のガンマを維持（setColorWithTransition用）
+};
+
+// 起動時の出力ガンマ
+#ifndef RGB_DEFAULT_GAMMA
+#define RGB_DEFAULT_GAMMA RGB_GAMMA_POWER22
+#endif
+
+/**
+ * キーフレーム
+ */
+struct RGBKeyframe {
+    uint32_t time_ms;           // アニメーション開始からの時刻（昇順）
+    uint8_t r, g, b;
+    uint8_t easing;             // 直前のキーフレームからこのキーフレームまでの補間（RGBEasing）
+};
+
+/**
+ * トランジション要求の送信元
+ * 送信元ごとに専用のメールボックスを持つため、各送信元は単一スレッドから呼び出すこと
+ */
+enum RGBCommandSource : uint8_t {
+    RGB_SOURCE_UDP = 0,     // UDPスレッド
+    RGB_SOURCE_SERIAL,      // シリアルスレッド
+    RGB_SOURCE_IDLE,        // IdleAnimatorのイベントスレッド
+    RGB_SOURCE_ACTUATOR,    // ActuatorControllerのスレッド（ミスト・エアー・RGBパルス）
+    RGB_SOURCE_COUNT
+};
+
 /**
  * RGB LED Driver Class
  * Provides functionality to control 3 RGB LED strips
@@ -41,25 +128,30 @@ public:
     
     /**
      * Set the color of the specified RGB LED
+     * 0msのトランジションとしてメールボックス経由でトランジションスレッドが出力する
+     * （実行中のトランジション・キーフレーム再生は置き換わる）
      * @param id RGB LED number (1-4)
      * @param r Red intensity (0-255)
      * @param g Green intensity (0-255)
      * @param b Blue intensity (0-255)
+     * @param source 送信元（setColorWithTransitionと同じ）
      * @return true if successful, false if failed
      */
-    bool setColor(uint8_t id, uint8_t r, uint8_t g, uint8_t b);
+    bool setColor(uint8_t id, uint8_t r, uint8_t g, uint8_t b, RGBCommandSource source = RGB_SOURCE_UDP);
     
     /**
      * Turn off the specified RGB LED
      * @param id RGB LED number (1-4)
+     * @param source 送信元
      * @return true if successful, false if failed
      */
-    bool turnOff(uint8_t id);
+    bool turnOff(uint8_t id, RGBCommandSource source = RGB_SOURCE_UDP);
     
     /**
      * Turn off all RGB LEDs
+     * @param source 送信元
      */
-    void allOff();
+    void allOff(RGBCommandSource source = RGB_SOURCE_UDP);
     
     /**
      * Get the current color of the specified RGB LED
@@ -84,13 +176,64 @@ public:
      * @param target_g 目標の緑色値 (0-255)
      * @param target_b 目標の青色値 (0-255)
      * @param transition_ms 変化にかける時間（ミリ秒）
+     * @param source 送信元（送信元ごとのメールボックスにロックなしで書き込み、トランジションスレッドが取り出す）
+     * @param easing 時間に対する補間カーブ（RGBEasing）
+     * @param gamma このトランジション以降の出力ガンマ（RGBGamma、RGB_GAMMA_KEEPで維持）
+     * @return true if successful, false if failed
+     */
+    bool setColorWithTransition(uint8_t id, uint8_t target_r, uint8_t target_g, uint8_t target_b, uint16_t transition_ms,
+                                RGBCommandSource source = RGB_SOURCE_UDP,
+                                uint8_t easing = RGB_EASE_LINEAR, uint8_t gamma = RGB_GAMMA_KEEP);
+
+    /**
+     * 出力ガンマを取得
+     * @param id RGB LED number (1-4)
+     * @return RGBGamma（不正なidはRGB_GAMMA_KEEP）
+     */
+    uint8_t getGamma(uint8_t id) const;
+
+    // 補間カーブ・ガンマの名前変換
+    static const char* getEasingName(uint8_t easing);
+    static int parseEasing(const char* name);  // 名前または番号、不正な名前は-1
+    static const char* getGammaName(uint8_t gamma);
+    static int parseGamma(const char* name);   // 不正な名前は-1
+
+    /**
+     * キーフレームアニメーションを読み込んで再生を開始
+     * トランジションスレッドで再生するため、ホストからの連続送信は不要。
+     * 同じLEDへの新しいトランジションまたはstopKeyframes()で停止する。
+     * @param id RGB LED number (1-4)
+     * @param frames キーフレーム（time_msの昇順）
+     * @param count キーフレーム数 (1-RGB_KEYFRAME_MAX)
+     * @param mode 再生モード
      * @return true if successful, false if failed
      */
-    bool setColorWithTransition(uint8_t id, uint8_t target_r, uint8_t target_g, uint8_t target_b, uint16_t transition_ms);
+    bool loadKeyframes(uint8_t id, const RGBKeyframe* frames, uint8_t count, RGBKeyframeMode mode);
+
+    /**
+     * キーフレームアニメーションを停止（現在の色を保持）
+     * @param id RGB LED number (1-4)
+     * @return true if successful, false if failed
+     */
+    bool stopKeyframes(uint8_t id);
+
+    /**
+     * キーフレームアニメーションの再生状態を取得
+     * @param id RGB LED number (1-4)
+     * @return true if playing (or about to start)
+     */
+    bool isKeyframeActive(uint8_t id) const;
+
+    /**
+     * トランジション（fade・SSR連動の色変化）の実行状態を取得
+     * @param id RGB LED number (1-4)
+     * @return true if a transition is in progress
+     */
+    bool isTransitionActive(uint8_t id) const;
 
     /**
-     * トランジションの更新処理
-     * 定期的に呼び出す必要がある
+     * トランジションを現在時刻まで進める
+     * トランジションスレッドから呼ばれる（トランジション中のみ100Hz、完了後は停止）
      */
     void updateTransitions();
 
@@ -102,15 +245,71 @@ public:
         _config_manager = config_manager;
     }
 
+    /**
+     * Set the WS2812 driver used for WS2812 link targets
+     * @param ws2812_driver Pointer to the WS2812 driver (nullptr to disable)
+     */
+    void setWS2812Driver(WS2812Driver* ws2812_driver) {
+        _ws2812_driver = ws2812_driver;
+    }
+
+    /**
+     * SSR連動の再計算を要求（リンク設定・色を変更した後に呼び出す）
+     * 補間テーブルを作り直し、全出力先を現在のデューティ比で更新する
+     */
+    void requestSSRLinkRefresh();
+
+    /**
+     * 出力の書き込み完了の通知を要求（トリガの遅延計測用）
+     * これより前に発行した要求をトランジションスレッドが出力に書き込んだ後、通知関数にtagを渡す
+     * 書き込み側は1つのため、呼び出し側で直列化すること
+     * @param tag 通知関数に渡す値（受信時刻など）
+     * @return true if queued, false if too many notifications are pending
+     */
+    bool requestOutputNotify(uint32_t tag);
+
+    /**
+     * 書き込み完了の通知関数を設定（トランジションスレッドから呼ばれる）
+     * @param notify 通知関数（requestOutputNotifyのtag）
+     */
+    void setOutputNotifyCallback(Callback<void(uint32_t)> notify) {
+        _output_notify = notify;
+    }
+
 private:
     // RGB LED control PWM pins
     PwmOut* _rgb_pins[4][3]; // [LED number][color (R,G,B)]
     
-    // LED4用のデジタル出力ピン（2値制御用）
+    // LED4用のデジタル出力ピン（BAMで階調制御）
     DigitalOut* _led4_digital_pins[3]; // [color (R,G,B)]
+
+    // LED4のBAM（Timeoutの連鎖で1フレームあたりRGB_LED4_BAM_BITS回の割り込み）
+    // 目標値はスレッドが書き、割り込みはフレーム先頭でのみ取り込む
+    Timeout _led4_bam_timeout;
+    volatile uint16_t _led4_target[3];   // 16ビット線形値
+    volatile bool _led4_dither;          // フレーム間の誤差拡散（アニメーション中のみ）
+    volatile bool _led4_bam_running;     // BAM割り込みの連鎖が動作中か（トランジションスレッドのみが変更）
+    uint8_t _led4_frame[3];              // 現在のフレームの階調値（割り込みのみ）
+    uint16_t _led4_bam_err[3];           // フレーム間の誤差アキュムレータ（割り込みのみ）
+    uint8_t _led4_bam_bit;               // 次に出力するビット（割り込みのみ）
     
-    // Current color state
+    // Current color state（以下の出力状態はトランジションスレッドのみが書き込む）
     uint8_t _colors[4][3]; // [LED number][color (R,G,B)]
+
+    // 内部の色レベル（8.8固定小数点、0xFF00=255）。トランジション中は8ビット未満の変化も保持
+    uint16_t _levels[4][3];
+
+    // ディザリングの誤差アキュムレータ（16ビット線形値のうちPWMで表せない下位ビット）
+    uint16_t _dither_err[4][3];
+
+    // 最後に書き込んだPWM値（RGB_PWM_BITS）。変化したチャンネルのみ書き込む
+    uint16_t _pwm_out[4][3];
+
+    // 最後に出力した16ビット線形値（ガンマ切り替え時の開始レベル算出用）
+    uint16_t _linear[4][3];
+
+    // LEDごとの出力ガンマ（RGBGamma）
+    uint8_t _gamma[4];
     
     // PWM period (microseconds)
     uint32_t _period_us;
@@ -121,16 +320,57 @@ private:
     // トランジション制御用の構造体
     struct Transition {
         bool active;
-        uint8_t start_r, start_g, start_b;
-        uint8_t target_r, target_g, target_b;
+        uint16_t start[3];      // 開始レベル（8.8固定小数点）
+        uint8_t target[3];      // 目標色
+        uint8_t easing;         // 補間カーブ（RGBEasing）
         uint32_t start_time;
         uint32_t duration_ms;
     };
 
-    // 各LEDのトランジション状態
+    // 各LEDのトランジション状態（トランジションスレッドのみが読み書き）
     Transition _transitions[4];
 
-    // トランジションの更新間隔（ミリ秒）
+    // トランジション要求のメールボックス（送信元×LED、送信元ごとに単一の書き込みスレッド）
+    // 書き込み側はseqを奇数にしてから内容を書き、偶数に戻して公開する。最新の要求のみ保持
+    struct TransitionRequest {
+        uint32_t stamp;          // 全送信元共通の発行順（同じLEDへの要求の前後判定用）
+        uint8_t r, g, b;
+        uint8_t easing;
+        uint8_t gamma;
+        uint16_t duration_ms;
+    };
+    struct MailboxSlot {
+        volatile uint32_t seq;   // シーケンス番号（奇数は書き込み中）
+        TransitionRequest request;
+    };
+    MailboxSlot _mailbox[RGB_SOURCE_COUNT][4];
+    uint32_t _mailbox_seen[RGB_SOURCE_COUNT][4];  // 取り出し済みのseq（トランジションスレッドのみ）
+    volatile uint32_t _mailbox_stamp;
+
+    // 書き込み完了の通知要求（要求側が_notify_headを、トランジションスレッドが_notify_tailを進める）
+    static const uint32_t OUTPUT_NOTIFY_SLOTS = 8;
+    uint32_t _notify_tags[OUTPUT_NOTIFY_SLOTS];
+    volatile uint32_t _notify_head;
+    volatile uint32_t _notify_tail;
+    Callback<void(uint32_t)> _output_notify;
+
+    // キーフレームアニメーション
+    struct KeyframeAnim {
+        bool active;
+        uint8_t mode;           // RGBKeyframeMode
+        uint8_t count;
+        uint32_t start_time;    // 再生開始時刻（ミリ秒、ループごとに進める）
+        RGBKeyframe frames[RGB_KEYFRAME_MAX];
+    };
+    KeyframeAnim _anim[4];                  // 再生中（トランジションスレッドのみ）
+    KeyframeAnim _anim_pending[4];          // 読み込み待ち（_anim_mutexで保護）
+    Mutex _anim_mutex;                      // 読み込み・停止要求の排他（頻度の低いコマンドのみ）
+    uint8_t _anim_load_mask;                // 読み込み待ちのLED（_anim_mutexで保護）
+    uint8_t _anim_stop_mask;                // 停止要求のLED（_anim_mutexで保護）
+    volatile uint8_t _anim_active_mask;     // 再生中のLED（状態取得用）
+    volatile uint8_t _transition_active_mask;  // トランジション中のLED（状態取得用）
+
+    // トランジションの更新間隔（ミリ秒、トランジション中のみ）
     static const uint32_t TRANSITION_UPDATE_INTERVAL_MS = 10;  // 100Hz
 
     // スレッド関連のメンバー
@@ -141,12 +381,77 @@ private:
     // SSRドライバーとコンフィグマネージャーの参照
     SSRDriver& _ssr_driver;
     ConfigManager* _config_manager;
+    WS2812Driver* _ws2812_driver = nullptr;
+
+    // トランジションスレッドへのイベント
+    // bit0-3: デューティ比が変化したSSR1-4、bit4: リンク設定変更、bit5: トランジション開始、bit6: 停止、
+    // bit7: キーフレームの読み込み・停止要求、bit8: 書き込み完了の通知要求
+    static const uint32_t LINK_FLAG_SSR_MASK = 0x0F;
+    static const uint32_t LINK_FLAG_CONFIG = 0x10;
+    static const uint32_t TRANSITION_FLAG_START = 0x20;
+    static const uint32_t THREAD_FLAG_STOP = 0x40;
+    static const uint32_t KEYFRAME_FLAG_REQUEST = 0x80;
+    static const uint32_t OUTPUT_FLAG_NOTIFY = 0x100;
+    static const uint32_t THREAD_FLAGS_ALL = 0x1FF;
+    EventFlags _thread_flags;
+
+    // 出力先ごとのデューティ比(0-100)→色の補間テーブル（リンク設定の変更時に再計算）
+    RGBColorData _link_table[SSR_LINK_TARGETS][101];
+    uint32_t _link_table_revision;
+    int16_t _link_last_duty[SSR_LINK_TARGETS];  // 出力先ごとの前回反映値（-1=未反映）
 
     // トランジション更新用のスレッド関数
     void transitionThreadFunc();
 
-    // SSRの状態に基づいてLEDの色を更新
-    void updateSSRLinkColors();
+    // 色レベル（8.8固定小数点）を出力（トランジションスレッド専用）
+    // ガンマテーブルで線形値に変換し、ditherがtrueなら誤差を次回へ繰り越す（アニメーション中の更新用）
+    void writeLevels(uint8_t index, const uint16_t levels[3], bool dither);
+
+    // 静止した色をディザリングなしで出力（トランジションスレッド専用）
+    void writeColor(uint8_t index, uint8_t r, uint8_t g, uint8_t b);
+
+    // LED4の出力方式を更新（全チャンネルが消灯/全点灯ならBAMを止めて直接出力、トランジションスレッド専用）
+    void updateLED4Output(bool dither);
+
+    // LED4のBAMスロット割り込み
+    void led4BamHandler();
+
+    // 16ビット線形値から指定ガンマでの色レベル（8.8固定小数点）を逆算
+    static uint16_t levelFromLinear(uint8_t gamma, uint16_t linear);
+
+    // 実行中のトランジション・キーフレームアニメーションがあるか
+    bool isAnimating() const;
+
+    // トランジションを開始（トランジションスレッド専用）
+    void startTransition(uint8_t index, uint8_t r, uint8_t g, uint8_t b, uint16_t duration_ms,
+                         uint8_t easing = RGB_EASE_LINEAR, uint8_t gamma = RGB_GAMMA_KEEP);
+
+    // メールボックスの新しい要求を取り出してトランジションを開始
+    void drainMailbox();
+
+    // 要求済みの出力を書き込んでから完了を通知（トランジションスレッド専用）
+    void completeOutputNotify();
+
+    // キーフレームの読み込み・停止要求を反映（トランジションスレッド専用）
+    void applyKeyframeRequests();
+
+    // キーフレームアニメーションを現在時刻まで進める（トランジションスレッド専用）
+    void updateKeyframes();
+
+    // 補間カーブを適用（進捗・戻り値ともQ16固定小数点、コンパイル時に生成したテーブルを補間）
+    static uint32_t applyEasing(uint8_t easing, uint32_t progress_q16);
+
+    // 現在時刻（ミリ秒、32ビットで巡回）
+    static uint32_t nowMs();
+
+    // SSRDriverからのデューティ比変更通知（割り込みコンテキストからも呼ばれる）
+    void onSSRDutyChange(uint8_t mask);
+
+    // 要求されたSSRに連動する出力先の色を更新
+    void updateSSRLinkColors(uint32_t flags);
+
+    // 補間テーブルを再計算
+    void rebuildSSRLinkTables();
 };
 
 #endif // RGB_LED_DRIVER_H 
\ No newline at end of file
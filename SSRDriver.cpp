@@ -24,7 +24,46 @@ SSRDriver::SSRDriver(PinName ssr1, PinName ssr2, PinName ssr3, PinName ssr4)
         _ssr_period[i] = 0;
         _time_on_count[i] = 0;
     }
+    
+    // ランプ状態の初期化
+    for (int i = 0; i < 4; i++) {
+        _ramp[i].active = false;
+        _ramp[i].start_level = 0;
+        _ramp[i].target_level = 0;
+        _ramp[i].curve = SSR_RAMP_LINEAR;
+        _ramp[i].total_steps = 0;
+        _ramp[i].step = 0;
+    }
+    
+    // 制御ブロックの初期化
+    for (int b = 0; b < 2; b++) {
+        _ctrl_block[b].mask = 0;
+        memset(_ctrl_block[b].duty, 0, sizeof(_ctrl_block[b].duty));
+    }
+    _ctrl_pending = 0;
+    _ctrl_next = 0;
+    
+    // 波形再生状態の初期化
+    for (int i = 0; i < 4; i++) {
+        _wave[i].active = false;
+        _wave[i].loop = false;
+        _wave[i].length = 0;
+        _wave[i].position = 0;
+        _wave[i].divider = 1;
+        _wave[i].dwell = 0;
+        memset(_wave[i].table, 0, sizeof(_wave[i].table));
+    }
 
+    // 点弧ジッタ統計の初期化
+    for (int i = 0; i < 4; i++) {
+        _jitter[i].seq = 0;
+        _jitter[i].reset_request = false;
+        clearJitterStats(_jitter[i].stats);
+    }
+    
+    // 割り込みハンドラ計測用のサイクルカウンタを有効化
+    IsrProfiler::enableCycleCounter();
+    
     // ゼロクロス検出用InterruptIn初期化（立ち上がりエッジのみ、プルアップ設定）
     _zerox_in.rise(callback(this, &SSRDriver::zeroxEdgeHandler));
     _zerox_in.mode(PullUp);  // P3_9をプルアップ設定
@@ -103,10 +142,13 @@ bool SSRDriver::getState(uint8_t id) {
 
 void SSRDriver::allOff() {
     // Turn off all SSRs
+    const uint8_t levels[4] = {0, 0, 0, 0};
     for (int i = 0; i < 4; i++) {
+        core_util_atomic_store_bool(&_ramp[i].active, false);
+        core_util_atomic_store_bool(&_wave[i].active, false);
         _state[i] = false;
-        _duty_level[i] = 0;
     }
+    publishDutyLevels(0x0F, levels);
 }
 
 bool SSRDriver::setDutyLevel(uint8_t id, uint8_t level) {
@@ -120,19 +162,396 @@ bool SSRDriver::setDutyLevel(uint8_t id, uint8_t level) {
     }
     
     uint8_t index = id - 1;
-    _duty_level[index] = level;
     
-    _time_on_count[index] = (_ssr_period[index] * level) / 100;
+    // 明示的な設定は実行中のランプ・波形再生より優先
+    core_util_atomic_store_bool(&_ramp[index].active, false);
+    core_util_atomic_store_bool(&_wave[index].active, false);
+    
+    // 次のゼロクロスで適用（割り込み側で_duty_levelと_time_on_countを更新）
+    uint8_t levels[4] = {0, 0, 0, 0};
+    levels[index] = level;
+    publishDutyLevels(1 << index, levels);
+    
+    return true;
+}
+
+bool SSRDriver::setAllDutyLevels(uint8_t mask, const uint8_t levels[4]) {
+    // Check mask
+    mask &= 0x0F;
+    if (mask == 0 || levels == nullptr) {
+        return false;
+    }
+    
+    uint8_t clamped[4];
+    for (int i = 0; i < 4; i++) {
+        clamped[i] = levels[i] > 100 ? 100 : levels[i];
+        if (mask & (1 << i)) {
+            core_util_atomic_store_bool(&_ramp[i].active, false);
+            core_util_atomic_store_bool(&_wave[i].active, false);
+        }
+    }
+    
+    // 全チャンネルを同じゼロクロスで適用
+    publishDutyLevels(mask, clamped);
+    
+    return true;
+}
+
+// 制御ブロックを公開（スレッドコンテキスト）
+// 未適用のブロックがあれば取り戻して統合し、空いている方のバッファに書いてから番号を公開する
+void SSRDriver::publishDutyLevels(uint8_t mask, const uint8_t levels[4]) {
+    {
+        ScopedLock<Mutex> lock(_ctrl_mutex);
+        
+        uint8_t prev = core_util_atomic_exchange_u8(&_ctrl_pending, 0);
+        SSRControlBlock& next = _ctrl_block[_ctrl_next];
+        if (prev != 0) {
+            next = _ctrl_block[prev - 1];
+        } else {
+            next.mask = 0;
+        }
+        
+        for (int i = 0; i < 4; i++) {
+            if (mask & (1 << i)) {
+                next.duty[i] = levels[i];
+                next.mask |= (1 << i);
+            }
+        }
+        
+        core_util_atomic_store_u8(&_ctrl_pending, _ctrl_next + 1);
+        _ctrl_next ^= 1;
+    }
+    
+    // 通知はロック外で（getDutyLevel()は適用待ちの値を返すため、受け手はすぐに新しい値を読める）
+    notifyDutyChange(mask);
+}
+
+// 適用待ちのデューティ比を取り消す（ランプ・波形開始時に古い設定で上書きされないように）
+bool SSRDriver::retractPendingDuty(uint8_t index, uint8_t& level) {
+    ScopedLock<Mutex> lock(_ctrl_mutex);
+    
+    uint8_t prev = core_util_atomic_exchange_u8(&_ctrl_pending, 0);
+    if (prev == 0) {
+        return false;
+    }
+    
+    SSRControlBlock& block = _ctrl_block[prev - 1];
+    bool found = (block.mask & (1 << index)) != 0;
+    if (found) {
+        level = block.duty[index];
+        block.mask &= ~(1 << index);
+    }
+    
+    // 他のチャンネルが残っていれば再公開
+    if (block.mask != 0) {
+        core_util_atomic_store_u8(&_ctrl_pending, prev);
+    }
+    
+    return found;
+}
+
+bool SSRDriver::peekPendingDuty(uint8_t index, uint8_t& level) {
+    ScopedLock<Mutex> lock(_ctrl_mutex);
+    
+    uint8_t pending = core_util_atomic_load_u8(&_ctrl_pending);
+    if (pending == 0) {
+        return false;
+    }
+    
+    const SSRControlBlock& block = _ctrl_block[pending - 1];
+    if (block.mask & (1 << index)) {
+        level = block.duty[index];
+        return true;
+    }
+    return false;
+}
+
+// 制御ブロックを適用（割り込みコンテキスト、ロックなし）
+void SSRDriver::applyPendingControl() {
+    uint8_t pending = core_util_atomic_exchange_u8(&_ctrl_pending, 0);
+    if (pending == 0) {
+        return;
+    }
+    
+    const SSRControlBlock& block = _ctrl_block[pending - 1];
+    for (int i = 0; i < 4; i++) {
+        if (block.mask & (1 << i)) {
+            _ramp[i].active = false;
+            _wave[i].active = false;
+            _duty_level[i] = block.duty[i];
+            _time_on_count[i] = (_ssr_period[i] * block.duty[i]) / 100;
+        }
+    }
+}
+
+bool SSRDriver::startRamp(uint8_t id, uint8_t target_level, uint32_t duration_ms, SSRRampCurve curve) {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    // Check curve
+    if (curve >= SSR_RAMP_CURVE_COUNT) {
+        return false;
+    }
+    // Check level (0-100)
+    if (target_level > 100) {
+        target_level = 100;
+    }
+    
+    uint8_t index = id - 1;
+    
+    // 半周期数に換算（ゼロクロス制御ハンドラは半周期ごとに呼ばれる）
+    float power_freq = getPowerLineFrequency();
+    uint32_t total_steps = (uint32_t)(duration_ms * power_freq * 2.0f / 1000.0f + 0.5f);
+    
+    if (total_steps == 0) {
+        // 0msまたは半周期未満は即座に反映
+        return setDutyLevel(id, target_level);
+    }
+    
+    // 一旦停止してからパラメータを書き換え、最後に有効化する
+    // （割り込みは有効フラグを見てからパラメータを読む）
+    core_util_atomic_store_bool(&_wave[index].active, false);
+    core_util_atomic_store_bool(&_ramp[index].active, false);
+    
+    // 適用待ちの設定があればそこから開始（後から適用されてランプが止まらないように）
+    uint8_t start_level = _duty_level[index];
+    retractPendingDuty(index, start_level);
+    
+    _ramp[index].start_level = start_level;
+    _ramp[index].target_level = target_level;
+    _ramp[index].curve = curve;
+    _ramp[index].total_steps = total_steps;
+    _ramp[index].step = 0;
+    core_util_atomic_store_bool(&_ramp[index].active, true);
     
     return true;
 }
 
+bool SSRDriver::stopRamp(uint8_t id) {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    core_util_atomic_store_bool(&_ramp[id - 1].active, false);
+    return true;
+}
+
+bool SSRDriver::isRampActive(uint8_t id) const {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    return _ramp[id - 1].active;
+}
+
+bool SSRDriver::loadWaveform(uint8_t id, uint16_t offset, const uint8_t* values, uint16_t count) {
+    // Check id
+    if (id < 1 || id > 4 || values == nullptr) {
+        return false;
+    }
+    // Check range
+    if ((uint32_t)offset + count > SSR_WAVE_MAX_POINTS) {
+        return false;
+    }
+    
+    Waveform& w = _wave[id - 1];
+    
+    // 再生中のテーブルは書き換えない（割り込みとの競合防止）
+    if (w.active) {
+        return false;
+    }
+    
+    for (uint16_t i = 0; i < count; i++) {
+        w.table[offset + i] = values[i] > 100 ? 100 : values[i];
+    }
+    if (offset + count > w.length) {
+        w.length = offset + count;
+    }
+    
+    return true;
+}
+
+bool SSRDriver::clearWaveform(uint8_t id) {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    Waveform& w = _wave[id - 1];
+    core_util_atomic_store_bool(&w.active, false);
+    w.length = 0;
+    w.position = 0;
+    
+    return true;
+}
+
+bool SSRDriver::playWaveform(uint8_t id, uint16_t divider, bool loop) {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    uint8_t index = id - 1;
+    Waveform& w = _wave[index];
+    
+    // テーブルが空、または分周比が無効な場合はエラー
+    if (w.length == 0 || divider == 0) {
+        return false;
+    }
+    
+    // ランプとは排他
+    core_util_atomic_store_bool(&_ramp[index].active, false);
+    core_util_atomic_store_bool(&w.active, false);
+    
+    // 適用待ちの設定は破棄（後から適用されて再生が止まらないように）
+    uint8_t discarded;
+    retractPendingDuty(index, discarded);
+    w.loop = loop;
+    w.divider = divider;
+    w.position = 0;
+    w.dwell = 0;
+    core_util_atomic_store_bool(&w.active, true);
+    
+    return true;
+}
+
+bool SSRDriver::stopWaveform(uint8_t id) {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    core_util_atomic_store_bool(&_wave[id - 1].active, false);
+    return true;
+}
+
+bool SSRDriver::getWaveformStatus(uint8_t id, uint16_t& length, uint16_t& position, bool& playing) const {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    const Waveform& w = _wave[id - 1];
+    length = w.length;
+    position = w.position;
+    playing = w.active;
+    
+    return true;
+}
+
+uint32_t SSRDriver::applyRampCurve(uint8_t curve, uint32_t p) {
+    // p: 0〜32768（Q15）
+    switch (curve) {
+        case SSR_RAMP_EASE_IN:
+            return (p * p) >> 15;
+        case SSR_RAMP_EASE_OUT: {
+            uint32_t q = 32768 - p;
+            return 32768 - ((q * q) >> 15);
+        }
+        case SSR_RAMP_S_CURVE: {
+            // smoothstep: 3p^2 - 2p^3
+            uint32_t p2 = (p * p) >> 15;
+            uint32_t p3 = (p2 * p) >> 15;
+            return 3 * p2 - 2 * p3;
+        }
+        case SSR_RAMP_LINEAR:
+        default:
+            return p;
+    }
+}
+
+// ランプを1ステップ進める（割り込みコンテキスト、浮動小数点演算なし）
+uint8_t SSRDriver::advanceRamps() {
+    uint8_t changed = 0;
+    for (int i = 0; i < 4; i++) {
+        Ramp& r = _ramp[i];
+        if (!r.active) {
+            continue;
+        }
+        
+        r.step++;
+        uint8_t level;
+        if (r.step >= r.total_steps) {
+            level = r.target_level;
+            r.active = false;
+        } else {
+            uint32_t progress = (uint32_t)(((uint64_t)r.step << 15) / r.total_steps);
+            int32_t delta = (int32_t)r.target_level - (int32_t)r.start_level;
+            int32_t eased = (int32_t)applyRampCurve(r.curve, progress);
+            level = (uint8_t)(r.start_level + ((delta * eased) >> 15));
+        }
+        
+        if (_duty_level[i] != level) {
+            changed |= (1 << i);
+        }
+        _duty_level[i] = level;
+        _time_on_count[i] = (_ssr_period[i] * level) / 100;
+    }
+    return changed;
+}
+
+// 波形を1ステップ進める（割り込みコンテキスト）
+uint8_t SSRDriver::advanceWaveforms() {
+    uint8_t changed = 0;
+    for (int i = 0; i < 4; i++) {
+        Waveform& w = _wave[i];
+        if (!w.active) {
+            continue;
+        }
+        
+        // 現在の点の出力期間中
+        if (w.dwell > 0) {
+            w.dwell--;
+            continue;
+        }
+        
+        // テーブル末尾に到達
+        if (w.position >= w.length) {
+            if (!w.loop) {
+                // ワンショット: 最後の値を保持して終了
+                w.active = false;
+                continue;
+            }
+            w.position = 0;
+        }
+        
+        uint8_t level = w.table[w.position++];
+        w.dwell = w.divider - 1;
+        
+        if (_duty_level[i] != level) {
+            changed |= (1 << i);
+        }
+        _duty_level[i] = level;
+        _time_on_count[i] = (_ssr_period[i] * level) / 100;
+    }
+    return changed;
+}
+
+void SSRDriver::setDutyChangeCallback(Callback<void(uint8_t)> cb) {
+    _duty_change_cb = cb;
+}
+
+void SSRDriver::notifyDutyChange(uint8_t mask) {
+    if (mask != 0 && _duty_change_cb) {
+        _duty_change_cb(mask);
+    }
+}
+
 uint8_t SSRDriver::getDutyLevel(uint8_t id) {
     // Check id
     if (id < 1 || id > 4) {
         return 0;
     }
     
+    // 適用待ちの設定があればそれを返す
+    uint8_t level;
+    if (peekPendingDuty(id - 1, level)) {
+        return level;
+    }
+    
     // Return current duty cycle level
     return _duty_level[id - 1];
 }
@@ -174,7 +593,7 @@ bool SSRDriver::getSSRStatus(uint8_t id, uint8_t& duty_level, bool& state, uint3
     }
     
     uint8_t index = id - 1;
-    duty_level = _duty_level[index];
+    duty_level = getDutyLevel(id);
     state = _state[index];
     period = _ssr_period[index];
     
@@ -244,8 +663,9 @@ float SSRDriver::getPowerLineFrequency() const {
     
     // 履歴から有効な間隔を計算
     for (int i = 0; i < FREQ_HISTORY_SIZE; i++) {
-        uint32_t current_index = (_zerox_history_index - 1 - i + FREQ_HISTORY_SIZE) % FREQ_HISTORY_SIZE;
-        uint32_t prev_index = (_zerox_history_index - 2 - i + FREQ_HISTORY_SIZE) % FREQ_HISTORY_SIZE;
+        // iは最大FREQ_HISTORY_SIZE-1なので、負にならないよう2周分を加算してから剰余を取る
+        uint32_t current_index = (_zerox_history_index + 2 * FREQ_HISTORY_SIZE - 1 - i) % FREQ_HISTORY_SIZE;
+        uint32_t prev_index = (_zerox_history_index + 2 * FREQ_HISTORY_SIZE - 2 - i) % FREQ_HISTORY_SIZE;
         
         // 有効な時刻データがある場合のみ計算
         if (_zerox_timestamps[current_index] > 0 && _zerox_timestamps[prev_index] > 0) {
@@ -278,12 +698,15 @@ float SSRDriver::getPowerLineFrequency() const {
 
 // ゼロクロス割り込みハンドラ（立ち上がりエッジのみ）
 void SSRDriver::zeroxEdgeHandler() {
+    IsrProfileScope prof(_isr_prof, ISR_PROF_ZEROX_EDGE);
+    
     // 割り込みが禁止されている場合は処理をスキップ
     if (_interrupt_disabled) {
         return;
     }
     
     uint32_t now = _zerox_timer.elapsed_time().count();
+    traceRecord(SSR_TRACE_ZEROX, 1, now);
     
     // 割り込み時刻を履歴に記録（過去100回の割り込みから電源周波数を算出）
     _zerox_timestamps[_zerox_history_index] = now;
@@ -307,6 +730,8 @@ void SSRDriver::zeroxEdgeHandler() {
                                    std::chrono::milliseconds(15));
     
     // 即座実行：zeroxControlHandlerを即座に実行
+    _half_cycle_base_us = now;
+    _half_cycle_index++;
     zeroxControlHandler();
 
     // 遅延実行：半周期時間後にzeroxControlHandlerを実行
@@ -323,6 +748,8 @@ void SSRDriver::zeroxEdgeHandler() {
         }
         half_cycle_us = (uint32_t)(1000000.0f / (power_freq * 2.0f) + 0.5f);
     }
+    _half_cycle_len_us = half_cycle_us;
+    _delayed_base_us = now + half_cycle_us;
     _delayed_control_timeout.attach(
         callback(this, &SSRDriver::delayedControlHandler),
         std::chrono::microseconds(half_cycle_us)
@@ -336,19 +763,33 @@ void SSRDriver::enableInterruptHandler() {
 
 // 遅延制御ハンドラ（電源周波数の半分の時間後に呼び出し）
 void SSRDriver::delayedControlHandler() {
+    IsrProfileScope prof(_isr_prof, ISR_PROF_DELAYED_CONTROL);
+    _half_cycle_base_us = _delayed_base_us;
+    _half_cycle_index++;
+    traceRecord(SSR_TRACE_HALF_CYCLE, 1, _zerox_timer.elapsed_time().count());
     zeroxControlHandler();
 }
 
 // ゼロクロス制御ハンドラ（Tickerで呼び出し）
 void SSRDriver::zeroxControlHandler() {
+    IsrProfileScope prof(_isr_prof, ISR_PROF_ZEROX_CONTROL);
+    
+    // 適用待ちの制御ブロックを一括適用（全チャンネル同一ゼロクロス）
+    applyPendingControl();
+    
+    // ランプ・波形再生中のチャンネルを半周期分進める（値が変わったチャンネルのみ通知）
+    uint8_t changed = advanceRamps();
+    changed |= advanceWaveforms();
+    notifyDutyChange(changed);
+    
     // SSR制御（すべてゼロクロスに同期）
     for (int i = 0; i < 4; i++) {
         if (_ssr_period[i] == 0) {
             if (_duty_level[i] <= 0) {
-                _ssr[i]->write(0);
+                writeSSR(i, 0);
                 _state[i] = false;
             } else if (_duty_level[i] >= 100) {
-                _ssr[i]->write(1);
+                writeSSR(i, 1);
                 _state[i] = true;
             } else {
                 // 半周期時間（1サイクル内の制御ウィンドウ長）を直近周期から算出
@@ -394,6 +835,9 @@ void SSRDriver::zeroxControlHandler() {
                 
                 _triac_off_timeout[i].detach();
                 
+                // 予定点弧時刻を記録（ゼロクロス時刻 + ON遅延）
+                _fire_intended_us[i] = _half_cycle_base_us + on_delay_us;
+                
                 // デューティ比に応じた遅延時間後にON（トライアック制御）
                 switch(i) {
                     case 0: _triac_off_timeout[i].attach(callback(this, &SSRDriver::turnOnSSR0), std::chrono::microseconds(on_delay_us)); break;
@@ -418,16 +862,147 @@ void SSRDriver::zeroxControlHandler() {
             
             // 現在の状態と異なる場合のみ変更（ノイズ対策）
             if (should_be_on != _state[i]) {
-                _ssr[i]->write(should_be_on ? 1 : 0);
+                writeSSR(i, should_be_on ? 1 : 0);
                 _state[i] = should_be_on;
             }
         }
     }
 }
 
+// 点弧ジッタを記録（割り込みコンテキスト）
+void SSRDriver::recordFireJitter(int ssr_id) {
+    uint32_t now = _zerox_timer.elapsed_time().count();
+    int32_t error_us = (int32_t)(now - _fire_intended_us[ssr_id]);
+    
+    // log2バケット（1us未満は0）
+    uint32_t bucket = 0;
+    if (error_us > 0) {
+        uint32_t v = (uint32_t)error_us;
+        while (v != 0 && bucket < SSR_JITTER_BUCKETS - 1) {
+            v >>= 1;
+            bucket++;
+        }
+    }
+    
+    JitterEntry& e = _jitter[ssr_id];
+    e.seq++;  // 奇数: 更新中
+    if (e.reset_request) {
+        clearJitterStats(e.stats);
+        e.reset_request = false;
+    }
+    SSRJitterStats& s = e.stats;
+    if (s.count == 0 || error_us < s.min_us) {
+        s.min_us = error_us;
+    }
+    if (s.count == 0 || error_us > s.max_us) {
+        s.max_us = error_us;
+    }
+    s.count++;
+    s.total_us += error_us;
+    s.bucket[bucket]++;
+    e.seq++;  // 偶数: 更新完了
+}
+
+void SSRDriver::clearJitterStats(SSRJitterStats& s) {
+    s.count = 0;
+    s.min_us = 0;
+    s.max_us = 0;
+    s.total_us = 0;
+    memset(s.bucket, 0, sizeof(s.bucket));
+}
+
+bool SSRDriver::getFireJitter(uint8_t id, SSRJitterStats& stats) const {
+    // Check id
+    if (id < 1 || id > 4) {
+        return false;
+    }
+    
+    const JitterEntry& e = _jitter[id - 1];
+    if (e.reset_request) {
+        // リセット要求中（次の点弧で割り込み側がクリア）
+        clearJitterStats(stats);
+        return true;
+    }
+    
+    uint32_t seq;
+    do {
+        seq = e.seq;
+        __asm volatile ("" ::: "memory");
+        stats = e.stats;
+        __asm volatile ("" ::: "memory");
+    } while ((seq & 1) || seq != e.seq);
+    
+    return true;
+}
+
+void SSRDriver::resetFireJitter() {
+    for (int i = 0; i < 4; i++) {
+        core_util_atomic_store_bool(&_jitter[i].reset_request, true);
+    }
+}
+
+void SSRDriver::setTraceEnabled(bool enabled) {
+#if SSR_TRACE_ENABLED
+    core_util_atomic_store_bool(&_trace_enabled, enabled);
+#else
+    (void)enabled;
+#endif
+}
+
+bool SSRDriver::isTraceEnabled() const {
+#if SSR_TRACE_ENABLED
+    return _trace_enabled;
+#else
+    return false;
+#endif
+}
+
+void SSRDriver::resetTrace() {
+#if SSR_TRACE_ENABLED
+    core_util_atomic_store_u32(&_trace_head, 0);
+#endif
+}
+
+uint32_t SSRDriver::getTraceHead() const {
+#if SSR_TRACE_ENABLED
+    return core_util_atomic_load_u32(&_trace_head);
+#else
+    return 0;
+#endif
+}
+
+uint16_t SSRDriver::readTrace(uint32_t& seq, SSRTraceRecord* out, uint16_t max_count) const {
+#if SSR_TRACE_ENABLED
+    uint32_t head = core_util_atomic_load_u32(&_trace_head);
+    
+    // リングに残っている最古のレコードまで進める
+    uint32_t oldest = head > SSR_TRACE_SIZE ? head - SSR_TRACE_SIZE : 0;
+    if (seq < oldest) {
+        seq = oldest;
+    }
+    if (seq >= head) {
+        return 0;
+    }
+    
+    uint32_t available = head - seq;
+    uint16_t count = available < max_count ? (uint16_t)available : max_count;
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = _trace[(seq + i) & (SSR_TRACE_SIZE - 1)];
+    }
+    return count;
+#else
+    (void)out;
+    (void)max_count;
+    seq = 0;
+    return 0;
+#endif
+}
+
 // トライアックON用コールバック（遅延ON + 1msec後にOFF）
 void SSRDriver::turnOnSSR0() {
-    _ssr[0]->write(1);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_ON);
+    recordFireJitter(0);
+    writeSSR(0, 1);
     _state[0] = true;
     // 1msec後にOFF
     _triac_off_timeout[0].attach(callback(this, &SSRDriver::turnOffSSR0), std::chrono::microseconds(1000));
@@ -435,7 +1010,9 @@ void SSRDriver::turnOnSSR0() {
 
 // トライアックON用コールバック（遅延ON + 1msec後にOFF）
 void SSRDriver::turnOnSSR1() {
-    _ssr[1]->write(1);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_ON);
+    recordFireJitter(1);
+    writeSSR(1, 1);
     _state[1] = true;
     // 1msec後にOFF
     _triac_off_timeout[1].attach(callback(this, &SSRDriver::turnOffSSR1), std::chrono::microseconds(1000));
@@ -443,7 +1020,9 @@ void SSRDriver::turnOnSSR1() {
 
 // トライアックON用コールバック（遅延ON + 1msec後にOFF）
 void SSRDriver::turnOnSSR2() {
-    _ssr[2]->write(1);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_ON);
+    recordFireJitter(2);
+    writeSSR(2, 1);
     _state[2] = true;
     // 1msec後にOFF
     _triac_off_timeout[2].attach(callback(this, &SSRDriver::turnOffSSR2), std::chrono::microseconds(1000));
@@ -451,7 +1030,9 @@ void SSRDriver::turnOnSSR2() {
 
 // トライアックON用コールバック（遅延ON + 1msec後にOFF）
 void SSRDriver::turnOnSSR3() {
-    _ssr[3]->write(1);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_ON);
+    recordFireJitter(3);
+    writeSSR(3, 1);
     _state[3] = true;
     // 1msec後にOFF
     _triac_off_timeout[3].attach(callback(this, &SSRDriver::turnOffSSR3), std::chrono::microseconds(1000));
@@ -459,25 +1040,29 @@ void SSRDriver::turnOnSSR3() {
 
 // トライアックOFF用コールバック
 void SSRDriver::turnOffSSR0() {
-    _ssr[0]->write(0);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_OFF);
+    writeSSR(0, 0);
     _state[0] = false;
 }
 
 // トライアックOFF用コールバック
 void SSRDriver::turnOffSSR1() {
-    _ssr[1]->write(0);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_OFF);
+    writeSSR(1, 0);
     _state[1] = false;
 }
 
 // トライアックOFF用コールバック
 void SSRDriver::turnOffSSR2() {
-    _ssr[2]->write(0);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_OFF);
+    writeSSR(2, 0);
     _state[2] = false;
 }
 
 // トライアックOFF用コールバック
 void SSRDriver::turnOffSSR3() {
-    _ssr[3]->write(0);
+    IsrProfileScope prof(_isr_prof, ISR_PROF_TURN_OFF);
+    writeSSR(3, 0);
     _state[3] = false;
 }
 
@@ -487,6 +1072,24 @@ void SSRDriver::updateControl() {
     // この関数は後方互換性のために残す
 }
 
+bool SSRDriver::getHalfCycleTiming(uint32_t& index, uint32_t& elapsed_us, uint32_t& half_cycle_us) const {
+    core_util_critical_section_enter();
+    uint32_t now = _zerox_timer.elapsed_time().count();
+    index = _half_cycle_index;
+    elapsed_us = now - _half_cycle_base_us;
+    half_cycle_us = _half_cycle_len_us;
+    core_util_critical_section_exit();
+    if (!_zerox_flag || half_cycle_us == 0) {
+        return false;
+    }
+    // 次の半周期の割り込みがまだ処理されていなければ進めておく（予測を1半周期ずらさないため）
+    if (elapsed_us >= half_cycle_us) {
+        index += elapsed_us / half_cycle_us;
+        elapsed_us %= half_cycle_us;
+    }
+    return true;
+}
+
 void SSRDriver::getZeroCrossStats(uint32_t& count, uint32_t& interval, float& frequency) const {
     count = _zerox_count;
     
@@ -2,11 +2,69 @@
 #define SSR_DRIVER_H
 
 #include "mbed.h"
+#include "IsrProfiler.h"
 
 // ゼロクロス検出ピン
 #define ZEROX_PIN P3_9
 
+// 波形テーブルの最大点数（各チャンネル）
+#define SSR_WAVE_MAX_POINTS 2048
 
+/**
+ * SSRランプのカーブ種別
+ */
+enum SSRRampCurve : uint8_t {
+    SSR_RAMP_LINEAR = 0,    // 直線
+    SSR_RAMP_EASE_IN,       // 緩やかに開始（二次）
+    SSR_RAMP_EASE_OUT,      // 緩やかに終了（二次）
+    SSR_RAMP_S_CURVE,       // 開始・終了とも緩やか（smoothstep）
+    SSR_RAMP_CURVE_COUNT
+};
+
+// SSR出力エッジトレース（1で有効、RAMを約8KB使用）
+#ifndef SSR_TRACE_ENABLED
+#define SSR_TRACE_ENABLED 0
+#endif
+
+// トレースリングバッファのレコード数（2のべき乗）
+#define SSR_TRACE_SIZE 1024
+
+// トレースレコードのチャンネル値（0-3はSSR出力）
+#define SSR_TRACE_ZEROX      0xFF  // ゼロクロス立ち上がりエッジ
+#define SSR_TRACE_HALF_CYCLE 0xFE  // 遅延制御（後半の半周期開始）
+
+/**
+ * SSR出力エッジトレースレコード
+ */
+struct SSRTraceRecord {
+    uint32_t t_us;      // 時刻（ゼロクロス計測タイマ基準、マイクロ秒）
+    uint8_t channel;    // 0-3: SSR1-4、SSR_TRACE_ZEROX / SSR_TRACE_HALF_CYCLE
+    uint8_t level;      // 出力レベル（0/1）
+};
+
+// 点弧ジッタヒストグラムのバケット数（log2区切り）
+#define SSR_JITTER_BUCKETS 16
+
+/**
+ * トライアック点弧ジッタ統計（予定時刻に対する実際のON時刻の遅れ）
+ * bucket[0]: 1us未満（早着を含む）、bucket[k]: 2^(k-1)〜2^k-1 us、
+ * bucket[SSR_JITTER_BUCKETS-1]: それ以上
+ */
+struct SSRJitterStats {
+    uint32_t count;     // 点弧回数
+    int32_t min_us;     // 最小誤差（負は予定より早い）
+    int32_t max_us;     // 最大誤差
+    int64_t total_us;   // 誤差合計（平均算出用）
+    uint32_t bucket[SSR_JITTER_BUCKETS];
+};
+
+/**
+ * SSR制御ブロック（ゼロクロス割り込みで一括適用）
+ */
+struct SSRControlBlock {
+    uint8_t mask;       // 更新対象チャンネル（bit0=SSR1〜bit3=SSR4）
+    uint8_t duty[4];    // デューティ比（0-100）
+};
 
 /**
  * Solid State Relay (SSR) driver class
@@ -69,6 +127,94 @@ public:
      */
     uint8_t getDutyLevel(uint8_t id);
     
+    /**
+     * Set the duty cycle of several SSRs at once
+     * All channels in the mask are applied at the same zero-cross.
+     * @param mask Channels to update (bit0: SSR1 ... bit3: SSR4)
+     * @param levels Duty cycle levels (0-100), indexed by channel (0-3)
+     * @return true if successful, false otherwise
+     */
+    bool setAllDutyLevels(uint8_t mask, const uint8_t levels[4]);
+    
+    /**
+     * Register a duty-change notification
+     * Called with the mask of changed channels (bit0: SSR1 ... bit3: SSR4).
+     * Ramps and waveforms notify from the zero-cross ISR, so the callback
+     * must be ISR-safe (e.g. EventFlags::set).
+     * @param cb Callback (empty to unregister)
+     */
+    void setDutyChangeCallback(Callback<void(uint8_t)> cb);
+    
+    /**
+     * Ramp the duty cycle to a target level inside the zero-cross ISR
+     * The level is advanced once per half-cycle, so no host streaming is needed.
+     * A following setDutyLevel() cancels the ramp.
+     * @param id SSR number (1-4)
+     * @param target_level Target duty cycle level (0-100)
+     * @param duration_ms Ramp duration in milliseconds (0: apply immediately)
+     * @param curve Ramp curve
+     * @return true if successful, false otherwise
+     */
+    bool startRamp(uint8_t id, uint8_t target_level, uint32_t duration_ms, SSRRampCurve curve = SSR_RAMP_LINEAR);
+    
+    /**
+     * Stop the ramp and keep the current duty cycle level
+     * @param id SSR number (1-4)
+     * @return true if successful, false otherwise
+     */
+    bool stopRamp(uint8_t id);
+    
+    /**
+     * Check whether a ramp is running
+     * @param id SSR number (1-4)
+     * @return true if a ramp is active
+     */
+    bool isRampActive(uint8_t id) const;
+    
+    /**
+     * Write duty values into the waveform table of the SSR
+     * The table cannot be modified while it is playing.
+     * @param id SSR number (1-4)
+     * @param offset Start index in the table
+     * @param values Duty cycle levels (0-100)
+     * @param count Number of values
+     * @return true if successful, false otherwise
+     */
+    bool loadWaveform(uint8_t id, uint16_t offset, const uint8_t* values, uint16_t count);
+    
+    /**
+     * Clear the waveform table of the SSR (stops playback)
+     * @param id SSR number (1-4)
+     * @return true if successful, false otherwise
+     */
+    bool clearWaveform(uint8_t id);
+    
+    /**
+     * Start waveform playback from the zero-cross ISR
+     * A following setDutyLevel() or startRamp() stops the playback.
+     * @param id SSR number (1-4)
+     * @param divider Number of half-cycles per table entry (1-)
+     * @param loop true: loop playback, false: one-shot (keeps the last value)
+     * @return true if successful, false otherwise
+     */
+    bool playWaveform(uint8_t id, uint16_t divider, bool loop);
+    
+    /**
+     * Stop waveform playback and keep the current duty cycle level
+     * @param id SSR number (1-4)
+     * @return true if successful, false otherwise
+     */
+    bool stopWaveform(uint8_t id);
+    
+    /**
+     * Get waveform playback status
+     * @param id SSR number (1-4)
+     * @param length Output: number of points in the table
+     * @param position Output: index of the next point to play
+     * @param playing Output: true while playing
+     * @return true if successful, false otherwise
+     */
+    bool getWaveformStatus(uint8_t id, uint16_t& length, uint16_t& position, bool& playing) const;
 
     
     /**
@@ -148,6 +294,19 @@ public:
         return count; 
     }
     
+    /**
+     * Get the current half-cycle for zero-cross aligned scheduling
+     * The index counts half-cycles (both the zero-cross and the synthesized
+     * mid-cycle one) since start-up. A duty change published before a
+     * half-cycle starts is applied at that half-cycle. If the next half-cycle
+     * is already due but its interrupt has not run yet, it is counted.
+     * @param index Output: index of the current half-cycle
+     * @param elapsed_us Output: time since the current half-cycle started
+     * @param half_cycle_us Output: half-cycle length
+     * @return true if the zero-cross is detected, false otherwise
+     */
+    bool getHalfCycleTiming(uint32_t& index, uint32_t& elapsed_us, uint32_t& half_cycle_us) const;
+    
     /**
      * Get zero-cross statistics for monitoring
      * @param count Output: number of detections
@@ -156,6 +315,71 @@ public:
      */
     void getZeroCrossStats(uint32_t& count, uint32_t& interval, float& frequency) const;
     
+    /**
+     * Get the execution cycle statistics of an interrupt handler
+     * @param handler Handler (IsrProfileId)
+     * @param stats Output statistics
+     * @return true if successful, false otherwise
+     */
+    bool getIsrStats(uint8_t handler, IsrProfileStats& stats) const { return _isr_prof.getStats(handler, stats); }
+    
+    /**
+     * Reset the interrupt handler statistics
+     */
+    void resetIsrStats() { _isr_prof.requestReset(); }
+    
+    /**
+     * Get the triac firing jitter statistics of the SSR
+     * @param id SSR number (1-4)
+     * @param stats Output statistics
+     * @return true if successful, false otherwise
+     */
+    bool getFireJitter(uint8_t id, SSRJitterStats& stats) const;
+    
+    /**
+     * Reset the triac firing jitter statistics (applied by the next firing)
+     */
+    void resetFireJitter();
+    
+    /**
+     * Check whether the edge tracer is compiled in (SSR_TRACE_ENABLED)
+     * @return true if available
+     */
+    static bool isTraceAvailable() { return SSR_TRACE_ENABLED != 0; }
+    
+    /**
+     * Start/stop recording edge trace records
+     * @param enabled true to record
+     */
+    void setTraceEnabled(bool enabled);
+    
+    /**
+     * Check whether edge trace recording is running
+     * @return true if recording
+     */
+    bool isTraceEnabled() const;
+    
+    /**
+     * Clear the edge trace ring buffer
+     */
+    void resetTrace();
+    
+    /**
+     * Get the total number of records written since the last reset
+     * @return Sequence number of the next record
+     */
+    uint32_t getTraceHead() const;
+    
+    /**
+     * Copy edge trace records
+     * @param seq Input: first sequence number requested, output: first sequence number copied
+     *            (advanced to the oldest record still in the ring if older)
+     * @param out Output records
+     * @param max_count Maximum number of records to copy
+     * @return Number of records copied
+     */
+    uint16_t readTrace(uint32_t& seq, SSRTraceRecord* out, uint16_t max_count) const;
+    
     // デバッグ情報取得
     void getDebugInfo(uint32_t& power_freq, uint32_t& on_time_us, uint32_t& cycle_time_us) const;
     
@@ -211,6 +435,16 @@ private:
     
     // 時間周期制御用カウンタ（ゼロクロス割り込み内で加算）
     uint32_t _time_on_count[4] = {0}; // 各チャンネルのON時間（ゼロクロス回数）
+    
+    // デューティ比更新用ダブルバッファ
+    // スレッド側は空いている方に書き込んで番号を公開し、割り込み側は交換で受け取る
+    SSRControlBlock _ctrl_block[2];
+    volatile uint8_t _ctrl_pending = 0;  // 適用待ちブロック番号+1（0=なし）
+    uint8_t _ctrl_next = 0;              // 次に書き込むブロック番号（スレッド側のみ）
+    Mutex _ctrl_mutex;                   // スレッド間の排他（割り込み側では使用しない）
+    
+    // デューティ比変更通知（ランプ・波形再生時は割り込みコンテキストから呼ばれる）
+    Callback<void(uint8_t)> _duty_change_cb;
 
 
 
@@ -229,7 +463,7 @@ private:
     Timeout _delayed_control_timeout;  // 遅延制御用Timeout
     
     // P8_11入力端子（将来の拡張用）
-    DigitalIn* _p8_11_input;
+    DigitalIn* _p8_11_input = nullptr;
     
     // 電源周波数計算用（過去100回の割り込みから算出）
     static const uint8_t FREQ_HISTORY_SIZE = 100;  // 履歴サイズ
@@ -250,8 +484,101 @@ private:
     uint32_t _ssr_counter[4] = {0};  // 各チャンネルのカウンタ（ゼロクロス回数）
     uint32_t _ssr_period[4] = {0};   // 各チャンネルの周期（ゼロクロス回数）
     uint32_t _ssr_start_time[4] = {0}; // 各SSRの周期開始時刻（ms）- 後方互換性のため残す
+    // 割り込みハンドラの実行サイクル計測
+    IsrProfiler _isr_prof;
+    
+#if SSR_TRACE_ENABLED
+    // 出力エッジトレース（割り込みから追記、スロットはアトミック加算で確保）
+    SSRTraceRecord _trace[SSR_TRACE_SIZE];
+    volatile uint32_t _trace_head = 0;    // 次に書き込むシーケンス番号
+    volatile bool _trace_enabled = true;  // 記録中フラグ
+#endif
+    
+    // トレースレコード追記（割り込みコンテキスト）
+    inline void traceRecord(uint8_t channel, uint8_t level, uint32_t t_us) {
+#if SSR_TRACE_ENABLED
+        if (_trace_enabled) {
+            uint32_t seq = core_util_atomic_fetch_add_u32(&_trace_head, 1);
+            SSRTraceRecord& r = _trace[seq & (SSR_TRACE_SIZE - 1)];
+            r.t_us = t_us;
+            r.channel = channel;
+            r.level = level;
+        }
+#else
+        (void)channel;
+        (void)level;
+        (void)t_us;
+#endif
+    }
+    
+    // SSR出力（トレース記録付き）
+    inline void writeSSR(int ssr_id, int level) {
+        _ssr[ssr_id]->write(level);
+#if SSR_TRACE_ENABLED
+        traceRecord(ssr_id, level, _zerox_timer.elapsed_time().count());
+#endif
+    }
+    
+    // 点弧ジッタ計測用（turnOnSSRnからのみ更新、読み出しはシーケンス番号で整合性確認）
+    struct JitterEntry {
+        volatile uint32_t seq;          // シーケンス番号（奇数は更新中）
+        volatile bool reset_request;    // リセット要求（スレッド側がセット）
+        SSRJitterStats stats;
+    };
+    JitterEntry _jitter[4];
+    uint32_t _fire_intended_us[4] = {0};   // 予定点弧時刻（_zerox_timer基準）
+    uint32_t _half_cycle_base_us = 0;      // 現在の半周期の開始時刻（ゼロクロス時刻）
+    uint32_t _delayed_base_us = 0;         // 遅延制御側の半周期開始予定時刻
+    volatile uint32_t _half_cycle_index = 0;  // 半周期の通し番号（半周期の開始ごとに加算）
+    uint32_t _half_cycle_len_us = 0;       // 直近の半周期の長さ
+    
+    // 点弧ジッタを記録（turnOnSSRnから呼び出し）
+    void recordFireJitter(int ssr_id);
+    static void clearJitterStats(SSRJitterStats& s);
+    
     // トライアック制御用
     uint32_t _triac_delay_us = 100; // ゼロクロスからONまでの遅延時間（マイクロ秒）
+
+    // デューティ比ランプ制御用（ゼロクロス割り込み内で半周期ごとに進める）
+    struct Ramp {
+        volatile bool active;   // ランプ実行中フラグ（最後に書き込む）
+        uint8_t start_level;    // 開始デューティ比
+        uint8_t target_level;   // 目標デューティ比
+        uint8_t curve;          // SSRRampCurve
+        uint32_t total_steps;   // 総ステップ数（半周期数）
+        uint32_t step;          // 経過ステップ数
+    };
+    Ramp _ramp[4];
+
+    // 波形再生用（ゼロクロス割り込み内で半周期ごとに進める）
+    struct Waveform {
+        volatile bool active;   // 再生中フラグ（最後に書き込む）
+        bool loop;              // ループ再生
+        uint16_t length;        // テーブル点数
+        uint16_t position;      // 次に出力するインデックス
+        uint16_t divider;       // 1点あたりの半周期数
+        uint16_t dwell;         // 現在の点の残り半周期数
+        uint8_t table[SSR_WAVE_MAX_POINTS];  // デューティ比テーブル（0-100）
+    };
+    Waveform _wave[4];
+
+    // 制御ブロックを公開（スレッドコンテキスト専用）
+    void publishDutyLevels(uint8_t mask, const uint8_t levels[4]);
+    // 適用待ちのデューティ比を取り消して取得（スレッドコンテキスト専用）
+    bool retractPendingDuty(uint8_t index, uint8_t& level);
+    // 適用待ちのデューティ比を取得（スレッドコンテキスト専用）
+    bool peekPendingDuty(uint8_t index, uint8_t& level);
+    // 制御ブロックを適用（zeroxControlHandlerから呼び出し）
+    void applyPendingControl();
+    
+    // ランプを1ステップ進める（zeroxControlHandlerから呼び出し、戻り値は値が変化したチャンネルのマスク）
+    uint8_t advanceRamps();
+    // 波形を1ステップ進める（zeroxControlHandlerから呼び出し、戻り値は値が変化したチャンネルのマスク）
+    uint8_t advanceWaveforms();
+    // デューティ比変更を通知
+    void notifyDutyChange(uint8_t mask);
+    // カーブ適用（進捗・戻り値ともQ15固定小数点）
+    static uint32_t applyRampCurve(uint8_t curve, uint32_t progress_q15);
     
     // トライアックON用コールバック
     void turnOnSSR(int ssr_id);
@@ -0,0 +1,131 @@
+#include "SequenceFilter.h"
+#include "TimeSync.h"
+#include <string.h>
+
+// チャンネルを指定するコマンドと、チャンネルを表す引数の数（それ以外のコマンドは名前だけで区別）
+static const struct {
+    const char* name;
+    uint8_t address_args;
+} CHANNEL_COMMANDS[] = {
+    {"set", 1}, {"ssr", 1}, {"ramp", 1}, {"wave", 1}, {"freq", 1},
+    {"rgb", 1}, {"fade", 1}, {"keyframe", 1},
+    {"ws2812", 2}, {"ws2812sys", 1}, {"ws2812off", 1},
+};
+
+SequenceFilter::SequenceFilter() {
+    reset();
+}
+
+void SequenceFilter::reset() {
+    ScopedLock<Mutex> lock(_mutex);
+    memset(_streams, 0, sizeof(_streams));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t SequenceFilter::hash(uint32_t ip, uint16_t port, uint32_t target) {
+    uint32_t h = ip * 0x9E3779B1UL;
+    h ^= (port + (target << 16) + (target >> 16)) * 0x85EBCA6BUL;
+    h ^= h >> 15;
+    return h;
+}
+
+uint32_t SequenceFilter::targetKey(const char* command) {
+    // 実行時刻・ユニット指定は対象に含めない
+    for (;;) {
+        const char* rest = NULL;
+        if (command[0] == '@') {
+            rest = strchr(command, ' ');
+        } else if (strncmp(command, "unit ", 5) == 0) {
+            rest = strchr(command + 5, ' ');
+        }
+        if (!rest) {
+            break;
+        }
+        command = rest + 1;
+    }
+
+    // コマンド名（と、チャンネルを指定するコマンドはチャンネル番号）のFNV-1a
+    size_t name_len = strcspn(command, " ");
+    uint8_t address_args = 0;
+    for (size_t i = 0; i < sizeof(CHANNEL_COMMANDS) / sizeof(CHANNEL_COMMANDS[0]); i++) {
+        if (strlen(CHANNEL_COMMANDS[i].name) == name_len && strncmp(command, CHANNEL_COMMANDS[i].name, name_len) == 0) {
+            address_args = CHANNEL_COMMANDS[i].address_args;
+            break;
+        }
+    }
+
+    const char* end = command + name_len;
+    while (address_args > 0 && *end != '\0') {
+        end++;  // 区切り文字
+        end += strcspn(end, " ,");
+        address_args--;
+    }
+
+    uint32_t h = 2166136261UL;
+    for (const char* p = command; p < end; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619UL;
+    }
+    return h & 0x7FFFFFFFUL;  // 明示したストリーム番号（streamKey）と重ならないように
+}
+
+SeqResult SequenceFilter::check(uint32_t ip, uint16_t port, uint32_t target, uint32_t seq) {
+    uint64_t now_us = TimeSync::localUs();
+    ScopedLock<Mutex> lock(_mutex);
+
+    // 同じストリームか空きを探し、どちらもなければ最も古いストリームを置き換える
+    uint32_t base = hash(ip, port, target);
+    Stream* found = NULL;
+    Stream* oldest = NULL;
+    for (int i = 0; i < SEQ_PROBE; i++) {
+        Stream& s = _streams[(base + i) % SEQ_STREAMS];
+        if (s.used && s.ip == ip && s.port == port && s.target == target) {
+            found = &s;
+            break;
+        }
+        if (!oldest || (oldest->used && (!s.used || s.last_us < oldest->last_us))) {
+            oldest = &s;
+        }
+    }
+
+    if (!found || seq == 0 || now_us - found->last_us >= SEQ_STREAM_TIMEOUT_US) {
+        if (!found) {
+            if (oldest->used) {
+                _stats.evicted++;
+            } else {
+                _stats.streams++;
+            }
+            found = oldest;
+            found->used = true;
+            found->ip = ip;
+            found->port = port;
+            found->target = target;
+        } else {
+            _stats.resets++;
+        }
+        found->last_seq = seq;
+        found->last_us = now_us;
+        _stats.accepted++;
+        return SEQ_ACCEPT;
+    }
+
+    // 番号の前後は差の符号で判定（32ビットの周回に対応）
+    int32_t diff = (int32_t)(seq - found->last_seq);
+    if (diff == 0) {
+        _stats.duplicate++;
+        return SEQ_DUPLICATE;
+    }
+    if (diff < 0) {
+        _stats.stale++;
+        return SEQ_STALE;
+    }
+    _stats.lost += (uint32_t)(diff - 1);
+    _stats.accepted++;
+    found->last_seq = seq;
+    found->last_us = now_us;
+    return SEQ_ACCEPT;
+}
+
+void SequenceFilter::getStats(SeqStats& stats) const {
+    ScopedLock<Mutex> lock(_mutex);
+    stats = _stats;
+}
@@ -0,0 +1,100 @@
+#ifndef SEQUENCE_FILTER_H
+#define SEQUENCE_FILTER_H
+
+#include "mbed.h"
+
+// 追跡するストリーム（送信元×対象）の数と、探索する範囲
+#define SEQ_STREAMS 64
+#define SEQ_PROBE 4
+// これ以上更新がないストリームは送信元の再起動とみなし、次の番号をそのまま受け付ける
+#define SEQ_STREAM_TIMEOUT_US 5000000ULL
+
+/**
+ * シーケンス番号の判定結果
+ */
+enum SeqResult : uint8_t {
+    SEQ_ACCEPT = 0,     // 新しい更新
+    SEQ_DUPLICATE,      // 同じ番号（重複）
+    SEQ_STALE           // 古い番号（順序の入れ替わり）
+};
+
+/**
+ * シーケンス番号の統計
+ */
+struct SeqStats {
+    uint32_t accepted;      // 受け付けた更新
+    uint32_t duplicate;     // 破棄した重複
+    uint32_t stale;         // 破棄した古い更新
+    uint32_t lost;          // 番号の飛び（届かなかった、または後から届いて破棄された更新）
+    uint32_t resets;        // 番号0・タイムアウトによる番号の取り直し
+    uint32_t evicted;       // 表が満杯で追い出したストリーム
+    uint16_t streams;       // 追跡中のストリーム数
+};
+
+/**
+ * Per-sender, per-target sequence number filter
+ * Streaming senders prefix commands with an increasing sequence number.
+ * The filter remembers the newest number of each (sender, target) stream
+ * in a small open-addressed table and rejects duplicates and packets
+ * overtaken by a newer one, so reordered datagrams cannot bring back an
+ * older value. Lookups probe at most SEQ_PROBE slots; when they are all
+ * taken the least recently updated one is replaced.
+ */
+class SequenceFilter {
+public:
+    SequenceFilter();
+
+    /**
+     * Check a sequence number and record it if it is new
+     * @param ip Sender IPv4 address (network byte order)
+     * @param port Sender port
+     * @param target Target key (see targetKey)
+     * @param seq Sequence number (0 restarts the stream)
+     * @return SeqResult
+     */
+    SeqResult check(uint32_t ip, uint16_t port, uint32_t target, uint32_t seq);
+
+    /**
+     * Get the statistics
+     * @param stats Output statistics
+     */
+    void getStats(SeqStats& stats) const;
+
+    /**
+     * Forget all streams and clear the statistics
+     */
+    void reset();
+
+    /**
+     * Derive the target key of a command
+     * Channel commands (set 1,..., rgb 2 ...) are keyed by name and channel,
+     * other commands by name only. Leading @<time> and unit <a>[-<b>]
+     * prefixes are skipped.
+     * @param command Lowercase command
+     * @return Target key
+     */
+    static uint32_t targetKey(const char* command);
+
+    /**
+     * Target key of an explicit stream number
+     */
+    static uint32_t streamKey(uint16_t stream) { return 0x80000000UL | stream; }
+
+private:
+    struct Stream {
+        uint32_t ip;
+        uint16_t port;
+        bool used;
+        uint32_t target;
+        uint32_t last_seq;
+        uint64_t last_us;
+    };
+
+    Stream _streams[SEQ_STREAMS];
+    SeqStats _stats;
+    mutable Mutex _mutex;   // UDPスレッドとマルチキャストスレッドから呼ばれる
+
+    static uint32_t hash(uint32_t ip, uint16_t port, uint32_t target);
+};
+
+#endif // SEQUENCE_FILTER_H
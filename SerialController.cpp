@@ -192,6 +192,10 @@ void SerialController::processCommand(const char* command) {
         handleRGBGetCommand(cmd + 7);
     } else if (strcmp(cmd, "info") == 0) {
         handleInfoCommand();
+    } else if (strcmp(cmd, "isrstats") == 0) {
+        handleIsrStatsCommand("");
+    } else if (strncmp(cmd, "isrstats ", 9) == 0) {
+        handleIsrStatsCommand(cmd + 9);
     } else if (strcmp(cmd, "config") == 0) {
         handleConfigCommand("config");  // コンフィグ情報一覧を表示
     } else if (strncmp(cmd, "config ", 7) == 0) {
@@ -235,6 +239,7 @@ void SerialController::displayHelp() {
     
     log_printf(LOG_LEVEL_INFO, "System:");
     log_printf(LOG_LEVEL_INFO, "  info                 Display device information");
+    log_printf(LOG_LEVEL_INFO, "  isrstats [reset]     Show/reset SSR interrupt handler cycle counts");
     log_printf(LOG_LEVEL_INFO, "  reboot               Restart the system");
     log_printf(LOG_LEVEL_INFO, "  help                 Show this help message");
     log_printf(LOG_LEVEL_INFO, "============================");
@@ -313,7 +318,8 @@ void SerialController::handleRGBCommand(const char* command) {
             r >= 0 && r <= 255 && 
             g >= 0 && g <= 255 && 
             b >= 0 && b <= 255) {
-            _rgb_led_driver->setColor(num, r, g, b);
+            _rgb_led_driver->stopKeyframes(num);
+            _rgb_led_driver->setColor(num, r, g, b, RGB_SOURCE_SERIAL);
             log_printf(LOG_LEVEL_INFO, "LED%d color set to R:%d G:%d B:%d", num, r, g, b);
         } else {
             log_printf(LOG_LEVEL_ERROR, "Invalid parameters");
@@ -341,6 +347,33 @@ void SerialController::handleRGBGetCommand(const char* command) {
     }
 }
 
+void SerialController::handleIsrStatsCommand(const char* command) {
+    if (strcmp(command, "reset") == 0) {
+        _ssr_driver->resetIsrStats();
+        log_printf(LOG_LEVEL_INFO, "ISR statistics reset");
+        return;
+    }
+    if (command[0] != '\0') {
+        log_printf(LOG_LEVEL_ERROR, "Invalid format. Use: isrstats [reset]");
+        return;
+    }
+    
+    uint32_t cpu_mhz = SystemCoreClock / 1000000;
+    log_printf(LOG_LEVEL_INFO, "ISR statistics (cycles @ %luMHz):", cpu_mhz);
+    log_printf(LOG_LEVEL_INFO, "  %-16s %10s %8s %8s %8s %10s", "handler", "count", "min", "avg", "max", "max_us");
+    
+    for (uint8_t i = 0; i < ISR_PROF_COUNT; i++) {
+        IsrProfileStats stats;
+        _ssr_driver->getIsrStats(i, stats);
+        
+        uint32_t min = stats.count ? stats.min : 0;
+        uint32_t avg = stats.count ? (uint32_t)(stats.total / stats.count) : 0;
+        float max_us = cpu_mhz ? (float)stats.max / cpu_mhz : 0.0f;
+        log_printf(LOG_LEVEL_INFO, "  %-16s %10lu %8lu %8lu %8lu %10.2f",
+                   IsrProfiler::getName(i), stats.count, min, avg, stats.max, max_us);
+    }
+}
+
 void SerialController::handleInfoCommand() {
     // バージョン情報を取得
     VersionInfo version = getVersionInfo();
@@ -448,6 +481,9 @@ void SerialController::handleConfigCommand(const char* command) {
         const char* value = command + 8;
         if (strcmp(value, "on") == 0 || strcmp(value, "1") == 0) {
             _config_manager->setSSRLink(true);
+            if (_rgb_led_driver) {
+                _rgb_led_driver->requestSSRLinkRefresh();
+            }
             log_printf(LOG_LEVEL_INFO, "SSR-LED link enabled");
         } else if (strcmp(value, "off") == 0 || strcmp(value, "0") == 0) {
             _config_manager->setSSRLink(false);
@@ -508,6 +544,9 @@ void SerialController::handleConfigCommand(const char* command) {
         if (sscanf(command + 5, "%d,%d,%d,%d", &num, &r, &g, &b) == 4) {
             if (num >= 1 && num <= 4 && r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255) {
                 _config_manager->setSSRLinkColor0(num, r, g, b);
+                if (_rgb_led_driver) {
+                    _rgb_led_driver->requestSSRLinkRefresh();
+                }
                 log_printf(LOG_LEVEL_INFO, "SSR%d 0%% color set to R:%d G:%d B:%d", num, r, g, b);
             } else {
                 log_printf(LOG_LEVEL_ERROR, "Invalid parameters");
@@ -521,6 +560,9 @@ void SerialController::handleConfigCommand(const char* command) {
         if (sscanf(command + 7, "%d,%d,%d,%d", &num, &r, &g, &b) == 4) {
             if (num >= 1 && num <= 4 && r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255) {
                 _config_manager->setSSRLinkColor100(num, r, g, b);
+                if (_rgb_led_driver) {
+                    _rgb_led_driver->requestSSRLinkRefresh();
+                }
                 log_printf(LOG_LEVEL_INFO, "SSR%d 100%% color set to R:%d G:%d B:%d", num, r, g, b);
             } else {
                 log_printf(LOG_LEVEL_ERROR, "Invalid parameters");
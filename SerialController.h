@@ -127,6 +127,7 @@ private:
     void handleRGBCommand(const char* command);
     void handleRGBGetCommand(const char* command);
     void handleInfoCommand();
+    void handleIsrStatsCommand(const char* command);
     void handleConfigCommand(const char* command);
     void handleDebugCommand(const char* command);
     void handleRebootCommand();  // 再起動コマンドのハンドラ
@@ -0,0 +1,64 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <stdint.h>
+
+// バイナリ応答の識別子とバージョン
+#define STATE_SNAPSHOT_MAGIC0 'S'
+#define STATE_SNAPSHOT_MAGIC1 'T'
+#define STATE_SNAPSHOT_VERSION 1
+
+// flagsのビット
+#define STATE_FLAG_ZEROX 0x01       // ゼロクロス検出中
+#define STATE_FLAG_SSR_LINK 0x02    // SSR-LED連動有効
+#define STATE_FLAG_TIME_SYNC 0x04   // マスターに時刻同期済み
+
+// RGB activityのビット
+#define STATE_RGB_TRANSITION 0x01   // トランジション中
+#define STATE_RGB_KEYFRAME 0x02     // キーフレーム再生中
+
+/**
+ * Full device state in one datagram
+ * Filled in a single pass over the drivers and sent as is by "stateb"
+ * (the target is little-endian, so the layout is the wire format); "state"
+ * prints the same fields as text.
+ */
+struct __attribute__((packed)) StateSnapshot {
+    uint8_t magic[2];           // "ST"
+    uint8_t version;            // STATE_SNAPSHOT_VERSION
+    uint8_t flags;              // STATE_FLAG_*
+    uint64_t device_us;         // デバイス時刻
+
+    struct __attribute__((packed)) {
+        uint8_t duty;           // デューティ比（0-100）
+        uint8_t state;          // 出力状態（0/1）
+        int8_t freq_hz;         // 制御周波数（-1=設定変更無効）
+        uint8_t reserved;
+        uint32_t period_us;     // 制御周期
+    } ssr[4];
+
+    struct __attribute__((packed)) {
+        uint8_t r, g, b;
+        uint8_t activity;       // STATE_RGB_*
+    } rgb[4];
+
+    uint32_t zerox_count;       // ゼロクロス検出回数
+    uint32_t zerox_interval_us; // ゼロクロス間隔
+    uint16_t line_freq_x10;     // 電源周波数（0.1Hz単位）
+
+    uint8_t mist_level;         // 0=OFF, 1=ON
+    uint8_t mist_queued;        // 予約中のパルス数
+    uint32_t mist_remaining_ms; // 現在のパルスの残り時間
+    uint8_t air_level;          // 0=OFF, 1=LOW, 2=HIGH
+    uint8_t air_queued;
+    uint32_t air_remaining_ms;
+
+    uint32_t ws_frames[3];      // WS2812系統ごとの送信フレーム数
+
+    uint8_t unit_index;         // 0xFF=未設定
+    uint8_t debug_level;
+    uint16_t transition_ms;     // SSR-LED連動の色変化時間
+    uint16_t udp_port;
+};
+
+#endif // STATE_SNAPSHOT_H
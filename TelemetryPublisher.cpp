@@ -0,0 +1,187 @@
+#include "TelemetryPublisher.h"
+#include "TimeSync.h"
+#include <string.h>
+
+static const struct {
+    const char* name;
+    uint8_t field;
+} TELEMETRY_FIELD_NAMES[] = {
+    {"ssr", TELEMETRY_SSR}, {"rgb", TELEMETRY_RGB}, {"zerox", TELEMETRY_ZEROX}, {"ws", TELEMETRY_WS2812},
+};
+
+TelemetryPublisher::TelemetryPublisher(Callback<int(uint8_t, uint32_t, char*, size_t)> formatter,
+                                       Callback<void(const SocketAddress&, const char*, size_t)> sender)
+    : _formatter(formatter), _sender(sender), _thread(osPriorityBelowNormal, 4096) {
+    for (int i = 0; i < TELEMETRY_SUBSCRIBERS; i++) {
+        _subs[i].used = false;
+    }
+    _thread.start(callback(this, &TelemetryPublisher::threadFunc));
+}
+
+TelemetryPublisher::~TelemetryPublisher() {
+    _flags.set(TELEMETRY_FLAG_EXIT);
+    if (_thread.get_state() != Thread::Deleted) {
+        _thread.join();
+    }
+}
+
+bool TelemetryPublisher::subscribe(const SocketAddress& addr, uint32_t interval_ms, uint8_t fields, uint32_t lease_s) {
+    if (interval_ms < TELEMETRY_MIN_INTERVAL_MS || interval_ms > TELEMETRY_MAX_INTERVAL_MS ||
+        fields == 0 || (fields & ~TELEMETRY_ALL) || lease_s == 0 || lease_s > TELEMETRY_MAX_LEASE_S) {
+        return false;
+    }
+
+    uint64_t now_us = TimeSync::localUs();
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        // 同じ宛先は更新（期限の延長）、なければ空きに追加
+        Subscriber* sub = NULL;
+        for (int i = 0; i < TELEMETRY_SUBSCRIBERS; i++) {
+            if (_subs[i].used && _subs[i].addr == addr) {
+                sub = &_subs[i];
+                break;
+            }
+            if (!_subs[i].used && !sub) {
+                sub = &_subs[i];
+            }
+        }
+        if (!sub) {
+            return false;
+        }
+        if (!sub->used) {
+            sub->used = true;
+            sub->addr = addr;
+            sub->seq = 0;
+            sub->next_us = now_us;  // 最初のスナップショットはすぐに送る
+        }
+        sub->interval_ms = interval_ms;
+        sub->fields = fields;
+        sub->expire_us = now_us + (uint64_t)lease_s * 1000000;
+    }
+    _flags.set(TELEMETRY_FLAG_WAKE);
+    return true;
+}
+
+bool TelemetryPublisher::unsubscribe(const SocketAddress& addr) {
+    ScopedLock<Mutex> lock(_mutex);
+    for (int i = 0; i < TELEMETRY_SUBSCRIBERS; i++) {
+        if (_subs[i].used && _subs[i].addr == addr) {
+            _subs[i].used = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TelemetryPublisher::getSubscription(uint8_t index, TelemetrySubscription& sub) const {
+    if (index >= TELEMETRY_SUBSCRIBERS) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    const Subscriber& s = _subs[index];
+    if (!s.used) {
+        return false;
+    }
+    uint64_t now_us = TimeSync::localUs();
+    sub.addr = s.addr;
+    sub.interval_ms = s.interval_ms;
+    sub.fields = s.fields;
+    sub.remaining_s = s.expire_us > now_us ? (uint32_t)((s.expire_us - now_us) / 1000000) : 0;
+    sub.sent = s.seq;
+    return true;
+}
+
+int TelemetryPublisher::parseFields(const char* names) {
+    if (strcmp(names, "all") == 0) {
+        return TELEMETRY_ALL;
+    }
+    int fields = 0;
+    const char* p = names;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        bool found = false;
+        for (size_t i = 0; i < sizeof(TELEMETRY_FIELD_NAMES) / sizeof(TELEMETRY_FIELD_NAMES[0]); i++) {
+            if (strlen(TELEMETRY_FIELD_NAMES[i].name) == len && strncmp(p, TELEMETRY_FIELD_NAMES[i].name, len) == 0) {
+                fields |= TELEMETRY_FIELD_NAMES[i].field;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return -1;
+        }
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return fields != 0 ? fields : -1;
+}
+
+int TelemetryPublisher::formatFields(uint8_t fields, char* buffer, size_t size) {
+    int len = 0;
+    buffer[0] = '\0';
+    for (size_t i = 0; i < sizeof(TELEMETRY_FIELD_NAMES) / sizeof(TELEMETRY_FIELD_NAMES[0]); i++) {
+        if ((fields & TELEMETRY_FIELD_NAMES[i].field) && (size_t)len < size) {
+            len += snprintf(buffer + len, size - len, "%s%s", len ? ":" : "", TELEMETRY_FIELD_NAMES[i].name);
+        }
+    }
+    return len;
+}
+
+void TelemetryPublisher::threadFunc() {
+    for (;;) {
+        // 期限切れの購読を削除し、送信時刻に達した購読者を1つ選ぶ
+        uint64_t now_us = TimeSync::localUs();
+        uint64_t wait_us = 1000000;
+        int due = -1;
+        SocketAddress addr;
+        uint8_t fields = 0;
+        uint32_t seq = 0;
+        {
+            ScopedLock<Mutex> lock(_mutex);
+            for (int i = 0; i < TELEMETRY_SUBSCRIBERS; i++) {
+                Subscriber& s = _subs[i];
+                if (!s.used) {
+                    continue;
+                }
+                if ((int64_t)(now_us - s.expire_us) >= 0) {
+                    s.used = false;
+                    continue;
+                }
+                if ((int64_t)(now_us - s.next_us) >= 0) {
+                    if (due < 0) {
+                        due = i;
+                    }
+                } else if (s.next_us - now_us < wait_us) {
+                    wait_us = s.next_us - now_us;
+                }
+            }
+            if (due >= 0) {
+                Subscriber& s = _subs[due];
+                addr = s.addr;
+                fields = s.fields;
+                seq = s.seq++;
+                // 遅れても送信間隔を保つ（遅れが1周期を超えたら現在時刻から数え直す）
+                s.next_us += (uint64_t)s.interval_ms * 1000;
+                if ((int64_t)(now_us - s.next_us) >= 0) {
+                    s.next_us = now_us + (uint64_t)s.interval_ms * 1000;
+                }
+            }
+        }
+
+        if (due >= 0) {
+            int len = _formatter(fields, seq, _buffer, sizeof(_buffer));
+            if (len > 0) {
+                _sender(addr, _buffer, (size_t)len);
+            }
+            continue;  // 他にも送信時刻に達した購読者がいないか確認
+        }
+
+        uint32_t flags = _flags.wait_any_for(TELEMETRY_FLAG_WAKE | TELEMETRY_FLAG_EXIT,
+                                             std::chrono::milliseconds((wait_us + 999) / 1000));
+        if (!(flags & osFlagsError) && (flags & TELEMETRY_FLAG_EXIT)) {
+            break;
+        }
+    }
+}
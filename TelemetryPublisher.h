@@ -0,0 +1,108 @@
+#ifndef TELEMETRY_PUBLISHER_H
+#define TELEMETRY_PUBLISHER_H
+
+#include "mbed.h"
+#include "netsocket/SocketAddress.h"
+
+// 購読者数・送信間隔の範囲・購読期限
+#define TELEMETRY_SUBSCRIBERS 4
+#define TELEMETRY_MIN_INTERVAL_MS 20
+#define TELEMETRY_MAX_INTERVAL_MS 60000
+#define TELEMETRY_DEFAULT_LEASE_S 60
+#define TELEMETRY_MAX_LEASE_S 3600
+#define TELEMETRY_BUFFER_SIZE 512
+
+/**
+ * 送信する項目（ビットマスク）
+ */
+enum TelemetryField : uint8_t {
+    TELEMETRY_SSR = 0x01,       // SSRのデューティ比と出力状態
+    TELEMETRY_RGB = 0x02,       // RGB LEDの色
+    TELEMETRY_ZEROX = 0x04,     // ゼロクロスの検出状態と統計
+    TELEMETRY_WS2812 = 0x08,    // WS2812系統ごとの送信フレーム数
+    TELEMETRY_ALL = 0x0F
+};
+
+/**
+ * 購読の状態
+ */
+struct TelemetrySubscription {
+    SocketAddress addr;
+    uint32_t interval_ms;
+    uint8_t fields;
+    uint32_t remaining_s;   // 期限までの残り時間
+    uint32_t sent;          // 送信したスナップショット数
+};
+
+/**
+ * Push telemetry to subscribers
+ * Each subscriber receives a state snapshot at its own interval until its
+ * lease expires; re-sending the subscription renews it. A dedicated thread
+ * sleeps until the earliest due subscriber, asks the formatter for the
+ * snapshot and hands it to the sender, so monitoring needs no requests.
+ */
+class TelemetryPublisher {
+public:
+    /**
+     * Constructor
+     * @param formatter スナップショットの整形（fields, seq, buffer, size → 長さ、0以下は送信しない）
+     * @param sender 送信（宛先, データ, 長さ）
+     */
+    TelemetryPublisher(Callback<int(uint8_t, uint32_t, char*, size_t)> formatter,
+                       Callback<void(const SocketAddress&, const char*, size_t)> sender);
+    ~TelemetryPublisher();
+
+    /**
+     * Add or renew a subscription
+     * @param addr Subscriber address
+     * @param interval_ms Push interval
+     * @param fields TelemetryField mask
+     * @param lease_s Lease (seconds)
+     * @return true if successful, false if the parameters are invalid or the table is full
+     */
+    bool subscribe(const SocketAddress& addr, uint32_t interval_ms, uint8_t fields, uint32_t lease_s);
+
+    /**
+     * Remove a subscription
+     * @return true if the address was subscribed
+     */
+    bool unsubscribe(const SocketAddress& addr);
+
+    /**
+     * Get a subscription
+     * @param index Subscription index (0-TELEMETRY_SUBSCRIBERS-1)
+     * @param sub Output subscription
+     * @return true if the slot is in use
+     */
+    bool getSubscription(uint8_t index, TelemetrySubscription& sub) const;
+
+    // 項目名の変換（"ssr,rgb,zerox,ws" / "all"）
+    static int parseFields(const char* names);  // 不正な名前は-1
+    static int formatFields(uint8_t fields, char* buffer, size_t size);
+
+private:
+    struct Subscriber {
+        bool used;
+        SocketAddress addr;
+        uint32_t interval_ms;
+        uint8_t fields;
+        uint64_t next_us;       // 次の送信時刻
+        uint64_t expire_us;     // 購読の期限
+        uint32_t seq;           // 送信したスナップショット数（受信側の欠落検出用）
+    };
+
+    static const uint32_t TELEMETRY_FLAG_WAKE = 0x01;
+    static const uint32_t TELEMETRY_FLAG_EXIT = 0x02;
+
+    Subscriber _subs[TELEMETRY_SUBSCRIBERS];
+    Callback<int(uint8_t, uint32_t, char*, size_t)> _formatter;
+    Callback<void(const SocketAddress&, const char*, size_t)> _sender;
+    char _buffer[TELEMETRY_BUFFER_SIZE];
+    mutable Mutex _mutex;   // 購読表を保護（整形・送信中は保持しない）
+    EventFlags _flags;
+    Thread _thread;
+
+    void threadFunc();
+};
+
+#endif // TELEMETRY_PUBLISHER_H
@@ -0,0 +1,215 @@
+#include "TimeSync.h"
+
+TimeSync::TimeSync()
+    : _params_seq(0), _polling(false), _synced(false), _outstanding(false), _ping_t1(0),
+      _burst_sent(0), _next_round_us(0), _have_best(false), _best_offset(0), _best_local(0),
+      _best_delay(0), _have_ref(false), _ref_local(0), _ref_offset(0), _have_drift(false), _drift_ppb(0),
+      _slewing(false), _slew_end_us(0),
+      _last_offset(0), _last_error(0), _last_delay(0), _rounds(0), _lost(0), _last_sync_local(0) {
+    // 同期するまではデバイス時刻 = ローカル時刻
+    for (int i = 0; i < 2; i++) {
+        _params[i].base_local = 0;
+        _params[i].base_device = 0;
+        _params[i].rate_ppb = 0;
+    }
+}
+
+void TimeSync::readParams(Params& p) const {
+    uint32_t seq;
+    do {
+        seq = _params_seq;
+        __asm volatile ("" ::: "memory");
+        p = _params[seq & 1];
+        __asm volatile ("" ::: "memory");
+    } while (seq != _params_seq);
+}
+
+void TimeSync::publish(const Params& p) {
+    _params[(_params_seq + 1) & 1] = p;
+    __asm volatile ("" ::: "memory");
+    _params_seq++;
+}
+
+uint64_t TimeSync::apply(const Params& p, uint64_t local_us) {
+    int64_t d = (int64_t)(local_us - p.base_local);
+    return p.base_device + d + d * p.rate_ppb / 1000000000LL;
+}
+
+uint64_t TimeSync::toDevice(uint64_t local_us) const {
+    Params p;
+    readParams(p);
+    return apply(p, local_us);
+}
+
+uint64_t TimeSync::toLocal(uint64_t device_us) const {
+    Params p;
+    readParams(p);
+    // レートは高々数百ppmなので1次近似で十分
+    int64_t d = (int64_t)(device_us - p.base_device);
+    return p.base_local + d - d * p.rate_ppb / 1000000000LL;
+}
+
+void TimeSync::startPolling() {
+    ScopedLock<Mutex> lock(_mutex);
+    _polling = true;
+    _outstanding = false;
+    _burst_sent = 0;
+    _have_best = false;
+    _next_round_us = localUs();
+    // マスターが変わった可能性があるため、ドリフトの基準は取り直す
+    _have_ref = false;
+}
+
+void TimeSync::stopPolling() {
+    ScopedLock<Mutex> lock(_mutex);
+    _polling = false;
+    _outstanding = false;
+    endSlew(localUs());
+}
+
+void TimeSync::endSlew(uint64_t now_local) {
+    if (!_slewing) {
+        return;
+    }
+    // スルー補正を終えてドリフト補正のみに戻す（マスターと通信できなくなっても進みがずれ続けないように）
+    Params p;
+    readParams(p);
+    p.base_device = apply(p, now_local);
+    p.base_local = now_local;
+    p.rate_ppb = _drift_ppb;
+    publish(p);
+    _slewing = false;
+}
+
+bool TimeSync::pollPing(uint64_t& t1) {
+    ScopedLock<Mutex> lock(_mutex);
+    if (!_polling) {
+        return false;
+    }
+    uint64_t now_local = localUs();
+    if (_slewing && (int64_t)(now_local - _slew_end_us) >= 0) {
+        endSlew(now_local);
+    }
+
+    if (_outstanding) {
+        if (now_local - _ping_t1 < (uint64_t)TIME_SYNC_TIMEOUT_MS * 1000) {
+            return false;
+        }
+        // 応答なし（破棄して次の往復へ）
+        _outstanding = false;
+        _lost++;
+    }
+
+    if (_burst_sent >= TIME_SYNC_BURST) {
+        finishRound(now_local);
+    }
+    if (_burst_sent == 0 && (int64_t)(now_local - _next_round_us) < 0) {
+        return false;
+    }
+
+    _burst_sent++;
+    _outstanding = true;
+    _ping_t1 = now_local;
+    t1 = now_local;
+    return true;
+}
+
+bool TimeSync::handlePong(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+    ScopedLock<Mutex> lock(_mutex);
+    if (!_outstanding || t1 != _ping_t1 || t4 < t1) {
+        return false;
+    }
+    _outstanding = false;
+
+    // 往復遅延（マスター内の処理時間を除く）とオフセット（マスター時刻 - ローカル時刻）
+    int64_t rtt = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+    uint32_t delay = rtt > 0 ? (uint32_t)rtt : 0;
+    int64_t offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+
+    if (!_have_best || delay < _best_delay) {
+        _have_best = true;
+        _best_delay = delay;
+        _best_offset = offset;
+        _best_local = t1 + (t4 - t1) / 2;
+    }
+    if (_burst_sent >= TIME_SYNC_BURST) {
+        finishRound(localUs());
+    }
+    return true;
+}
+
+void TimeSync::finishRound(uint64_t now_local) {
+    _burst_sent = 0;
+    _next_round_us = now_local + (uint64_t)TIME_SYNC_INTERVAL_MS * 1000;
+    if (!_have_best) {
+        return;  // すべて応答なし
+    }
+    _have_best = false;
+
+    // ドリフト: 十分離れた2点のオフセットの傾き（指数移動平均で平滑化）
+    if (!_have_ref) {
+        _have_ref = true;
+        _ref_local = _best_local;
+        _ref_offset = _best_offset;
+    } else if (_best_local - _ref_local >= TIME_SYNC_DRIFT_BASELINE_US) {
+        int64_t measured = (_best_offset - _ref_offset) * 1000000000LL / (int64_t)(_best_local - _ref_local);
+        _drift_ppb = _have_drift ? (int32_t)(_drift_ppb + (measured - _drift_ppb) / 4) : (int32_t)measured;
+        _have_drift = true;
+        _ref_local = _best_local;
+        _ref_offset = _best_offset;
+    }
+
+    Params p;
+    readParams(p);
+    uint64_t target = _best_local + _best_offset;
+    int64_t error = (int64_t)(target - apply(p, _best_local));
+
+    if (!_synced || error > TIME_SYNC_STEP_US || error < -TIME_SYNC_STEP_US) {
+        // 時刻を飛ばして合わせる
+        p.base_local = _best_local;
+        p.base_device = target;
+        p.rate_ppb = _drift_ppb;
+        _synced = true;
+        _slewing = false;
+    } else {
+        // 現在時刻で連続につなぎ、次のラウンドまでにずれを解消するレートにする（時刻は戻らない）
+        uint64_t device_now = apply(p, now_local);
+        int64_t slew = error * 1000000000LL / ((int64_t)TIME_SYNC_INTERVAL_MS * 1000);
+        int64_t rate = _drift_ppb + slew;
+        if (rate > _drift_ppb + TIME_SYNC_MAX_SLEW_PPB) {
+            rate = _drift_ppb + TIME_SYNC_MAX_SLEW_PPB;
+        } else if (rate < _drift_ppb - TIME_SYNC_MAX_SLEW_PPB) {
+            rate = _drift_ppb - TIME_SYNC_MAX_SLEW_PPB;
+        }
+        p.base_local = now_local;
+        p.base_device = device_now;
+        p.rate_ppb = (int32_t)rate;
+        _slewing = true;
+        _slew_end_us = now_local + (uint64_t)TIME_SYNC_INTERVAL_MS * 1000;
+    }
+    publish(p);
+
+    _last_offset = _best_offset;
+    _last_error = error;
+    _last_delay = _best_delay;
+    _last_sync_local = now_local;
+    _rounds++;
+}
+
+void TimeSync::getStatus(TimeSyncStatus& status) const {
+    ScopedLock<Mutex> lock(_mutex);
+    Params p;
+    readParams(p);
+    uint64_t now_local = localUs();
+    status.synced = _synced;
+    status.polling = _polling;
+    status.device_us = apply(p, now_local);
+    status.offset_us = _last_offset;
+    status.error_us = _last_error;
+    status.delay_us = _last_delay;
+    status.drift_ppb = _drift_ppb;
+    status.rate_ppb = p.rate_ppb;
+    status.rounds = _rounds;
+    status.lost = _lost;
+    status.age_ms = _synced ? (uint32_t)((now_local - _last_sync_local) / 1000) : 0;
+}
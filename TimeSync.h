@@ -0,0 +1,153 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include "mbed.h"
+
+// 同期ラウンドの間隔と1ラウンドの往復回数（最小遅延の往復を採用）
+#ifndef TIME_SYNC_INTERVAL_MS
+#define TIME_SYNC_INTERVAL_MS 4000
+#endif
+#define TIME_SYNC_BURST 8
+// 応答が来ない往復を破棄するまでの時間
+#define TIME_SYNC_TIMEOUT_MS 200
+// これより大きいずれは時刻を飛ばして合わせる（未満はレートを変えて滑らかに合わせる）
+#define TIME_SYNC_STEP_US 10000
+// スルー補正のレート上限（ppb）
+#define TIME_SYNC_MAX_SLEW_PPB 500000
+// ドリフト推定に使うオフセットの最短間隔
+#define TIME_SYNC_DRIFT_BASELINE_US 16000000
+
+/**
+ * 時刻同期の状態
+ */
+struct TimeSyncStatus {
+    bool synced;            // マスターと1度でも同期したか
+    bool polling;           // マスターへ問い合わせ中か
+    uint64_t device_us;     // 現在のデバイス時刻
+    int64_t offset_us;      // 最後のラウンドで測ったマスター時刻 - ローカル時刻
+    int64_t error_us;       // 最後のラウンドで測ったマスター時刻 - デバイス時刻（補正前）
+    uint32_t delay_us;      // 最後のラウンドで採用した往復の遅延
+    int32_t drift_ppb;      // 推定したローカルクロックの周波数ずれ
+    int32_t rate_ppb;       // 現在のデバイス時刻の進み（ドリフト + スルー補正）
+    uint32_t rounds;        // 完了したラウンド数
+    uint32_t lost;          // 応答がなかった往復数
+    uint32_t age_ms;        // 最後の同期からの経過時間
+};
+
+/**
+ * Device clock disciplined to a master over an NTP-style exchange
+ * The local clock is the free-running 64-bit microsecond ticker. The device
+ * clock is derived from it with an anchor and a rate, published through a
+ * double-buffered sequence counter so threads and ISRs can read it without
+ * locking. As a client, each round sends TIME_SYNC_BURST pings (t1), the
+ * master answers with its receive and send times (t2, t3), and the sample
+ * with the smallest round-trip delay sets the offset. Small errors are
+ * slewed out by adjusting the rate, large ones are stepped.
+ *
+ * Every device answers pings with its own device time, so a unit that is
+ * itself synchronized can serve as the master of others.
+ */
+class TimeSync {
+public:
+    TimeSync();
+
+    /**
+     * Free-running local time (microseconds since boot, ISR safe)
+     */
+    static uint64_t localUs() {
+        return ticker_read_us(get_us_ticker_data());
+    }
+
+    /**
+     * Current device time (microseconds, ISR safe)
+     */
+    uint64_t now() const {
+        return toDevice(localUs());
+    }
+
+    /**
+     * Convert between local and device time (ISR safe)
+     */
+    uint64_t toDevice(uint64_t local_us) const;
+    uint64_t toLocal(uint64_t device_us) const;
+
+    /**
+     * Start / stop polling a master (the caller owns the transport)
+     */
+    void startPolling();
+    void stopPolling();
+
+    /**
+     * Check whether a ping should be sent now
+     * @param t1 Output local send time to put in the ping
+     * @return true if a ping should be sent
+     */
+    bool pollPing(uint64_t& t1);
+
+    /**
+     * Process a pong from the master
+     * @param t1 Echoed local send time of the ping
+     * @param t2 Master time at ping reception
+     * @param t3 Master time at pong transmission
+     * @param t4 Local time at pong reception
+     * @return true if accepted, false if it does not match the outstanding ping
+     */
+    bool handlePong(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+
+    /**
+     * Get the synchronization status
+     * @param status Output status
+     */
+    void getStatus(TimeSyncStatus& status) const;
+
+private:
+    // デバイス時刻 = base_device + d + d * rate_ppb / 1e9 （d = ローカル時刻 - base_local）
+    struct Params {
+        uint64_t base_local;
+        uint64_t base_device;
+        int32_t rate_ppb;
+    };
+
+    // 読み出し側はseqが偶数ならparams[0]、奇数ならparams[1]を使い、読み終えてseqが変わっていれば再試行。
+    // 書き込み側は使われていない方に書いてからseqを進めるため、割り込みからも待たずに読める
+    Params _params[2];
+    volatile uint32_t _params_seq;
+
+    // クライアント状態（UDPスレッドのみ）
+    bool _polling;
+    bool _synced;
+    bool _outstanding;          // 応答待ちの往復があるか
+    uint64_t _ping_t1;
+    uint8_t _burst_sent;
+    uint64_t _next_round_us;    // 次のラウンドの開始時刻（ローカル）
+    bool _have_best;
+    int64_t _best_offset;
+    uint64_t _best_local;       // 最良サンプルの往復中点（ローカル）
+    uint32_t _best_delay;
+
+    // ドリフト推定
+    bool _have_ref;
+    uint64_t _ref_local;
+    int64_t _ref_offset;
+    bool _have_drift;
+    int32_t _drift_ppb;
+    bool _slewing;              // スルー補正中か
+    uint64_t _slew_end_us;      // スルー補正を終える時刻（ローカル）
+
+    // 統計（getStatusはコマンド処理スレッドから呼ばれる）
+    mutable Mutex _mutex;
+    int64_t _last_offset;
+    int64_t _last_error;
+    uint32_t _last_delay;
+    uint32_t _rounds;
+    uint32_t _lost;
+    uint64_t _last_sync_local;
+
+    void readParams(Params& p) const;
+    void publish(const Params& p);
+    static uint64_t apply(const Params& p, uint64_t local_us);
+    void finishRound(uint64_t now_local);
+    void endSlew(uint64_t now_local);
+};
+
+#endif // TIME_SYNC_H
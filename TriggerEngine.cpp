@@ -0,0 +1,145 @@
+#include "TriggerEngine.h"
+#include <string.h>
+
+TriggerEngine::TriggerEngine(ActuatorController& actuators)
+    : _actuators(actuators), _deferred_mask(0) {
+    for (int i = 0; i < TRIGGER_SLOTS; i++) {
+        _slots[i].count = 0;
+    }
+    clearStats(_stats);
+}
+
+bool TriggerEngine::addAction(uint8_t id, const TriggerAction& action) {
+    if (id >= TRIGGER_SLOTS || action.channel >= ACTUATOR_COUNT || action.duration_us == 0) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    Slot& slot = _slots[id];
+    if (slot.count >= TRIGGER_MAX_ACTIONS) {
+        return false;
+    }
+    slot.actions[slot.count++] = action;
+    return true;
+}
+
+bool TriggerEngine::clear(uint8_t id) {
+    if (id >= TRIGGER_SLOTS) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    _slots[id].count = 0;
+    return true;
+}
+
+bool TriggerEngine::getAction(uint8_t id, uint8_t index, TriggerAction& action) const {
+    if (id >= TRIGGER_SLOTS) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    if (index >= _slots[id].count) {
+        return false;
+    }
+    action = _slots[id].actions[index];
+    return true;
+}
+
+uint8_t TriggerEngine::getActionCount(uint8_t id) const {
+    if (id >= TRIGGER_SLOTS) {
+        return 0;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    return _slots[id].count;
+}
+
+bool TriggerEngine::fire(uint8_t id, uint32_t received_us, bool record) {
+    if (id >= TRIGGER_SLOTS) {
+        return false;
+    }
+    ScopedLock<Mutex> lock(_mutex);
+    const Slot& slot = _slots[id];
+    if (slot.count == 0) {
+        return false;
+    }
+
+    uint32_t channels = 0;
+    for (int i = 0; i < slot.count; i++) {
+        const TriggerAction& a = slot.actions[i];
+        if (a.set_rest) {
+            _actuators.setRestLevel(a.channel, a.rest_level);
+        }
+        _actuators.pulse(a.channel, a.level, a.duration_us, ACTUATOR_RETRIGGER);
+        channels |= 1UL << a.channel;
+    }
+
+    if (record) {
+        // 受信から全アクションの出力書き込みまで
+        // 別スレッドが書き込むチャンネルを含む場合は、書き込み後のrecordLatency()で計測を閉じる
+        if ((channels & _deferred_mask) && _deferred_request) {
+            _deferred_request(received_us);
+        } else {
+            addSample(us_ticker_read() - received_us);
+        }
+    }
+    return true;
+}
+
+void TriggerEngine::setDeferredOutput(uint32_t channel_mask, Callback<bool(uint32_t)> request) {
+    ScopedLock<Mutex> lock(_mutex);
+    _deferred_mask = channel_mask;
+    _deferred_request = request;
+}
+
+void TriggerEngine::recordLatency(uint32_t received_us) {
+    uint32_t latency_us = us_ticker_read() - received_us;
+    ScopedLock<Mutex> lock(_mutex);
+    addSample(latency_us);
+}
+
+void TriggerEngine::addSample(uint32_t latency_us) {
+    TriggerLatencyStats& s = _stats;
+    s.count++;
+    s.total_us += latency_us;
+    if (latency_us < s.min_us) {
+        s.min_us = latency_us;
+    }
+    if (latency_us > s.max_us) {
+        s.max_us = latency_us;
+    }
+    uint32_t b = latency_us / TRIGGER_LATENCY_BUCKET_US;
+    s.bucket[b < TRIGGER_LATENCY_BUCKETS ? b : TRIGGER_LATENCY_BUCKETS]++;
+}
+
+void TriggerEngine::getLatencyStats(TriggerLatencyStats& stats) const {
+    ScopedLock<Mutex> lock(_mutex);
+    stats = _stats;
+}
+
+void TriggerEngine::resetLatencyStats() {
+    ScopedLock<Mutex> lock(_mutex);
+    clearStats(_stats);
+}
+
+uint32_t TriggerEngine::percentile(const TriggerLatencyStats& stats, uint32_t permille) {
+    if (stats.count == 0) {
+        return 0;
+    }
+    // 小さい方から数えて count * permille / 1000 番目を含むバケット
+    uint64_t rank = ((uint64_t)stats.count * permille + 999) / 1000;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < TRIGGER_LATENCY_BUCKETS; b++) {
+        seen += stats.bucket[b];
+        if (seen >= rank) {
+            uint32_t upper = (uint32_t)(b + 1) * TRIGGER_LATENCY_BUCKET_US;
+            return upper < stats.max_us ? upper : stats.max_us;
+        }
+    }
+    return stats.max_us;
+}
+
+void TriggerEngine::clearStats(TriggerLatencyStats& stats) {
+    memset(&stats, 0, sizeof(stats));
+    stats.min_us = 0xFFFFFFFF;
+}
@@ -0,0 +1,147 @@
+#ifndef TRIGGER_ENGINE_H
+#define TRIGGER_ENGINE_H
+
+#include "mbed.h"
+#include "ActuatorController.h"
+
+// トリガスロット数とスロットあたりのアクション数
+#define TRIGGER_SLOTS 16
+#define TRIGGER_MAX_ACTIONS 8
+
+// バイナリトリガパケット: {TRIGGER_PACKET_MAGIC, トリガID}（テキストコマンドと区別するため非ASCII）
+#define TRIGGER_PACKET_MAGIC 0xE7
+#define TRIGGER_PACKET_SIZE 2
+
+// 受信から出力までの遅延ヒストグラム（TRIGGER_LATENCY_BUCKET_US刻み、最後のバケットは超過分）
+#define TRIGGER_LATENCY_BUCKETS 40
+#define TRIGGER_LATENCY_BUCKET_US 50
+
+/**
+ * トリガで実行するアクション（設定時に解析済み）
+ */
+struct TriggerAction {
+    uint8_t channel;        // ActuatorChannel
+    bool set_rest;          // パルス後のレベルを指定するか（falseならチャンネルの継続レベルに戻る）
+    uint32_t level;         // パルス中のレベル
+    uint32_t rest_level;    // パルス後のレベル（set_rest時）
+    uint32_t duration_us;   // パルス長
+};
+
+/**
+ * 受信から出力までの遅延統計
+ */
+struct TriggerLatencyStats {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t bucket[TRIGGER_LATENCY_BUCKETS + 1];
+};
+
+/**
+ * Pre-armed trigger slots
+ * Each slot holds a pre-parsed set of actuator pulses. A two-byte trigger
+ * packet fires a slot without text parsing or command dispatch, and the
+ * time from packet reception to the last output write is recorded in a
+ * histogram. Channels written by another thread (see setDeferredOutput)
+ * close the sample when that thread reports the write.
+ */
+class TriggerEngine {
+public:
+    explicit TriggerEngine(ActuatorController& actuators);
+
+    /**
+     * Append an action to a slot
+     * @param id Trigger ID (0-TRIGGER_SLOTS-1)
+     * @param action Action
+     * @return true if successful, false if failed (invalid ID/action or slot full)
+     */
+    bool addAction(uint8_t id, const TriggerAction& action);
+
+    /**
+     * Remove all actions of a slot
+     * @param id Trigger ID
+     * @return true if successful, false if failed
+     */
+    bool clear(uint8_t id);
+
+    /**
+     * Get an action
+     * @param id Trigger ID
+     * @param index Action index
+     * @param action Output action
+     * @return true if successful, false if out of range
+     */
+    bool getAction(uint8_t id, uint8_t index, TriggerAction& action) const;
+
+    /**
+     * Get the number of actions in a slot
+     * @param id Trigger ID
+     * @return Number of actions (0 for invalid IDs)
+     */
+    uint8_t getActionCount(uint8_t id) const;
+
+    /**
+     * Fire a slot
+     * @param id Trigger ID
+     * @param received_us us_ticker_read() at packet reception
+     * @param record true to record the latency
+     * @return true if successful, false if the slot is invalid or empty
+     */
+    bool fire(uint8_t id, uint32_t received_us, bool record);
+
+    /**
+     * Set the channels whose output is written later by another thread
+     * A recorded trigger using one of these channels calls request(received_us)
+     * instead of recording, and the writer calls recordLatency() after the write.
+     * @param channel_mask Bit mask of ActuatorChannel
+     * @param request 書き込み完了の通知を要求する関数（falseなら計測しない）
+     */
+    void setDeferredOutput(uint32_t channel_mask, Callback<bool(uint32_t)> request);
+
+    /**
+     * Record a latency sample
+     * @param received_us us_ticker_read() at packet reception
+     */
+    void recordLatency(uint32_t received_us);
+
+    /**
+     * Check whether a received packet is a binary trigger
+     */
+    static bool isTriggerPacket(const void* data, int length) {
+        return length == TRIGGER_PACKET_SIZE && ((const uint8_t*)data)[0] == TRIGGER_PACKET_MAGIC;
+    }
+
+    /**
+     * Get / reset the latency statistics
+     */
+    void getLatencyStats(TriggerLatencyStats& stats) const;
+    void resetLatencyStats();
+
+    /**
+     * Latency percentile from the histogram (upper bound of the bucket)
+     * @param stats Statistics
+     * @param permille Percentile in 1/1000 (e.g. 990 = p99)
+     * @return Latency in microseconds (max_us for the overflow bucket)
+     */
+    static uint32_t percentile(const TriggerLatencyStats& stats, uint32_t permille);
+
+private:
+    struct Slot {
+        TriggerAction actions[TRIGGER_MAX_ACTIONS];
+        uint8_t count;
+    };
+
+    ActuatorController& _actuators;
+    Slot _slots[TRIGGER_SLOTS];
+    TriggerLatencyStats _stats;
+    uint32_t _deferred_mask;
+    Callback<bool(uint32_t)> _deferred_request;
+    mutable Mutex _mutex;
+
+    void addSample(uint32_t latency_us);
+
+    static void clearStats(TriggerLatencyStats& stats);
+};
+
+#endif // TRIGGER_ENGINE_H
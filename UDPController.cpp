@@ -16,13 +16,33 @@
 UDPController::UDPController(SSRDriver& ssr_driver, RGBLEDDriver& rgb_led_driver, WS2812Driver& ws2812_driver, ConfigManager* config_manager)
     : _ssr_driver(ssr_driver), _rgb_led_driver(rgb_led_driver), _ws2812_driver(ws2812_driver),
       _packet_callback(nullptr), _command_callback(nullptr),
-      _config_manager(config_manager), _thread(nullptr), _mist_active(false),
-      _mist_start_time(0), _mist_duration(0), _interface(nullptr),
-      _running(false) {
+      _config_manager(config_manager), _thread(nullptr), _interface(nullptr),
+      _running(false), _suppress_response(false),
+      _cue_engine(callback(this, &UDPController::executeDeferredCommand), _command_mutex),
+      _actuators(callback(this, &UDPController::applyActuator)),
+      _triggers(_actuators), _time_master_set(false), _rx_local_us(0),
+      _scheduler(_time_sync, _ssr_driver, callback(this, &UDPController::executeDeferredCommand), _command_mutex),
+      _mcast_thread(nullptr), _mcast_open(false), _mcast_packets(0),
+      _reply_session(-1), _reply_mode(REPLY_ALL), _reply_error(false),
+      _reply_commands(0), _reply_errors(0), _reply_suppressed(0), _reply_acks(0),
+      _telemetry(callback(this, &UDPController::formatTelemetry), callback(this, &UDPController::sendTelemetry)),
+      _command_lanes(PRIORITY_QUEUE_SIZE, PRIORITY_COMMAND_SIZE, NORMAL_QUEUE_SIZE, MAX_BUFFER_SIZE),
+      _mcast_lanes(MCAST_PRIORITY_QUEUE_SIZE, PRIORITY_COMMAND_SIZE, MCAST_NORMAL_QUEUE_SIZE, MAX_BUFFER_SIZE) {
     
     // Initialize buffers
     memset(_recv_buffer, 0, MAX_BUFFER_SIZE);
     memset(_send_buffer, 0, MAX_BUFFER_SIZE);
+    memset(_mcast_buffer, 0, MAX_BUFFER_SIZE);
+    memset(_mcast_joined, 0, sizeof(_mcast_joined));
+    for (int i = 0; i < REPLY_SESSIONS; i++) {
+        _reply_sessions[i].used = false;
+    }
+    
+    // RGB LED・ミスト・エアーはトランジションスレッドが出力するため、書き込み後にトリガの遅延計測を閉じる
+    // （通知の要求はTriggerEngineのロック内で行われるため、要求側は直列化される）
+    _triggers.setDeferredOutput((1UL << ACTUATOR_MIST) | (1UL << ACTUATOR_AIR) | (0x0FUL << ACTUATOR_RGB1),
+                                callback(&_rgb_led_driver, &RGBLEDDriver::requestOutputNotify));
+    _rgb_led_driver.setOutputNotifyCallback(callback(&_triggers, &TriggerEngine::recordLatency));
 }
 
 UDPController::~UDPController() {
@@ -43,6 +63,20 @@ void UDPController::stop() {
         _thread->join();
         log_printf(LOG_LEVEL_INFO, "UDP thread stopped");
     }
+    
+    // 実行スレッドは実行中のコマンドを終えてから停止（キューに残ったコマンドは破棄）
+    if (_exec_thread && _exec_thread->get_state() != rtos::Thread::Deleted) {
+        _exec_flags.set(EXEC_FLAG_WAKE);
+        _exec_thread->join();
+    }
+    
+    // マルチキャスト受信スレッドは受信タイムアウトで停止フラグを確認する
+    if (_mcast_thread && _mcast_thread->get_state() != rtos::Thread::Deleted) {
+        _mcast_thread->join();
+    }
+    _mcast_socket.close();
+    _mcast_open = false;
+    memset(_mcast_joined, 0, sizeof(_mcast_joined));
 }
 
 bool UDPController::init(NetworkInterface* interface) {
@@ -138,6 +172,10 @@ bool UDPController::run() {
         log_printf(LOG_LEVEL_WARN, "Waiting for existing UDP thread to stop...");
         _running = false;  // 停止フラグを設定
         _thread->join();
+        if (_exec_thread && _exec_thread->get_state() != rtos::Thread::Deleted) {
+            _exec_flags.set(EXEC_FLAG_WAKE);
+            _exec_thread->join();
+        }
         log_printf(LOG_LEVEL_INFO, "Existing UDP thread stopped");
     }
     
@@ -145,7 +183,8 @@ bool UDPController::run() {
     if (!_thread || _thread->get_state() == rtos::Thread::Deleted) {
         log_printf(LOG_LEVEL_WARN, "UDP thread is in Deleted state, creating new thread");
         // 新しいスレッドオブジェクトを作成
-        _thread = std::make_unique<rtos::Thread>();
+        // 実行スレッドより優先し、処理の遅いコマンドの実行中も受信を続ける
+        _thread = std::make_unique<rtos::Thread>(osPriorityAboveNormal);
     }
 
     // UDPソケットを初期化
@@ -166,9 +205,114 @@ bool UDPController::run() {
     _thread->start(callback(this, &UDPController::_thread_func));
     log_printf(LOG_LEVEL_INFO, "_thread.start() completed");
     log_printf(LOG_LEVEL_INFO, "UDP thread started");
+    
+    // 受信したコマンドは実行スレッドで処理
+    if (!_exec_thread || _exec_thread->get_state() == rtos::Thread::Deleted) {
+        _exec_thread = std::make_unique<rtos::Thread>(osPriorityNormal, 6144);
+        _exec_thread->start(callback(this, &UDPController::_exec_thread_func));
+    }
+    
+    // マルチキャストは別ソケット・別スレッドで受信（失敗してもユニキャストは動作させる）
+    if (initMulticast() && (!_mcast_thread || _mcast_thread->get_state() == rtos::Thread::Deleted)) {
+        _mcast_thread = std::make_unique<rtos::Thread>(osPriorityNormal, 6144);
+        _mcast_thread->start(callback(this, &UDPController::_mcast_thread_func));
+    }
+    return true;
+}
+
+bool UDPController::initMulticast() {
+    if (_mcast_open) {
+        return true;
+    }
+    int port = _config_manager ? _config_manager->getMulticastPort() : DEFAULT_MULTICAST_PORT;
+    if (port == (_config_manager ? _config_manager->getUDPPort() : UDP_PORT)) {
+        log_printf(LOG_LEVEL_ERROR, "Multicast port %d is the unicast port, multicast disabled", port);
+        return false;
+    }
+    if (_mcast_socket.open(_interface) != 0) {
+        log_printf(LOG_LEVEL_ERROR, "Error multicast socket open");
+        return false;
+    }
+    _mcast_socket.set_timeout(500);
+    if (_mcast_socket.bind(port) != 0) {
+        log_printf(LOG_LEVEL_ERROR, "Error multicast bind (port %d)", port);
+        _mcast_socket.close();
+        return false;
+    }
+    _mcast_open = true;
+    log_printf(LOG_LEVEL_INFO, "Multicast socket listening on port %d", port);
+    applyMulticastGroups();
     return true;
 }
 
+void UDPController::applyMulticastGroups() {
+    if (!_mcast_open || !_config_manager) {
+        return;
+    }
+    for (int i = 0; i < MULTICAST_GROUPS; i++) {
+        uint32_t group = _config_manager->getMulticastGroup(i);
+        if (group == _mcast_joined[i]) {
+            continue;
+        }
+        SocketAddress addr;
+        if (_mcast_joined[i] != 0) {
+            addr.set_ip_bytes(&_mcast_joined[i], NSAPI_IPv4);
+            _mcast_socket.leave_multicast_group(addr);
+            log_printf(LOG_LEVEL_INFO, "Left multicast %s group %s", ConfigManager::getMulticastGroupName(i), addr.get_ip_address());
+            _mcast_joined[i] = 0;
+        }
+        if (group != 0) {
+            addr.set_ip_bytes(&group, NSAPI_IPv4);
+            if (_mcast_socket.join_multicast_group(addr) == 0) {
+                _mcast_joined[i] = group;
+                log_printf(LOG_LEVEL_INFO, "Joined multicast %s group %s", ConfigManager::getMulticastGroupName(i), addr.get_ip_address());
+            } else {
+                log_printf(LOG_LEVEL_ERROR, "Failed to join multicast group %s", addr.get_ip_address());
+            }
+        }
+    }
+}
+
+void UDPController::_mcast_thread_func() {
+    SocketAddress sender;
+    while (_running) {
+        nsapi_size_or_error_t result = _mcast_socket.recvfrom(&sender, _mcast_buffer, MAX_BUFFER_SIZE - 1);
+        uint64_t rx_us = TimeSync::localUs();
+        if (result <= 0) {
+            if (result != NSAPI_ERROR_WOULD_BLOCK && result != 0) {
+                ThisThread::sleep_for(50ms);
+            }
+            continue;
+        }
+        _mcast_packets++;
+        
+        // バイナリトリガは全台が同じパケットで発火
+        if (TriggerEngine::isTriggerPacket(_mcast_buffer, result)) {
+            _triggers.fire((uint8_t)_mcast_buffer[1], us_ticker_read(), true);
+            if (_packet_callback) {
+                _packet_callback("");
+            }
+            continue;
+        }
+        
+        _mcast_buffer[result] = '\0';
+        // 先頭の!（応答なし）はユニキャストと同じ書式で受け付ける（マルチキャストは常に応答なし）
+        char* command = _mcast_buffer[0] == '!' ? _mcast_buffer + 1 : _mcast_buffer;
+        if (command[0] == '#' && !acceptSequence(command, sender)) {
+            continue;
+        }
+        if (_packet_callback) {
+            _packet_callback(command);
+        }
+        // ユニキャストと同じ実行スレッドに渡す（全台からの応答が集中しないよう、マルチキャストのコマンドには応答しない）
+        if (_mcast_lanes.push(command, strlen(command), isPriorityCommand(command), sender, rx_us)) {
+            _exec_flags.set(EXEC_FLAG_WAKE);
+        } else {
+            log_printf(LOG_LEVEL_DEBUG, "Multicast command queue full, dropped: %s", command);
+        }
+    }
+}
+
 void UDPController::_thread_func() {
     log_printf(LOG_LEVEL_INFO, "UDP thread started");
     
@@ -243,12 +387,6 @@ void UDPController::_thread_func() {
     int reinit_count = 0;
     const int MAX_REINIT = 3;
     
-    // パケット処理時間の監視
-    const uint32_t MAX_PROCESS_TIME = 100;  // 最大処理時間（ミリ秒）
-    uint32_t total_process_time = 0;        // 合計処理時間
-    uint32_t max_process_time = 0;          // 最大処理時間
-    uint32_t process_count = 0;             // 処理したパケット数
-    
     // 待機時間の設定
     const auto MAIN_LOOP_WAIT = 10ms;
     const auto ERROR_WAIT = 50ms;
@@ -256,38 +394,39 @@ void UDPController::_thread_func() {
     const auto MAX_REINIT_WAIT = 2s;
     
     while (_running) {
-        // ミスト制御の状態チェック
-        if (_mist_active) {
-            uint32_t current_time = us_ticker_read() / 1000;  // 現在時刻（ミリ秒）
-            uint32_t elapsed = current_time - _mist_start_time;
-            
-            if (elapsed >= _mist_duration) {
-                // ミスト時間が経過したらOFFにする
-                _rgb_led_driver.setColor(1, 0, 0, 0);
-                _mist_active = false;
-                log_printf(LOG_LEVEL_DEBUG, "Mist control completed after %d ms", elapsed);
-            }
-        }
-
         // Clear buffer
         memset(_recv_buffer, 0, MAX_BUFFER_SIZE);
         
         // Receive UDP packet
-        nsapi_size_or_error_t result = _socket.recvfrom(&_remote_addr, _recv_buffer, MAX_BUFFER_SIZE - 1);
+        nsapi_size_or_error_t result = _socket.recvfrom(&_rx_addr, _recv_buffer, MAX_BUFFER_SIZE - 1);
+        uint64_t rx_us = TimeSync::localUs();
+        
+        // バイナリトリガはテキスト解析・ログ出力の前に発火（応答なし）
+        if (TriggerEngine::isTriggerPacket(_recv_buffer, result)) {
+            _triggers.fire((uint8_t)_recv_buffer[1], us_ticker_read(), true);
+            packet_count++;
+            if (_packet_callback) {
+                _packet_callback("");
+            }
+            continue;  // 次のパケットをすぐに受信
+        }
         
         if (result > 0) {
-            // パケット処理開始時間を記録
-            uint32_t start_time = us_ticker_read() / 1000;
-            
             // Reset error counter on successful reception
             error_count = 0;
             
             // Null terminate the received data
             _recv_buffer[result] = '\0';
             
+            // シーケンス番号付きのコマンドは古い・重複した更新を破棄（応答なし、先頭の!は実行スレッドで外す）
+            char* body = _recv_buffer[0] == '!' ? _recv_buffer + 1 : _recv_buffer;
+            if (body[0] == '#' && !acceptSequence(body, _rx_addr)) {
+                continue;
+            }
+            
             // Process received packet
             packet_count++;
-            last_remote_addr = _remote_addr;
+            last_remote_addr = _rx_addr;
             
             // Call packet received callback
             if (_packet_callback) {
@@ -297,7 +436,7 @@ void UDPController::_thread_func() {
             // Always log packet reception at debug level 1 or higher
             if (debug_level >= 1) {
                 log_printf(LOG_LEVEL_INFO, "UDP packet received from %s:%d (%d bytes)", 
-                          _remote_addr.get_ip_address(), _remote_addr.get_port(), result);
+                          _rx_addr.get_ip_address(), _rx_addr.get_port(), result);
             }
             
             // Log packet contents at debug level 2 or higher
@@ -305,29 +444,12 @@ void UDPController::_thread_func() {
                 log_printf(LOG_LEVEL_DEBUG, "Packet data: %s", _recv_buffer);
             }
             
-            // Process command
-            processCommand(_recv_buffer, result);
-            
-            // パケット処理時間を計算
-            uint32_t process_time = (us_ticker_read() / 1000) - start_time;
-            
-            // 統計情報を更新
-            total_process_time += process_time;
-            process_count++;
-            if (process_time > max_process_time) {
-                max_process_time = process_time;
-            }
-            
-            // 処理時間が長すぎる場合に警告
-            if (process_time > MAX_PROCESS_TIME) {
-                log_printf(LOG_LEVEL_WARN, "Command processing took %d ms", process_time);
-            }
-            
-            // 定期的に統計情報を表示
-            if (process_count % 100 == 0) {  // 100パケットごとに表示
-                uint32_t avg_process_time = total_process_time / process_count;
-                log_printf(LOG_LEVEL_INFO, "Packet processing stats - Avg: %d ms, Max: %d ms, Total packets: %d", 
-                          avg_process_time, max_process_time, process_count);
+            // 実行スレッドに渡す（満杯なら破棄して次を受信、応答なし）
+            size_t length = strlen(_recv_buffer);
+            if (_command_lanes.push(_recv_buffer, length, isPriorityCommand(_recv_buffer), _rx_addr, rx_us)) {
+                _exec_flags.set(EXEC_FLAG_WAKE);
+            } else {
+                log_printf(LOG_LEVEL_DEBUG, "Command queue full, dropped: %s", _recv_buffer);
             }
         } else if (result < 0 && result != NSAPI_ERROR_WOULD_BLOCK) {
             log_printf(LOG_LEVEL_ERROR, "UDP reception error: %d", result);
@@ -356,13 +478,111 @@ void UDPController::_thread_func() {
             ThisThread::sleep_for(ERROR_WAIT);
         }
         
-        // Add short wait time to reduce CPU usage
-        ThisThread::sleep_for(MAIN_LOOP_WAIT);
+        // 受信待ちはタイムアウト付きのため、パケットを受信した直後は待たずに次を受信
+        if (result <= 0) {
+            // Add short wait time to reduce CPU usage
+            ThisThread::sleep_for(MAIN_LOOP_WAIT);
+        }
     }
     
     log_printf(LOG_LEVEL_INFO, "UDP thread stopped");
 }
 
+void UDPController::_exec_thread_func() {
+    // パケット処理時間の監視
+    const uint32_t MAX_PROCESS_TIME = 100;  // 最大処理時間（ミリ秒）
+    uint32_t total_process_time = 0;        // 合計処理時間
+    uint32_t max_process_time = 0;          // 最大処理時間
+    uint32_t process_count = 0;             // 処理したパケット数
+    
+    while (_running) {
+        // マスターへの時刻同期の問い合わせ（応答の処理と同じスレッドで行う）
+        serviceTimeSync();
+        
+        // パケット処理開始時間を記録
+        uint32_t start_time = us_ticker_read() / 1000;
+        
+        // 優先レーンを空にしてから通常レーンを1つ実行（実行後はまた優先レーンから確認）
+        // ユニキャストとマルチキャストの同じ種類のレーン同士は受信順に実行
+        CommandQueue* queue = CommandLanes::next(_command_lanes, _mcast_lanes);
+        if (!queue || !executeQueued(*queue, _mcast_lanes.contains(queue))) {
+            _exec_flags.wait_any_for(EXEC_FLAG_WAKE, 100ms);  // 停止フラグの確認のためタイムアウト付き
+            continue;
+        }
+        
+        // パケット処理時間を計算
+        uint32_t process_time = (us_ticker_read() / 1000) - start_time;
+        
+        // 統計情報を更新
+        total_process_time += process_time;
+        process_count++;
+        if (process_time > max_process_time) {
+            max_process_time = process_time;
+        }
+        
+        // 処理時間が長すぎる場合に警告
+        if (process_time > MAX_PROCESS_TIME) {
+            log_printf(LOG_LEVEL_WARN, "Command processing took %d ms", process_time);
+        }
+        
+        // 定期的に統計情報を表示
+        if (process_count % 100 == 0) {  // 100パケットごとに表示
+            uint32_t avg_process_time = total_process_time / process_count;
+            log_printf(LOG_LEVEL_INFO, "Packet processing stats - Avg: %d ms, Max: %d ms, Total packets: %d", 
+                      avg_process_time, max_process_time, process_count);
+        }
+    }
+    
+    log_printf(LOG_LEVEL_INFO, "UDP executor thread stopped");
+}
+
+bool UDPController::executeQueued(CommandQueue& queue, bool multicast) {
+    SocketAddress sender;
+    uint64_t rx_us;
+    char* command = queue.front(sender, rx_us);
+    if (!command) {
+        return false;
+    }
+    uint64_t wait_us = TimeSync::localUs() - rx_us;
+    
+    if (multicast) {
+        // マルチキャストは応答なし（キュー・スケジューラと同じ実行方法）
+        executeDeferredCommand(command);
+    } else {
+        // 応答先・受信時刻をパケットごとに切り替えて実行（スロットはpopまで書き換え可能）
+        _command_mutex.lock();
+        _remote_addr = sender;
+        _rx_local_us = rx_us;
+        beginReply(command);
+        processCommand(command, strlen(command));
+        endReply();
+        _command_mutex.unlock();
+    }
+    
+    queue.pop(wait_us > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)wait_us);
+    return true;
+}
+
+bool UDPController::isPriorityCommand(const char* command) {
+    // 出力を直接動かすコマンド（SSR・アクチュエータ・トリガ・時刻・予約）は設定・表示・WS2812より先に実行
+    static const char* const PRIORITY_COMMANDS[] = {
+        "set", "ssr", "setall", "ramp", "wave", "mist", "air", "trigger", "time", "unit", "slice",
+    };
+    if (*command == '!') {
+        command++;
+    }
+    if (*command == '@') {
+        return true;
+    }
+    size_t len = strcspn(command, " ");
+    for (size_t i = 0; i < sizeof(PRIORITY_COMMANDS) / sizeof(PRIORITY_COMMANDS[0]); i++) {
+        if (strlen(PRIORITY_COMMANDS[i]) == len && strncasecmp(command, PRIORITY_COMMANDS[i], len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void UDPController::processCommand(const char* command, int length) {
     // コマンドを小文字に変換
     char cmd[MAX_BUFFER_SIZE];
@@ -372,11 +592,24 @@ void UDPController::processCommand(const char* command, int length) {
         *p = tolower(*p);
     }
 
+    // ユニット番号で宛先を絞ったコマンドは自分宛ての部分だけを残す（マルチキャストで複数台へ送る場合）
+    if (strncmp(cmd, "unit ", 5) == 0 || strncmp(cmd, "slice ", 6) == 0) {
+        if (!selectUnitCommand(cmd)) {
+            return;
+        }
+    }
+
+    // 実行時刻付きのコマンドは予約して戻る
+    if (cmd[0] == '@') {
+        processAtCommand(cmd + 1);
+        return;
+    }
+
     // コマンドの実行
     if (strcmp(cmd, "help") == 0) {
         // ヘルプメッセージを2分割して送信
         snprintf(_send_buffer, MAX_BUFFER_SIZE, 
-            "Available commands (Part 1/2):\n"
+            "Available commands (Part 1/4):\n"
             "help - Show this help\n"
             "debug level <0-3> - Set debug level\n"
             "debug status - Show current debug level\n"
@@ -387,6 +620,9 @@ void UDPController::processCommand(const char* command, int length) {
             "config rgb0 status <led_id> - Get LED 0%% color\n"
             "config rgb100 <led_id> <r> <g> <b> - Set LED 100%% color\n"
             "config rgb100 status <led_id> - Get LED 100%% color\n"
+            "config link <target>,<ssr>[,<curve>] - Link rgb1-4/ws1-3 to SSR (0=none)\n"
+            "config link status - Show SSR-LED link matrix\n"
+            "config wsrgb0|wsrgb100 <sys>,<r>,<g>,<b> - Set WS2812 link color\n"
             "config trans <ms> - Set transition time\n"
             "config trans status - Get transition time\n"
             "config ssr_freq <freq> - Set SSR PWM frequency (-1-10 Hz, -1=設定変更無効)\n"
@@ -398,10 +634,13 @@ void UDPController::processCommand(const char* command, int length) {
         
         // 2番目のパートを送信
         snprintf(_send_buffer, MAX_BUFFER_SIZE,
-            "Available commands (Part 2/2):\n"
+            "Available commands (Part 2/4):\n"
             "reboot - Reboot device\n"
             "info - Show system information\n"
             "set <channel> <duty> - Set SSR duty cycle\n"
+            "setall <d1>,<d2>,<d3>,<d4> - Set all SSRs on the same zero-cross (-: keep)\n"
+            "ramp <channel>,<duty>,<ms>[,<curve>] - Ramp SSR duty (linear/in/out/s)\n"
+            "wave <channel>,load|play|stop|clear|status,... - SSR duty waveform\n"
             "get <channel> - Get SSR duty cycle\n"
             "rgb <led_id> <r> <g> <b> - Set RGB LED color\n"
             "rgbget <led_id> - Get RGB LED color\n"
@@ -410,13 +649,48 @@ void UDPController::processCommand(const char* command, int length) {
             "ws2812sys <system> <r> <g> <b> - Set WS2812 system color\n"
             "ws2812off <system> - Turn off WS2812 system\n"
             "freq <channel> <freq> - Set SSR frequency\n"
-            "zerox - Show zero-cross detection status");
+            "zerox - Show zero-cross detection status\n"
+            "isrstats [reset] - Show/reset SSR interrupt handler cycle counts\n"
+            "jitter [reset] - Show/reset triac firing jitter histograms\n"
+            "trace start|stop|reset|status|dump <seq> - SSR edge trace (SSR_TRACE_ENABLED)");
+        sendResponse(_send_buffer);
+        
+        // 3番目のパートを送信
+        snprintf(_send_buffer, MAX_BUFFER_SIZE,
+            "Available commands (Part 3/4):\n"
+            "keyframe <led_id>,once|loop|pingpong,<ms>,<r>,<g>,<b>,<ease>,... - RGB keyframes (ease: linear/in/out/s/step/cubicin/cubicout/cubic/sinein/sineout/sine)\n"
+            "keyframe <led_id>,stop|status - Stop / show RGB keyframe animation\n"
+            "fade <led_id>,<r>,<g>,<b>,<ms>[,<ease>[,<gamma>]] - RGB transition (gamma: linear/gamma22/cie)\n"
+            "cue add <ms>,<command> - Add a command to the cue list\n"
+            "cue go [<delay_ms>]|stop|clear|status|list - Play / stop / clear / show the cue list\n"
+            "mist <ms>[,retrigger|extend|queue] / mist seq <on>,<off>,... / mist stop|status - Timed mist\n"
+            "air <level>[,<ms>[,<mode>]] / air status - Air level (with <ms>: pulse, then back)\n"
+            "trigger add <id>,ssr|rgb|mist|air,... / clear|list|fire <id> / stats [reset] - Pre-armed triggers");
+        sendResponse(_send_buffer);
+        
+        // 4番目のパートを送信
+        snprintf(_send_buffer, MAX_BUFFER_SIZE,
+            "Available commands (Part 4/4):\n"
+            "time [status|now] / time master <ip>[,<port>]|off - Device time sync\n"
+            "@<device_us> <command> / @z<half_cycle> <command> - Execute at a device time / half-cycle\n"
+            "sched status|now|clear / sched late run|drop[,<tolerance_us>] - Execute-at scheduler\n"
+            "config unit <index>|none|status - Unit index (0-254)\n"
+            "config mcast fleet|zone <ip>|off / port <port> / status - Multicast groups (no replies)\n"
+            "unit <a>[-<b>] <command> / slice <first>;<cmd>;<cmd>;... - Command for a unit range / per-unit slice\n"
+            "#<seq>[:<stream>] <command> - Drop duplicate / out-of-order updates (no reply when dropped)\n"
+            "seq [status|reset] - Sequence number statistics\n"
+            "queue [status|reset] - Command queue depth / drops\n"
+            "!<command> - No reply for this packet\n"
+            "reply all|errors|none|ack <n>|status - Reply mode for this sender\n"
+            "subscribe <ms> <ssr,rgb,zerox,ws|all> [<lease_s>] / subscribe status / unsubscribe - Push telemetry\n"
+            "state / stateb - Full state snapshot (text / binary)");
         sendResponse(_send_buffer);
     }
     else if (strncmp(cmd, "debug level ", 12) == 0) {
         int level = atoi(cmd + 12);
         if (level >= 0 && level <= 3) {
-            _config_manager->setDebugLevel(level);
+            _config_manager->setDebugLevel(level, false);
+            saveConfigUnlocked();
             snprintf(_send_buffer, MAX_BUFFER_SIZE, "Debug level set to: %d", level);
             sendResponse(_send_buffer);
         } else {
@@ -434,16 +708,19 @@ void UDPController::processCommand(const char* command, int length) {
             "Configuration:\n"
             "SSR-LED Link: %s\n"
             "Transition Time: %d ms\n"
-            "Debug Level: %d",
+            "Debug Level: %d\n"
+            "Unit Index: %d",
             _config_manager->isSSRLinkEnabled() ? "Enabled" : "Disabled",
             _config_manager->getSSRLinkTransitionTime(),
-            _config_manager->getDebugLevel());
+            _config_manager->getDebugLevel(),
+            _config_manager->getUnitIndex() == UNIT_INDEX_NONE ? -1 : _config_manager->getUnitIndex());
         sendResponse(_send_buffer);
     }
     else if (strncmp(cmd, "config ssrlink ", 15) == 0) {
         const char* value = cmd + 15;
         if (strcmp(value, "on") == 0 || strcmp(value, "1") == 0) {
             _config_manager->setSSRLink(true);
+            _rgb_led_driver.requestSSRLinkRefresh();
             snprintf(_send_buffer, MAX_BUFFER_SIZE, "SSR-LED link enabled");
             sendResponse(_send_buffer);
         } else if (strcmp(value, "off") == 0 || strcmp(value, "0") == 0) {
@@ -485,6 +762,7 @@ void UDPController::processCommand(const char* command, int length) {
                 if (led_id >= 1 && led_id <= 4 &&
                     r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255) {
                     _config_manager->setSSRLinkColor0(led_id, r, g, b);
+                    _rgb_led_driver.requestSSRLinkRefresh();
                     snprintf(_send_buffer, MAX_BUFFER_SIZE, "LED%d 0%% color set to R:%d G:%d B:%d", 
                         led_id, r, g, b);
                     sendResponse(_send_buffer);
@@ -524,6 +802,7 @@ void UDPController::processCommand(const char* command, int length) {
                 if (led_id >= 1 && led_id <= 4 &&
                     r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255) {
                     _config_manager->setSSRLinkColor100(led_id, r, g, b);
+                    _rgb_led_driver.requestSSRLinkRefresh();
                     snprintf(_send_buffer, MAX_BUFFER_SIZE, "LED%d 100%% color set to R:%d G:%d B:%d", 
                         led_id, r, g, b);
                     sendResponse(_send_buffer);
@@ -537,6 +816,70 @@ void UDPController::processCommand(const char* command, int length) {
             }
         }
     }
+    else if (strcmp(cmd, "config link status") == 0) {
+        int pos = snprintf(_send_buffer, MAX_BUFFER_SIZE, "SSR-LED link matrix (%s):",
+            _config_manager->isSSRLinkEnabled() ? "enabled" : "disabled");
+        for (int t = 0; t < SSR_LINK_TARGETS && pos < MAX_BUFFER_SIZE; t++) {
+            uint8_t ssr_id = _config_manager->getSSRLinkSource(t);
+            RGBColorData c0 = _config_manager->getSSRLinkTargetColor0(t);
+            RGBColorData c1 = _config_manager->getSSRLinkTargetColor100(t);
+            if (ssr_id == 0) {
+                pos += snprintf(_send_buffer + pos, MAX_BUFFER_SIZE - pos, "\n%s: none",
+                    ConfigManager::getSSRLinkTargetName(t));
+            } else {
+                pos += snprintf(_send_buffer + pos, MAX_BUFFER_SIZE - pos,
+                    "\n%s: SSR%d %s %d,%d,%d -> %d,%d,%d",
+                    ConfigManager::getSSRLinkTargetName(t), ssr_id,
+                    ConfigManager::getSSRLinkCurveName(_config_manager->getSSRLinkCurve(t)),
+                    c0.r, c0.g, c0.b, c1.r, c1.g, c1.b);
+            }
+        }
+        sendResponse(_send_buffer);
+    }
+    else if (strncmp(cmd, "config link ", 12) == 0) {
+        // config link <target>,<ssr>[,<curve>]
+        char target_name[8] = {0};
+        char curve_name[12] = {0};
+        int ssr_id;
+        int n = sscanf(cmd + 12, "%7[^,],%d,%11s", target_name, &ssr_id, curve_name);
+        int target = ConfigManager::parseSSRLinkTarget(target_name);
+        int curve = (n >= 3) ? ConfigManager::parseSSRLinkCurve(curve_name) : SSR_LINK_CURVE_LINEAR;
+        if (n < 2 || target < 0 || ssr_id < 0 || ssr_id > 4 || curve < 0) {
+            snprintf(_send_buffer, MAX_BUFFER_SIZE,
+                "Error: Use config link <rgb1-4|ws1-3>,<ssr 0-4>[,linear|easein|easeout|step]");
+        } else {
+            _config_manager->setSSRLinkSource(target, ssr_id, curve);
+            _rgb_led_driver.requestSSRLinkRefresh();
+            if (ssr_id == 0) {
+                snprintf(_send_buffer, MAX_BUFFER_SIZE, "%s unlinked", target_name);
+            } else {
+                snprintf(_send_buffer, MAX_BUFFER_SIZE, "%s linked to SSR%d (%s)",
+                    target_name, ssr_id, ConfigManager::getSSRLinkCurveName(curve));
+            }
+        }
+        sendResponse(_send_buffer);
+    }
+    else if (strncmp(cmd, "config wsrgb0 ", 14) == 0 || strncmp(cmd, "config wsrgb100 ", 16) == 0) {
+        bool is_100 = strncmp(cmd, "config wsrgb100 ", 16) == 0;
+        const char* args = cmd + (is_100 ? 16 : 14);
+        int sys, r, g, b;
+        if (sscanf(args, "%d,%d,%d,%d", &sys, &r, &g, &b) == 4 &&
+            sys >= 1 && sys <= 3 &&
+            r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255) {
+            int target = SSR_LINK_TARGET_WS2812 + sys - 1;
+            if (is_100) {
+                _config_manager->setSSRLinkTargetColor100(target, r, g, b);
+            } else {
+                _config_manager->setSSRLinkTargetColor0(target, r, g, b);
+            }
+            _rgb_led_driver.requestSSRLinkRefresh();
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "WS2812 system %d %s%% color set to R:%d G:%d B:%d",
+                sys, is_100 ? "100" : "0", r, g, b);
+        } else {
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "Error: Use config wsrgb0|wsrgb100 <sys 1-3>,<r>,<g>,<b>");
+        }
+        sendResponse(_send_buffer);
+    }
     else if (strncmp(cmd, "config trans ", 13) == 0 || strncmp(cmd, "config t ", 10) == 0) {
         const char* args = strncmp(cmd, "config trans ", 13) == 0 ? cmd + 13 : cmd + 10;
         if (strcmp(args, "status") == 0) {
@@ -570,7 +913,8 @@ void UDPController::processCommand(const char* command, int length) {
             snprintf(_send_buffer, MAX_BUFFER_SIZE, "Error: Invalid value (0-255)");
             sendResponse(_send_buffer);
         } else {
-            _config_manager->setRandomRGBTimeout10s((uint8_t)value);
+            _config_manager->setRandomRGBTimeout10s((uint8_t)value, false);
+            saveConfigUnlocked();
             snprintf(_send_buffer, MAX_BUFFER_SIZE, "config random rgb set to %d (x10s)", value);
             sendResponse(_send_buffer);
         }
@@ -614,7 +958,8 @@ void UDPController::processCommand(const char* command, int length) {
             // 周波数を設定するコマンド（既存）
             int freq = atoi(args);
             if (freq >= -1 && freq <= 10) {
-                _config_manager->setSSRPWMFrequency(freq);
+                _config_manager->setSSRPWMFrequency(freq, false);
+                saveConfigUnlocked();
                 if (freq == -1) {
                     snprintf(_send_buffer, MAX_BUFFER_SIZE, "All SSR PWM frequencies set to -1 (設定変更無効)");
                 } else {
@@ -627,8 +972,25 @@ void UDPController::processCommand(const char* command, int length) {
             }
         }
     }
+    else if (strncmp(cmd, "config unit ", 12) == 0) {
+        processUnitConfigCommand(cmd + 12);
+    }
+    else if (strncmp(cmd, "config mcast ", 13) == 0) {
+        processMcastConfigCommand(cmd + 13);
+    }
     else if (strcmp(cmd, "config load") == 0) {
-        _config_manager->loadConfig();
+        // EEPROMの読み出しは排他を外して行い、検証・反映は排他中に行う
+        ConfigData data;
+        bool suppress = releaseCommandLock();
+        bool read = _config_manager->readConfig(data);
+        reacquireCommandLock(suppress);
+        if (read) {
+            _config_manager->loadConfig(data);
+        } else {
+            log_printf(LOG_LEVEL_ERROR, "Failed to read from EEPROM");
+        }
+        _rgb_led_driver.requestSSRLinkRefresh();
+        applyMulticastGroups();
         snprintf(_send_buffer, MAX_BUFFER_SIZE, "Configuration loaded");
         sendResponse(_send_buffer);
     }
@@ -639,7 +1001,7 @@ void UDPController::processCommand(const char* command, int length) {
             _config_manager->setSSRPWMFrequency(i, current_freq, false);
         }
         
-        _config_manager->saveConfig();
+        saveConfigUnlocked();
         snprintf(_send_buffer, MAX_BUFFER_SIZE, "Configuration saved (including current SSR frequencies)");
         sendResponse(_send_buffer);
     }
@@ -648,6 +1010,12 @@ void UDPController::processCommand(const char* command, int length) {
     } else if (strncmp(cmd, "ssr ", 4) == 0) {
         // SSR command is an alias for SET command
         processSetCommand(cmd + 4);
+    } else if (strncmp(cmd, "setall ", 7) == 0) {
+        processSetAllCommand(cmd + 7);
+    } else if (strncmp(cmd, "ramp ", 5) == 0) {
+        processRampCommand(cmd + 5);
+    } else if (strncmp(cmd, "wave ", 5) == 0) {
+        processWaveCommand(cmd + 5);
     } else if (strncmp(cmd, "freq ", 5) == 0) {
         processFreqCommand(cmd + 5);
     } else if (strncmp(cmd, "get ", 4) == 0) {
@@ -656,6 +1024,10 @@ void UDPController::processCommand(const char* command, int length) {
         processRGBCommand(cmd + 4);
     } else if (strncmp(cmd, "rgbget ", 7) == 0) {
         processRGBGetCommand(cmd + 7);
+    } else if (strncmp(cmd, "keyframe ", 9) == 0) {
+        processKeyframeCommand(cmd + 9);
+    } else if (strncmp(cmd, "fade ", 5) == 0) {
+        processFadeCommand(cmd + 5);
     } else if (strncmp(cmd, "ws2812 ", 7) == 0) {
         processWS2812Command(cmd + 7);
     } else if (strncmp(cmd, "ws2812get ", 10) == 0) {
@@ -674,6 +1046,44 @@ void UDPController::processCommand(const char* command, int length) {
         processAirCommand(cmd + 4);
     } else if (strcmp(cmd, "zerox") == 0) {
         processZeroCrossCommand();
+    } else if (strcmp(cmd, "isrstats") == 0) {
+        processIsrStatsCommand("");
+    } else if (strncmp(cmd, "isrstats ", 9) == 0) {
+        processIsrStatsCommand(cmd + 9);
+    } else if (strncmp(cmd, "trace ", 6) == 0) {
+        processTraceCommand(cmd + 6);
+    } else if (strncmp(cmd, "cue ", 4) == 0) {
+        processCueCommand(cmd + 4);
+    } else if (strncmp(cmd, "trigger ", 8) == 0) {
+        processTriggerCommand(cmd + 8);
+    } else if (strcmp(cmd, "time") == 0) {
+        processTimeCommand("status");
+    } else if (strncmp(cmd, "time ", 5) == 0) {
+        processTimeCommand(cmd + 5);
+    } else if (strncmp(cmd, "sched ", 6) == 0) {
+        processSchedCommand(cmd + 6);
+    } else if (strcmp(cmd, "state") == 0) {
+        processStateCommand(false);
+    } else if (strcmp(cmd, "stateb") == 0) {
+        processStateCommand(true);
+    } else if (strncmp(cmd, "subscribe ", 10) == 0) {
+        processSubscribeCommand(cmd + 10);
+    } else if (strcmp(cmd, "unsubscribe") == 0) {
+        processUnsubscribeCommand();
+    } else if (strncmp(cmd, "reply ", 6) == 0) {
+        processReplyCommand(cmd + 6);
+    } else if (strcmp(cmd, "seq") == 0) {
+        processSeqCommand("status");
+    } else if (strncmp(cmd, "seq ", 4) == 0) {
+        processSeqCommand(cmd + 4);
+    } else if (strcmp(cmd, "queue") == 0) {
+        processQueueCommand("status");
+    } else if (strncmp(cmd, "queue ", 6) == 0) {
+        processQueueCommand(cmd + 6);
+    } else if (strcmp(cmd, "jitter") == 0) {
+        processJitterCommand("");
+    } else if (strncmp(cmd, "jitter ", 7) == 0) {
+        processJitterCommand(cmd + 7);
     } else {
         // Unknown command
         snprintf(_send_buffer, MAX_BUFFER_SIZE, "Error: Unknown command");
@@ -721,10 +1131,9 @@ void UDPController::processSetCommand(const char* args) {
     
     // id=0 targets all SSRs
     if (id == 0) {
-        // Set all SSRs
-        for (int i = 1; i <= 4; i++) {
-            success &= _ssr_driver.setDutyLevel(i, value);
-        }
+        // Set all SSRs (same zero-cross)
+        const uint8_t levels[4] = {(uint8_t)value, (uint8_t)value, (uint8_t)value, (uint8_t)value};
+        success = _ssr_driver.setAllDutyLevels(0x0F, levels);
     } else {
         // Set specific SSR
         success = _ssr_driver.setDutyLevel(id, value);
@@ -741,6 +1150,235 @@ void UDPController::processSetCommand(const char* args) {
     sendResponse(_send_buffer);
 }
 
+void UDPController::processSetAllCommand(const char* args) {
+    // Parse arguments: d1,d2,d3,d4 ("-" keeps the channel unchanged)
+    uint8_t levels[4] = {0, 0, 0, 0};
+    uint8_t mask = 0;
+    const char* p = args;
+    
+    for (int i = 0; i < 4; i++) {
+        while (*p == ' ') {
+            p++;
+        }
+        
+        if (*p == '-' && (p[1] == ',' || p[1] == '\0' || p[1] == ' ')) {
+            // 変更なし
+            p++;
+        } else {
+            char* end = nullptr;
+            long value = strtol(p, &end, 10);
+            if (end == p || value < 0 || value > 100) {
+                log_printf(LOG_LEVEL_WARN, "SETALL command parameter error: %s", args);
+                generateErrorResponse(args);
+                return;
+            }
+            levels[i] = (uint8_t)value;
+            mask |= (1 << i);
+            p = end;
+        }
+        
+        while (*p == ' ') {
+            p++;
+        }
+        if (i < 3) {
+            if (*p != ',') {
+                log_printf(LOG_LEVEL_WARN, "SETALL command parse error: %s", args);
+                generateErrorResponse(args);
+                return;
+            }
+            p++;
+        }
+    }
+    
+    if (*p != '\0') {
+        log_printf(LOG_LEVEL_WARN, "SETALL command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    log_printf(LOG_LEVEL_DEBUG, "SETALL command: mask=0x%X", mask);
+    
+    // 全チャンネル変更なしの場合は何もしない
+    bool success = (mask == 0) || _ssr_driver.setAllDutyLevels(mask, levels);
+    
+    // Generate response
+    char values[4][4];
+    for (int i = 0; i < 4; i++) {
+        if (mask & (1 << i)) {
+            snprintf(values[i], sizeof(values[i]), "%d", levels[i]);
+        } else {
+            snprintf(values[i], sizeof(values[i]), "-");
+        }
+    }
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "setall %s,%s,%s,%s,%s",
+             values[0], values[1], values[2], values[3], success ? "OK" : "ERROR");
+    
+    log_printf(success ? LOG_LEVEL_DEBUG : LOG_LEVEL_ERROR, 
+               "SETALL command result: %s", success ? "SUCCESS" : "FAILED");
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processRampCommand(const char* args) {
+    // Parse arguments: id,target,duration_ms[,curve]
+    int id;
+    int target;
+    int duration_ms;
+    char curve_str[16] = {0};
+    
+    int parsed = sscanf(args, "%d,%d,%d,%15s", &id, &target, &duration_ms, curve_str);
+    if (parsed < 3) {
+        log_printf(LOG_LEVEL_WARN, "RAMP command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // Process curve (name or number)
+    SSRRampCurve curve = SSR_RAMP_LINEAR;
+    if (parsed == 4) {
+        if (strcmp(curve_str, "linear") == 0 || strcmp(curve_str, "0") == 0) {
+            curve = SSR_RAMP_LINEAR;
+        } else if (strcmp(curve_str, "in") == 0 || strcmp(curve_str, "1") == 0) {
+            curve = SSR_RAMP_EASE_IN;
+        } else if (strcmp(curve_str, "out") == 0 || strcmp(curve_str, "2") == 0) {
+            curve = SSR_RAMP_EASE_OUT;
+        } else if (strcmp(curve_str, "s") == 0 || strcmp(curve_str, "3") == 0) {
+            curve = SSR_RAMP_S_CURVE;
+        } else {
+            log_printf(LOG_LEVEL_WARN, "RAMP command curve error: %s", curve_str);
+            generateErrorResponse(args);
+            return;
+        }
+    }
+    
+    // Check parameters
+    if (id < 0 || id > 4 || target < 0 || target > 100 || duration_ms < 0 || duration_ms > 600000) {
+        log_printf(LOG_LEVEL_WARN, "RAMP command parameter error: id=%d, target=%d, ms=%d", id, target, duration_ms);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    log_printf(LOG_LEVEL_DEBUG, "RAMP command: id=%d, target=%d, ms=%d, curve=%d", id, target, duration_ms, curve);
+    
+    bool success = true;
+    
+    // id=0 targets all SSRs
+    if (id == 0) {
+        for (int i = 1; i <= 4; i++) {
+            success &= _ssr_driver.startRamp(i, target, duration_ms, curve);
+        }
+    } else {
+        success = _ssr_driver.startRamp(id, target, duration_ms, curve);
+    }
+    
+    // Generate response
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "ramp %d,%d,%d,%d,%s", 
+             id, target, duration_ms, curve, success ? "OK" : "ERROR");
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processWaveCommand(const char* args) {
+    // Parse arguments: id,subcommand[,params...]
+    int id;
+    char sub[16] = {0};
+    int consumed = 0;
+    
+    if (sscanf(args, "%d,%15[a-z]%n", &id, sub, &consumed) != 2) {
+        log_printf(LOG_LEVEL_WARN, "WAVE command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // Check parameters
+    if (id < 1 || id > 4) {
+        log_printf(LOG_LEVEL_WARN, "WAVE command parameter error: id=%d", id);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    const char* params = args + consumed;
+    if (*params == ',') {
+        params++;
+    }
+    
+    bool success = false;
+    
+    if (strcmp(sub, "load") == 0) {
+        // load,<offset>,<v1>,<v2>,...
+        char* p = nullptr;
+        long offset = strtol(params, &p, 10);
+        if (p == params || offset < 0 || offset >= SSR_WAVE_MAX_POINTS) {
+            generateErrorResponse(args);
+            return;
+        }
+        
+        static uint8_t values[SSR_WAVE_MAX_POINTS];
+        uint16_t count = 0;
+        while (*p == ',' && offset + count < SSR_WAVE_MAX_POINTS) {
+            const char* start = p + 1;
+            long v = strtol(start, &p, 10);
+            if (p == start || v < 0 || v > 100) {
+                log_printf(LOG_LEVEL_WARN, "WAVE load value error at %d", count);
+                generateErrorResponse(args);
+                return;
+            }
+            values[count++] = (uint8_t)v;
+        }
+        // テーブルの末尾を超える値（または不正な文字）が残っていればエラー
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p != '\0') {
+            log_printf(LOG_LEVEL_WARN, "WAVE load exceeds table (%d points) at %d", SSR_WAVE_MAX_POINTS, count);
+            generateErrorResponse(args);
+            return;
+        }
+
+        success = count > 0 && _ssr_driver.loadWaveform(id, (uint16_t)offset, values, count);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "wave %d,load,%ld,%d,%s",
+                 id, offset, count, success ? "OK" : "ERROR");
+    } else if (strcmp(sub, "play") == 0) {
+        // play,<divider>[,loop|once]
+        int divider = 1;
+        char mode[8] = "loop";
+        int parsed = sscanf(params, "%d,%7s", &divider, mode);
+        if (parsed < 1 || divider < 1 || divider > 65535 ||
+            (strcmp(mode, "loop") != 0 && strcmp(mode, "once") != 0)) {
+            generateErrorResponse(args);
+            return;
+        }
+        
+        success = _ssr_driver.playWaveform(id, (uint16_t)divider, strcmp(mode, "loop") == 0);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "wave %d,play,%d,%s,%s",
+                 id, divider, mode, success ? "OK" : "ERROR");
+    } else if (strcmp(sub, "stop") == 0) {
+        success = _ssr_driver.stopWaveform(id);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "wave %d,stop,%s", id, success ? "OK" : "ERROR");
+    } else if (strcmp(sub, "clear") == 0) {
+        success = _ssr_driver.clearWaveform(id);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "wave %d,clear,%s", id, success ? "OK" : "ERROR");
+    } else if (strcmp(sub, "status") == 0) {
+        uint16_t length, position;
+        bool playing;
+        success = _ssr_driver.getWaveformStatus(id, length, position, playing);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "wave %d,status,%d,%d,%s,%s",
+                 id, length, position, playing ? "PLAYING" : "STOPPED", success ? "OK" : "ERROR");
+    } else {
+        log_printf(LOG_LEVEL_WARN, "WAVE command unknown subcommand: %s", sub);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    log_printf(success ? LOG_LEVEL_DEBUG : LOG_LEVEL_ERROR, 
+               "WAVE command result: %s", success ? "SUCCESS" : "FAILED");
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
 void UDPController::processFreqCommand(const char* args) {
     // Parse arguments
     int id;
@@ -825,14 +1463,16 @@ void UDPController::processRGBCommand(const char* args) {
     
     bool success = true;
     
-    // id=0 targets all RGB LEDs
+    // id=0 targets all RGB LEDs（キーフレーム再生中なら停止してから設定）
     if (id == 0) {
         // Set all RGB LEDs
         for (int i = 1; i <= 4; i++) {
+            _rgb_led_driver.stopKeyframes(i);
             success &= _rgb_led_driver.setColor(i, r, g, b);
         }
     } else {
         // Set specific RGB LED
+        _rgb_led_driver.stopKeyframes(id);
         success = _rgb_led_driver.setColor(id, r, g, b);
     }
     
@@ -878,17 +1518,187 @@ void UDPController::processRGBGetCommand(const char* args) {
     sendResponse(_send_buffer);
 }
 
-void UDPController::processSofiaCommand() {
-    // Cute Sofia
-    strcpy(_send_buffer, "sofia,KAWAII,OK");
-    
-    // Send response
-    sendResponse(_send_buffer);
-}
-
-void UDPController::processInfoCommand() {
-    // バージョン情報を取得
-    VersionInfo version = getVersionInfo();
+void UDPController::processKeyframeCommand(const char* args) {
+    // Parse arguments: id,mode|stop|status[,ms,r,g,b,ease,...]
+    int id;
+    char sub[16] = {0};
+    int consumed = 0;
+    
+    if (sscanf(args, "%d,%15[a-z]%n", &id, sub, &consumed) != 2) {
+        log_printf(LOG_LEVEL_WARN, "KEYFRAME command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // Check parameters（id=0は全LED）
+    if (id < 0 || id > 4) {
+        log_printf(LOG_LEVEL_WARN, "KEYFRAME command parameter error: id=%d", id);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    int first = (id == 0) ? 1 : id;
+    int last = (id == 0) ? 4 : id;
+    bool success = true;
+    
+    if (strcmp(sub, "stop") == 0) {
+        for (int i = first; i <= last; i++) {
+            success &= _rgb_led_driver.stopKeyframes(i);
+        }
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "keyframe %d,stop,%s", id, success ? "OK" : "ERROR");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strcmp(sub, "status") == 0) {
+        if (id == 0) {
+            generateErrorResponse(args);
+            return;
+        }
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "keyframe %d,status,%s,OK",
+                 id, _rgb_led_driver.isKeyframeActive(id) ? "PLAYING" : "STOPPED");
+        sendResponse(_send_buffer);
+        return;
+    }
+    
+    // 再生モード
+    RGBKeyframeMode mode;
+    if (strcmp(sub, "once") == 0) {
+        mode = RGB_KEYFRAME_ONCE;
+    } else if (strcmp(sub, "loop") == 0) {
+        mode = RGB_KEYFRAME_LOOP;
+    } else if (strcmp(sub, "pingpong") == 0) {
+        mode = RGB_KEYFRAME_PINGPONG;
+    } else {
+        log_printf(LOG_LEVEL_WARN, "KEYFRAME command unknown mode: %s", sub);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // キーフレーム: <ms>,<r>,<g>,<b>,<ease> の繰り返し
+    RGBKeyframe frames[RGB_KEYFRAME_MAX];
+    uint8_t count = 0;
+    const char* p = args + consumed;
+    while (*p == ',') {
+        if (count >= RGB_KEYFRAME_MAX) {
+            log_printf(LOG_LEVEL_WARN, "KEYFRAME command too many keyframes (max %d)", RGB_KEYFRAME_MAX);
+            generateErrorResponse(args);
+            return;
+        }
+        int ms, r, g, b, n = 0;
+        char ease[12] = {0};
+        if (sscanf(p, ",%d,%d,%d,%d,%11[^,]%n", &ms, &r, &g, &b, ease, &n) != 5 ||
+            ms < 0 || ms > 3600000 || r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) {
+            log_printf(LOG_LEVEL_WARN, "KEYFRAME command keyframe error at %d", count);
+            generateErrorResponse(args);
+            return;
+        }
+        p += n;
+        
+        RGBKeyframe& f = frames[count++];
+        f.time_ms = (uint32_t)ms;
+        f.r = (uint8_t)r;
+        f.g = (uint8_t)g;
+        f.b = (uint8_t)b;
+        int easing = RGBLEDDriver::parseEasing(ease);
+        if (easing < 0) {
+            log_printf(LOG_LEVEL_WARN, "KEYFRAME command easing error: %s", ease);
+            generateErrorResponse(args);
+            return;
+        }
+        f.easing = (uint8_t)easing;
+    }
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (count == 0 || *p != '\0') {
+        generateErrorResponse(args);
+        return;
+    }
+    
+    for (int i = first; i <= last; i++) {
+        success &= _rgb_led_driver.loadKeyframes(i, frames, count, mode);
+    }
+    
+    log_printf(success ? LOG_LEVEL_DEBUG : LOG_LEVEL_ERROR,
+               "KEYFRAME command: id=%d, mode=%s, count=%d, %s", id, sub, count, success ? "SUCCESS" : "FAILED");
+    
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "keyframe %d,%s,%d,%s", id, sub, count, success ? "OK" : "ERROR");
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processFadeCommand(const char* args) {
+    // Parse arguments: id,r,g,b,ms[,ease[,gamma]]
+    int id, r, g, b, ms;
+    int consumed = 0;
+    
+    if (sscanf(args, "%d,%d,%d,%d,%d%n", &id, &r, &g, &b, &ms, &consumed) != 5) {
+        log_printf(LOG_LEVEL_WARN, "FADE command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // 補間カーブ・ガンマ（省略時は線形・現在のガンマを維持）
+    char ease_name[12] = {0};
+    char gamma_name[12] = {0};
+    int easing = RGB_EASE_LINEAR;
+    int gamma = RGB_GAMMA_KEEP;
+    const char* p = args + consumed;
+    if (*p == ',') {
+        int n = 0;
+        if (sscanf(p, ",%11[a-z0-9]%n", ease_name, &n) != 1 || (easing = RGBLEDDriver::parseEasing(ease_name)) < 0) {
+            log_printf(LOG_LEVEL_WARN, "FADE command easing error: %s", p);
+            generateErrorResponse(args);
+            return;
+        }
+        p += n;
+    }
+    if (*p == ',') {
+        int n = 0;
+        if (sscanf(p, ",%11[a-z0-9]%n", gamma_name, &n) != 1 || (gamma = RGBLEDDriver::parseGamma(gamma_name)) < 0) {
+            log_printf(LOG_LEVEL_WARN, "FADE command gamma error: %s", p);
+            generateErrorResponse(args);
+            return;
+        }
+        p += n;
+    }
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    
+    // Check parameters（id=0は全LED）
+    if (*p != '\0' || id < 0 || id > 4 || r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255 ||
+        ms < 0 || ms > 65535) {
+        log_printf(LOG_LEVEL_WARN, "FADE command parameter error: id=%d, r=%d, g=%d, b=%d, ms=%d", id, r, g, b, ms);
+        generateErrorResponse(args);
+        return;
+    }
+    
+    int first = (id == 0) ? 1 : id;
+    int last = (id == 0) ? 4 : id;
+    bool success = true;
+    for (int i = first; i <= last; i++) {
+        success &= _rgb_led_driver.setColorWithTransition(i, r, g, b, (uint16_t)ms, RGB_SOURCE_UDP,
+                                                          (uint8_t)easing, (uint8_t)gamma);
+    }
+    
+    uint8_t shown_gamma = (gamma == RGB_GAMMA_KEEP) ? _rgb_led_driver.getGamma(first) : (uint8_t)gamma;
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "fade %d,%d,%d,%d,%d,%s,%s,%s",
+             id, r, g, b, ms, RGBLEDDriver::getEasingName(easing),
+             RGBLEDDriver::getGammaName(shown_gamma), success ? "OK" : "ERROR");
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processSofiaCommand() {
+    // Cute Sofia
+    strcpy(_send_buffer, "sofia,KAWAII,OK");
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processInfoCommand() {
+    // バージョン情報を取得
+    VersionInfo version = getVersionInfo();
     
     // Generate device information
     snprintf(_send_buffer, MAX_BUFFER_SIZE, "info,%s,%s,OK", 
@@ -899,85 +1709,171 @@ void UDPController::processInfoCommand() {
 }
 
 void UDPController::processMistCommand(const char* args) {
-    // Parse arguments
-    int duration;
+    ActuatorStatus status;
+    
+    if (strcmp(args, "status") == 0) {
+        _actuators.getStatus(ACTUATOR_MIST, status);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "mist status,%s,%lu,%d,OK",
+                 status.level ? "ON" : "OFF", (unsigned long)(status.remaining_us / 1000), status.queued);
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strcmp(args, "stop") == 0) {
+        bool success = _actuators.stop(ACTUATOR_MIST);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "mist stop,%s", success ? "OK" : "ERROR");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strncmp(args, "seq ", 4) == 0) {
+        // ON/OFFを交互に繰り返すパルス列: <on_ms>,<off_ms>,<on_ms>,...
+        ActuatorStep steps[ACTUATOR_MAX_STEPS];
+        uint8_t count = 0;
+        const char* p = args + 4;
+        for (;;) {
+            int ms, n = 0;
+            if (count >= ACTUATOR_MAX_STEPS || sscanf(p, "%d%n", &ms, &n) != 1 || ms <= 0 || ms > 10000) {
+                log_printf(LOG_LEVEL_WARN, "MIST seq parse error: %s", args);
+                generateErrorResponse(args);
+                return;
+            }
+            steps[count].level = (count % 2 == 0) ? 1 : 0;
+            steps[count].duration_us = (uint32_t)ms * 1000;
+            count++;
+            p += n;
+            if (*p != ',') {
+                break;
+            }
+            p++;
+        }
+        bool success = _actuators.sequence(ACTUATOR_MIST, steps, count, ACTUATOR_RETRIGGER);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "mist seq %d,%s", count, success ? "OK" : "ERROR");
+        sendResponse(_send_buffer);
+        return;
+    }
     
-    if (sscanf(args, "%d", &duration) != 1) {
+    // Parse arguments: duration[,mode]
+    int duration;
+    char mode_name[12] = {0};
+    int parsed = sscanf(args, "%d,%11[a-z]", &duration, mode_name);
+    if (parsed < 1) {
         log_printf(LOG_LEVEL_WARN, "MIST command parse error: %s", args);
         generateErrorResponse(args);
         return;
     }
+    int mode = (parsed == 2) ? ActuatorController::parsePulseMode(mode_name) : ACTUATOR_RETRIGGER;
     
     // Check parameters
-    if (duration < 0 || duration > 10000) {  // Maximum 10 seconds
+    if (duration < 0 || duration > 10000 || mode < 0) {  // Maximum 10 seconds
         log_printf(LOG_LEVEL_WARN, "MIST command parameter error: duration=%d", duration);
         generateErrorResponse(args);
         return;
     }
     
-    log_printf(LOG_LEVEL_DEBUG, "MIST command: duration=%d ms", duration);
+    log_printf(LOG_LEVEL_DEBUG, "MIST command: duration=%d ms (%s)", duration, ActuatorController::getPulseModeName(mode));
     
-    // Set all colors to 100% for RGB LED 1
-    bool success = _rgb_led_driver.setColor(1, 255, 255, 255);
-    
-    // Set asynchronous processing parameters
-    _mist_active = true;
-    _mist_start_time = us_ticker_read() / 1000;  // Convert to milliseconds
-    _mist_duration = duration;
+    // 0は即時停止、それ以外はタイマーで指定時間後にOFF
+    bool success;
+    if (duration == 0) {
+        success = _actuators.stop(ACTUATOR_MIST);
+    } else {
+        success = _actuators.pulse(ACTUATOR_MIST, 1, (uint32_t)duration * 1000, (ActuatorPulseMode)mode);
+    }
     
     // Generate response
-    snprintf(_send_buffer, MAX_BUFFER_SIZE, "mist %d,%s", 
-             duration, success ? "OK" : "ERROR");
+    if (parsed == 2) {
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "mist %d,%s,%s",
+                 duration, ActuatorController::getPulseModeName(mode), success ? "OK" : "ERROR");
+    } else {
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "mist %d,%s", 
+                 duration, success ? "OK" : "ERROR");
+    }
     
     // Send response
     sendResponse(_send_buffer);
 }
 
 void UDPController::processAirCommand(const char* args) {
-    // Parse arguments
-    int level;
+    if (strcmp(args, "status") == 0) {
+        ActuatorStatus status;
+        _actuators.getStatus(ACTUATOR_AIR, status);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "air status,%d,%d,%lu,%d,OK",
+                 (int)status.level, (int)status.rest_level, (unsigned long)(status.remaining_us / 1000), status.queued);
+        sendResponse(_send_buffer);
+        return;
+    }
     
-    if (sscanf(args, "%d", &level) != 1) {
+    // Parse arguments: level[,ms[,mode]]
+    int level;
+    int duration = 0;
+    char mode_name[12] = {0};
+    int parsed = sscanf(args, "%d,%d,%11[a-z]", &level, &duration, mode_name);
+    if (parsed < 1) {
         log_printf(LOG_LEVEL_WARN, "AIR command parse error: %s", args);
         generateErrorResponse(args);
         return;
     }
+    int mode = (parsed == 3) ? ActuatorController::parsePulseMode(mode_name) : ACTUATOR_RETRIGGER;
     
     // Check parameters
-    if (level < 0 || level > 2) {
+    if (level < 0 || level > 2 || duration < 0 || duration > 60000 || mode < 0) {
         log_printf(LOG_LEVEL_WARN, "AIR command parameter error: level=%d", level);
         generateErrorResponse(args);
         return;
     }
     
-    log_printf(LOG_LEVEL_DEBUG, "AIR command: level=%d", level);
+    log_printf(LOG_LEVEL_DEBUG, "AIR command: level=%d, duration=%d ms", level, duration);
     
-    bool success = true;
+    // 時間指定なしは継続レベル、指定ありはパルス（終了後は継続レベルに戻る）
+    bool success;
+    if (parsed == 1) {
+        success = _actuators.setLevel(ACTUATOR_AIR, level);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "air %d,%s", 
+                 level, success ? "OK" : "ERROR");
+    } else {
+        success = duration > 0 &&
+                  _actuators.pulse(ACTUATOR_AIR, level, (uint32_t)duration * 1000, (ActuatorPulseMode)mode);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "air %d,%d,%s", 
+                 level, duration, success ? "OK" : "ERROR");
+    }
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
+void UDPController::applyActuator(uint8_t channel, uint32_t level) {
+    // アクチュエータのスレッドから呼ばれるため、RGB LEDは専用の送信元で要求する
+    if (channel >= ACTUATOR_SSR1 && channel <= ACTUATOR_SSR4) {
+        _ssr_driver.setDutyLevel(channel - ACTUATOR_SSR1 + 1, (uint8_t)level);
+        return;
+    }
+    if (channel >= ACTUATOR_RGB1 && channel <= ACTUATOR_RGB4) {
+        _rgb_led_driver.setColor(channel - ACTUATOR_RGB1 + 1, (level >> 16) & 0xFF, (level >> 8) & 0xFF, level & 0xFF, RGB_SOURCE_ACTUATOR);
+        return;
+    }
+    if (channel == ACTUATOR_MIST) {
+        // RGB LED 1の全色でミストを駆動
+        uint8_t v = level ? 255 : 0;
+        _rgb_led_driver.setColor(1, v, v, v, RGB_SOURCE_ACTUATOR);
+        return;
+    }
     
     // Control LEDs according to level
     switch (level) {
         case 0:  // Turn off both
-            success &= _rgb_led_driver.setColor(2, 0, 0, 0);
-            success &= _rgb_led_driver.setColor(3, 0, 0, 0);
+            _rgb_led_driver.setColor(2, 0, 0, 0, RGB_SOURCE_ACTUATOR);
+            _rgb_led_driver.setColor(3, 0, 0, 0, RGB_SOURCE_ACTUATOR);
             break;
             
         case 1:  // Turn on LED2 only
-            success &= _rgb_led_driver.setColor(2, 255, 255, 255);
-            success &= _rgb_led_driver.setColor(3, 0, 0, 0);
+            _rgb_led_driver.setColor(2, 255, 255, 255, RGB_SOURCE_ACTUATOR);
+            _rgb_led_driver.setColor(3, 0, 0, 0, RGB_SOURCE_ACTUATOR);
             break;
             
-        case 2:  // Turn on both
-            success &= _rgb_led_driver.setColor(2, 255, 255, 255);
-            success &= _rgb_led_driver.setColor(3, 255, 255, 255);
+        default:  // Turn on both
+            _rgb_led_driver.setColor(2, 255, 255, 255, RGB_SOURCE_ACTUATOR);
+            _rgb_led_driver.setColor(3, 255, 255, 255, RGB_SOURCE_ACTUATOR);
             break;
     }
-    
-    // Generate response
-    snprintf(_send_buffer, MAX_BUFFER_SIZE, "air %d,%s", 
-             level, success ? "OK" : "ERROR");
-    
-    // Send response
-    sendResponse(_send_buffer);
 }
 
 void UDPController::processZeroCrossCommand() {
@@ -996,6 +1892,151 @@ void UDPController::processZeroCrossCommand() {
     sendResponse(_send_buffer);
 }
 
+void UDPController::processIsrStatsCommand(const char* args) {
+    if (strcmp(args, "reset") == 0) {
+        _ssr_driver.resetIsrStats();
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "isrstats reset,OK");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (args[0] != '\0') {
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // 1行目: CPUクロック、以降: ハンドラ名,回数,最小,平均,最大（サイクル）,最大（us）
+    uint32_t cpu_mhz = SystemCoreClock / 1000000;
+    int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "isrstats,%luMHz\n", cpu_mhz);
+    
+    for (uint8_t i = 0; i < ISR_PROF_COUNT && len < MAX_BUFFER_SIZE; i++) {
+        IsrProfileStats stats;
+        _ssr_driver.getIsrStats(i, stats);
+        
+        uint32_t min = stats.count ? stats.min : 0;
+        uint32_t avg = stats.count ? (uint32_t)(stats.total / stats.count) : 0;
+        float max_us = cpu_mhz ? (float)stats.max / cpu_mhz : 0.0f;
+        len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "%s,%lu,%lu,%lu,%lu,%.2f\n",
+                        IsrProfiler::getName(i), stats.count, min, avg, stats.max, max_us);
+    }
+    
+    if (len < MAX_BUFFER_SIZE) {
+        snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "OK");
+    }
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processJitterCommand(const char* args) {
+    if (strcmp(args, "reset") == 0) {
+        _ssr_driver.resetFireJitter();
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "jitter reset,OK");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (args[0] != '\0') {
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // 各行: チャンネル,回数,最小,平均,最大（us）,バケット0〜15（スペース区切り）
+    int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "jitter\n");
+    
+    for (uint8_t id = 1; id <= 4 && len < MAX_BUFFER_SIZE; id++) {
+        SSRJitterStats stats;
+        _ssr_driver.getFireJitter(id, stats);
+        
+        long avg = stats.count ? (long)(stats.total_us / stats.count) : 0;
+        len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "%d,%lu,%ld,%ld,%ld,",
+                        id, stats.count, (long)stats.min_us, avg, (long)stats.max_us);
+        for (int b = 0; b < SSR_JITTER_BUCKETS && len < MAX_BUFFER_SIZE; b++) {
+            len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, b == 0 ? "%lu" : " %lu", stats.bucket[b]);
+        }
+        if (len < MAX_BUFFER_SIZE) {
+            len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "\n");
+        }
+    }
+    
+    if (len < MAX_BUFFER_SIZE) {
+        snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "OK");
+    }
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processTraceCommand(const char* args) {
+    if (!SSRDriver::isTraceAvailable()) {
+        log_printf(LOG_LEVEL_WARN, "TRACE command: build with SSR_TRACE_ENABLED=1");
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trace %s,ERROR", args);
+        sendResponse(_send_buffer);
+        return;
+    }
+    
+    if (strcmp(args, "start") == 0) {
+        _ssr_driver.setTraceEnabled(true);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trace start,OK");
+    } else if (strcmp(args, "stop") == 0) {
+        _ssr_driver.setTraceEnabled(false);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trace stop,OK");
+    } else if (strcmp(args, "reset") == 0) {
+        _ssr_driver.resetTrace();
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trace reset,OK");
+    } else if (strcmp(args, "status") == 0) {
+        uint32_t head = _ssr_driver.getTraceHead();
+        uint32_t oldest = head > SSR_TRACE_SIZE ? head - SSR_TRACE_SIZE : 0;
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trace status,%s,%lu,%lu,%d,OK",
+                 _ssr_driver.isTraceEnabled() ? "RUNNING" : "STOPPED", oldest, head, SSR_TRACE_SIZE);
+    } else if (strncmp(args, "dump", 4) == 0) {
+        unsigned long seq_arg = 0;
+        if (args[4] != '\0' && sscanf(args + 4, " %lu", &seq_arg) != 1) {
+            generateErrorResponse(args);
+            return;
+        }
+        
+        // バイナリ応答: "TR", version, flags, head(u32), first_seq(u32), count(u16), レコード(t_us(u32), ch, level) × count
+        // 数値はすべてリトルエンディアン
+        const size_t header_size = 14;
+        const size_t record_size = 6;
+        static SSRTraceRecord records[(MAX_BUFFER_SIZE - header_size) / record_size];
+        const uint16_t max_records = sizeof(records) / sizeof(records[0]);
+        
+        uint32_t seq = (uint32_t)seq_arg;
+        uint16_t count = _ssr_driver.readTrace(seq, records, max_records);
+        uint32_t head = _ssr_driver.getTraceHead();
+        
+        uint8_t* p = (uint8_t*)_send_buffer;
+        p[0] = 'T';
+        p[1] = 'R';
+        p[2] = 1;
+        p[3] = _ssr_driver.isTraceEnabled() ? 1 : 0;
+        for (int i = 0; i < 4; i++) {
+            p[4 + i] = (uint8_t)(head >> (8 * i));
+            p[8 + i] = (uint8_t)(seq >> (8 * i));
+        }
+        p[12] = (uint8_t)count;
+        p[13] = (uint8_t)(count >> 8);
+        p += header_size;
+        for (uint16_t r = 0; r < count; r++) {
+            for (int i = 0; i < 4; i++) {
+                p[i] = (uint8_t)(records[r].t_us >> (8 * i));
+            }
+            p[4] = records[r].channel;
+            p[5] = records[r].level;
+            p += record_size;
+        }
+        
+        sendBinaryResponse(_send_buffer, header_size + count * record_size);
+        return;
+    } else {
+        generateErrorResponse(args);
+        return;
+    }
+    
+    // Send response
+    sendResponse(_send_buffer);
+}
+
 void UDPController::processWS2812Command(const char* args) {
     // Parse arguments: system,led_id,r,g,b
     int system, led_id, r, g, b;
@@ -1024,7 +2065,7 @@ void UDPController::processWS2812Command(const char* args) {
     
     // Update the LED
     if (success) {
-        success = _ws2812_driver.update(system);
+        success = updateWS2812Unlocked(system);
     }
     
     // Generate response
@@ -1098,7 +2139,7 @@ void UDPController::processWS2812SysCommand(const char* args) {
     
     // Update the system
     if (success) {
-        success = _ws2812_driver.update(system);
+        success = updateWS2812Unlocked(system);
     }
     
     // Generate response
@@ -1136,7 +2177,7 @@ void UDPController::processWS2812OffCommand(const char* args) {
     
     // Update the system
     if (success) {
-        success = _ws2812_driver.update(system);
+        success = updateWS2812Unlocked(system);
     }
     
     // Generate response
@@ -1158,7 +2199,943 @@ void UDPController::generateErrorResponse(const char* command) {
     sendResponse(_send_buffer);
 }
 
+void UDPController::processCueCommand(const char* args) {
+    if (strncmp(args, "add ", 4) == 0) {
+        // Parse arguments: ms,command
+        int ms;
+        int consumed = 0;
+        if (sscanf(args + 4, "%d,%n", &ms, &consumed) != 1 || consumed == 0 || ms < 0) {
+            log_printf(LOG_LEVEL_WARN, "CUE add parse error: %s", args);
+            generateErrorResponse(args);
+            return;
+        }
+        const char* command = args + 4 + consumed;
+        
+        // キューからキューリストは操作しない
+        if (strncmp(command, "cue", 3) == 0) {
+            generateErrorResponse(args);
+            return;
+        }
+        
+        int index = _cue_engine.add((uint32_t)ms, command);
+        if (index < 0) {
+            log_printf(LOG_LEVEL_WARN, "CUE add failed (full, too long or playing): %s", command);
+            generateErrorResponse(args);
+            return;
+        }
+        CueStatus status;
+        _cue_engine.getStatus(status);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "cue add %d,%d,OK", index, status.count);
+        sendResponse(_send_buffer);
+    }
+    else if (strcmp(args, "go") == 0 || strncmp(args, "go ", 3) == 0) {
+        int delay_ms = 0;
+        if (args[2] == ' ' && (sscanf(args + 3, "%d", &delay_ms) != 1 || delay_ms < 0)) {
+            generateErrorResponse(args);
+            return;
+        }
+        bool success = _cue_engine.go((uint32_t)delay_ms);
+        CueStatus status;
+        _cue_engine.getStatus(status);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "cue go,%d,%s", status.count, success ? "OK" : "ERROR");
+        sendResponse(_send_buffer);
+    }
+    else if (strcmp(args, "stop") == 0) {
+        _cue_engine.stop();
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "cue stop,OK");
+        sendResponse(_send_buffer);
+    }
+    else if (strcmp(args, "clear") == 0) {
+        _cue_engine.clear();
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "cue clear,OK");
+        sendResponse(_send_buffer);
+    }
+    else if (strcmp(args, "status") == 0) {
+        CueStatus status;
+        _cue_engine.getStatus(status);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "cue status,%s,%d/%d,%ld,%lu,%lu,OK",
+                 status.running ? "RUNNING" : "STOPPED", status.next, status.count,
+                 (long)status.elapsed_ms, (unsigned long)status.executed, (unsigned long)status.max_late_us);
+        sendResponse(_send_buffer);
+    }
+    else if (strcmp(args, "list") == 0) {
+        CueStatus status;
+        _cue_engine.getStatus(status);
+        int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "cue list,%d", status.count);
+        for (uint16_t i = 0; i < status.count; i++) {
+            uint32_t offset_ms;
+            char command[CUE_COMMAND_MAX];
+            if (!_cue_engine.getEntry(i, offset_ms, command, sizeof(command))) {
+                break;
+            }
+            int n = snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "\n%lu,%s", (unsigned long)offset_ms, command);
+            if (n < 0 || len + n >= MAX_BUFFER_SIZE - 4) {
+                // 入りきらない分は省略
+                _send_buffer[len] = '\0';
+                len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "\n...");
+                break;
+            }
+            len += n;
+        }
+        snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "\nOK");
+        sendResponse(_send_buffer);
+    }
+    else {
+        generateErrorResponse(args);
+    }
+}
+
+void UDPController::processTriggerCommand(const char* args) {
+    int id;
+    int consumed = 0;
+    
+    if (strcmp(args, "stats") == 0 || strcmp(args, "stats reset") == 0) {
+        if (args[5] != '\0') {
+            _triggers.resetLatencyStats();
+        }
+        TriggerLatencyStats stats;
+        _triggers.getLatencyStats(stats);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trigger stats,%lu,%lu,%lu,%lu,%lu,%lu,OK",
+                 (unsigned long)stats.count,
+                 (unsigned long)(stats.count ? stats.min_us : 0),
+                 (unsigned long)(stats.count ? stats.total_us / stats.count : 0),
+                 (unsigned long)TriggerEngine::percentile(stats, 500),
+                 (unsigned long)TriggerEngine::percentile(stats, 990),
+                 (unsigned long)stats.max_us);
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (sscanf(args, "clear %d", &id) == 1) {
+        bool success = id >= 0 && _triggers.clear((uint8_t)id);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trigger clear %d,%s", id, success ? "OK" : "ERROR");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (sscanf(args, "fire %d", &id) == 1) {
+        // テキストからの発火（動作確認用、遅延統計には含めない）
+        bool success = id >= 0 && _triggers.fire((uint8_t)id, us_ticker_read(), false);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "trigger fire %d,%s", id, success ? "OK" : "ERROR");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (sscanf(args, "list %d", &id) == 1) {
+        if (id < 0 || id >= TRIGGER_SLOTS) {
+            generateErrorResponse(args);
+            return;
+        }
+        uint8_t count = _triggers.getActionCount((uint8_t)id);
+        int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "trigger list %d,%d", id, count);
+        for (uint8_t i = 0; i < count && len < MAX_BUFFER_SIZE - 64; i++) {
+            TriggerAction a;
+            if (!_triggers.getAction((uint8_t)id, i, a)) {
+                break;
+            }
+            len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "\nch%d,%lx,%lu",
+                            a.channel, (unsigned long)a.level, (unsigned long)(a.duration_us / 1000));
+            if (a.set_rest) {
+                len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",%lx", (unsigned long)a.rest_level);
+            }
+        }
+        snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "\nOK");
+        sendResponse(_send_buffer);
+        return;
+    }
+    
+    // trigger add <id>,<type>,...
+    char type[8] = {0};
+    if (sscanf(args, "add %d,%7[a-z]%n", &id, type, &consumed) != 2 || id < 0 || id >= TRIGGER_SLOTS) {
+        log_printf(LOG_LEVEL_WARN, "TRIGGER command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    const char* p = args + consumed;
+    TriggerAction action;
+    action.set_rest = false;
+    action.rest_level = 0;
+    int ms = 0;
+    bool valid = false;
+    
+    if (strcmp(type, "ssr") == 0) {
+        // ssr,<ch>,<duty>,<ms>[,<after_duty>]
+        int ch, duty, after = 0;
+        int n = sscanf(p, ",%d,%d,%d,%d", &ch, &duty, &ms, &after);
+        valid = n >= 3 && ch >= 1 && ch <= 4 && duty >= 0 && duty <= 100 && after >= 0 && after <= 100;
+        action.channel = ACTUATOR_SSR1 + ch - 1;
+        action.level = duty;
+        action.set_rest = true;
+        action.rest_level = after;
+    } else if (strcmp(type, "rgb") == 0) {
+        // rgb,<led>,<r>,<g>,<b>,<ms>[,<r>,<g>,<b>]
+        int led, r, g, b, r2 = 0, g2 = 0, b2 = 0;
+        int n = sscanf(p, ",%d,%d,%d,%d,%d,%d,%d,%d", &led, &r, &g, &b, &ms, &r2, &g2, &b2);
+        valid = (n == 5 || n == 8) && led >= 1 && led <= 4 &&
+                r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255 &&
+                r2 >= 0 && r2 <= 255 && g2 >= 0 && g2 <= 255 && b2 >= 0 && b2 <= 255;
+        action.channel = ACTUATOR_RGB1 + led - 1;
+        action.level = ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+        action.set_rest = true;
+        action.rest_level = ((uint32_t)r2 << 16) | ((uint32_t)g2 << 8) | (uint32_t)b2;
+    } else if (strcmp(type, "mist") == 0) {
+        // mist,<ms>
+        valid = sscanf(p, ",%d", &ms) == 1 && ms <= 10000;
+        action.channel = ACTUATOR_MIST;
+        action.level = 1;
+    } else if (strcmp(type, "air") == 0) {
+        // air,<level>,<ms>（終了後はairコマンドで設定したレベル）
+        int level;
+        valid = sscanf(p, ",%d,%d", &level, &ms) == 2 && level >= 0 && level <= 2;
+        action.channel = ACTUATOR_AIR;
+        action.level = level;
+    }
+    
+    if (!valid || ms <= 0 || ms > 60000) {
+        log_printf(LOG_LEVEL_WARN, "TRIGGER add parameter error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    action.duration_us = (uint32_t)ms * 1000;
+    
+    bool success = _triggers.addAction((uint8_t)id, action);
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "trigger add %d,%d,%s",
+             id, _triggers.getActionCount((uint8_t)id), success ? "OK" : "ERROR");
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processTimeCommand(const char* args) {
+    // 同期プロトコル（応答に,OKは付けない）
+    if (strncmp(args, "ping ", 5) == 0) {
+        // マスター側: 受信時刻と送信時刻をデバイス時刻で返す
+        uint64_t t2 = _time_sync.toDevice(_rx_local_us);
+        uint64_t t1 = strtoull(args + 5, NULL, 10);
+        uint64_t t3 = _time_sync.now();
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "time pong %llu,%llu,%llu",
+                 (unsigned long long)t1, (unsigned long long)t2, (unsigned long long)t3);
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strncmp(args, "pong ", 5) == 0) {
+        // クライアント側: 応答しない
+        char* p;
+        uint64_t t1 = strtoull(args + 5, &p, 10);
+        uint64_t t2 = (*p == ',') ? strtoull(p + 1, &p, 10) : 0;
+        uint64_t t3 = (*p == ',') ? strtoull(p + 1, &p, 10) : 0;
+        if (!_time_sync.handlePong(t1, t2, t3, _rx_local_us)) {
+            log_printf(LOG_LEVEL_DEBUG, "TIME stale pong ignored: %s", args);
+        }
+        return;
+    }
+    
+    if (strcmp(args, "now") == 0) {
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "time now,%llu,OK", (unsigned long long)_time_sync.now());
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strcmp(args, "status") == 0) {
+        TimeSyncStatus st;
+        _time_sync.getStatus(st);
+        int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "time status,%s,%llu,%lld,%lld,%lu,%ld,%ld,%lu,%lu,%lu,",
+                           st.synced ? "SYNCED" : "FREE", (unsigned long long)st.device_us,
+                           (long long)st.offset_us, (long long)st.error_us, (unsigned long)st.delay_us,
+                           (long)st.drift_ppb, (long)st.rate_ppb, (unsigned long)st.rounds,
+                           (unsigned long)st.lost, (unsigned long)st.age_ms);
+        if (_time_master_set) {
+            snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "%s:%d,OK",
+                     _time_master.get_ip_address(), _time_master.get_port());
+        } else {
+            snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "none,OK");
+        }
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strcmp(args, "master off") == 0) {
+        _time_master_set = false;
+        _time_sync.stopPolling();
+        sendResponse("time master off,OK");
+        return;
+    }
+    
+    char ip[40] = {0};
+    int port = _config_manager ? _config_manager->getUDPPort() : UDP_PORT;
+    if (sscanf(args, "master %39[0-9.],%d", ip, &port) >= 1 && port > 0 && port <= 65535) {
+        SocketAddress addr;
+        if (addr.set_ip_address(ip)) {
+            addr.set_port(port);
+            _time_master = addr;
+            _time_master_set = true;
+            _time_sync.startPolling();
+            log_printf(LOG_LEVEL_INFO, "Time master set to %s:%d", ip, port);
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "time master %s,%d,OK", ip, port);
+            sendResponse(_send_buffer);
+            return;
+        }
+    }
+    log_printf(LOG_LEVEL_WARN, "TIME command parse error: %s", args);
+    generateErrorResponse(args);
+}
+
+void UDPController::processAtCommand(const char* args) {
+    // @<device_us> <command> / @z<half_cycle> <command>
+    uint8_t base = SCHED_DEVICE_TIME;
+    const char* p = args;
+    if (*p == 'z') {
+        base = SCHED_HALF_CYCLE;
+        p++;
+    }
+    char* end;
+    uint64_t target = strtoull(p, &end, 10);
+    if (end == p || *end != ' ') {
+        log_printf(LOG_LEVEL_WARN, "@ command parse error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    const char* command = end;
+    while (*command == ' ') {
+        command++;
+    }
+    int time_len = (int)(end - args);
+    if (*command == '@') {
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "@%.*s,ERROR", time_len, args);
+        sendResponse(_send_buffer);
+        return;
+    }
+    
+    int64_t lead_us;
+    SchedResult result = _scheduler.schedule(base, target, command, lead_us);
+    switch (result) {
+        case SCHED_RESULT_QUEUED:
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "@%.*s,QUEUED,%lld,OK", time_len, args, (long long)lead_us);
+            break;
+        case SCHED_RESULT_LATE:
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "@%.*s,LATE,%lld,OK", time_len, args, (long long)-lead_us);
+            break;
+        case SCHED_RESULT_DROPPED:
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "@%.*s,DROPPED,%lld,ERROR", time_len, args, (long long)-lead_us);
+            break;
+        case SCHED_RESULT_FULL:
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "@%.*s,FULL,ERROR", time_len, args);
+            break;
+        default:
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "@%.*s,ERROR", time_len, args);
+            break;
+    }
+    if (result == SCHED_RESULT_LATE || result == SCHED_RESULT_DROPPED) {
+        log_printf(LOG_LEVEL_WARN, "Scheduled command late by %lld us: %s", (long long)-lead_us, command);
+    }
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processSchedCommand(const char* args) {
+    if (strcmp(args, "status") == 0) {
+        SchedStatus st;
+        _scheduler.getStatus(st);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "sched status,%d,%lu,%lu,%lu,%lu,%s,%lu,OK",
+                 st.pending, (unsigned long)st.executed, (unsigned long)st.late, (unsigned long)st.dropped,
+                 (unsigned long)st.max_late_us, CommandScheduler::getLatePolicyName(st.policy),
+                 (unsigned long)st.tolerance_us);
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strcmp(args, "now") == 0) {
+        // 予約時刻を決めるための現在のデバイス時刻と半周期
+        uint32_t index = 0, elapsed_us = 0, half_cycle_us = 0;
+        bool zerox = _ssr_driver.getHalfCycleTiming(index, elapsed_us, half_cycle_us);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "sched now,%llu,%lu,%lu,%lu,%s",
+                 (unsigned long long)_time_sync.now(), (unsigned long)index,
+                 (unsigned long)elapsed_us, (unsigned long)half_cycle_us, zerox ? "OK" : "NOZEROX");
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (strcmp(args, "clear") == 0) {
+        _scheduler.clear();
+        sendResponse("sched clear,OK");
+        return;
+    }
+    
+    char name[8] = {0};
+    unsigned long tolerance_us = SCHED_DEFAULT_TOLERANCE_US;
+    if (sscanf(args, "late %7[a-z],%lu", name, &tolerance_us) >= 1) {
+        int policy = CommandScheduler::parseLatePolicy(name);
+        if (policy >= 0 && _scheduler.setLatePolicy(policy, tolerance_us)) {
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "sched late %s,%lu,OK", name, tolerance_us);
+            sendResponse(_send_buffer);
+            return;
+        }
+    }
+    log_printf(LOG_LEVEL_WARN, "SCHED command parse error: %s", args);
+    generateErrorResponse(args);
+}
+
+void UDPController::serviceTimeSync() {
+    uint64_t t1;
+    if (!_time_master_set || !_time_sync.pollPing(t1)) {
+        return;
+    }
+    char ping[40];
+    int len = snprintf(ping, sizeof(ping), "time ping %llu", (unsigned long long)t1);
+    nsapi_size_or_error_t result = _socket.sendto(_time_master, ping, len);
+    if (result < 0) {
+        log_printf(LOG_LEVEL_DEBUG, "Time sync ping failed: %d", result);
+    }
+}
+
+void UDPController::processUnitConfigCommand(const char* args) {
+    // config unit <index>|none|status（保存はconfig save）
+    if (strcmp(args, "status") != 0) {
+        char* end;
+        long index = strcmp(args, "none") == 0 ? -1 : strtol(args, &end, 10);
+        if ((index >= 0 && *end != '\0') || !_config_manager->setUnitIndex((int)index)) {
+            log_printf(LOG_LEVEL_WARN, "CONFIG UNIT parse error: %s", args);
+            generateErrorResponse(args);
+            return;
+        }
+        log_printf(LOG_LEVEL_INFO, "Unit index set to %ld", index);
+    }
+    uint8_t unit = _config_manager->getUnitIndex();
+    if (unit == UNIT_INDEX_NONE) {
+        sendResponse("config unit,none,OK");
+    } else {
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "config unit,%d,OK", unit);
+        sendResponse(_send_buffer);
+    }
+}
+
+void UDPController::processMcastConfigCommand(const char* args) {
+    // config mcast fleet|zone <ip>|off / port <port> / status（保存はconfig save）
+    char name[8] = {0};
+    char value[24] = {0};
+    if (strcmp(args, "status") == 0) {
+        int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "config mcast");
+        for (int i = 0; i < MULTICAST_GROUPS; i++) {
+            uint32_t group = _config_manager->getMulticastGroup(i);
+            SocketAddress addr;
+            addr.set_ip_bytes(&group, NSAPI_IPv4);
+            len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",%s=%s%s", ConfigManager::getMulticastGroupName(i),
+                            group ? addr.get_ip_address() : "off", (group && _mcast_joined[i] != group) ? "(not joined)" : "");
+        }
+        snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",port=%d,%s,%lu,OK", _config_manager->getMulticastPort(),
+                 _mcast_open ? "OPEN" : "CLOSED", (unsigned long)_mcast_packets);
+        sendResponse(_send_buffer);
+        return;
+    }
+    if (sscanf(args, "port %23s", value) == 1) {
+        // 受信ソケットのポートは再起動後に変わる
+        char* end;
+        long port = strtol(value, &end, 10);
+        if (*end == '\0' && port != _config_manager->getUDPPort() && _config_manager->setMulticastPort((int)port)) {
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "config mcast port,%ld,OK", port);
+            sendResponse(_send_buffer);
+            return;
+        }
+    } else if (sscanf(args, "%7s %23s", name, value) == 2) {
+        int group = ConfigManager::parseMulticastGroup(name);
+        if (group >= 0 && _config_manager->setMulticastGroup(group, value)) {
+            applyMulticastGroups();
+            snprintf(_send_buffer, MAX_BUFFER_SIZE, "config mcast %s,%s,OK", name, value);
+            sendResponse(_send_buffer);
+            return;
+        }
+    }
+    log_printf(LOG_LEVEL_WARN, "CONFIG MCAST parse error: %s", args);
+    generateErrorResponse(args);
+}
+
+bool UDPController::selectUnitCommand(char* cmd) {
+    // unit <a>[-<b>] <command>: 範囲内のユニットだけが実行
+    // slice <first>;<cmd0>;<cmd1>;...: ユニット番号 - first 番目のコマンドを実行（空は何もしない）
+    uint8_t unit = _config_manager ? _config_manager->getUnitIndex() : UNIT_INDEX_NONE;
+    bool is_slice = cmd[0] == 's';
+    char* args = cmd + (is_slice ? 6 : 5);
+    char* p;
+    long first = strtol(args, &p, 10);
+    long last = first;
+    if (!is_slice && *p == '-') {
+        last = strtol(p + 1, &p, 10);
+    }
+    if (p == args || *p != (is_slice ? ';' : ' ')) {
+        log_printf(LOG_LEVEL_WARN, "%s command parse error: %s", is_slice ? "SLICE" : "UNIT", cmd);
+        generateErrorResponse(cmd);
+        return false;
+    }
+    if (unit == UNIT_INDEX_NONE || unit < first) {
+        return false;
+    }
+
+    char* selected = p + 1;
+    if (is_slice) {
+        for (long n = unit - first; n > 0; n--) {
+            selected = strchr(selected, ';');
+            if (!selected) {
+                return false;  // このユニットの分はない
+            }
+            selected++;
+        }
+        char* end = strchr(selected, ';');
+        if (end) {
+            *end = '\0';
+        }
+    } else if (unit > last) {
+        return false;
+    }
+    while (*selected == ' ') {
+        selected++;
+    }
+    memmove(cmd, selected, strlen(selected) + 1);
+    return cmd[0] != '\0';
+}
+
+bool UDPController::acceptSequence(char* buffer, const SocketAddress& sender) {
+    // #<seq>[:<stream>] <command>
+    char* p;
+    uint32_t seq = strtoul(buffer + 1, &p, 10);
+    bool explicit_stream = *p == ':';
+    unsigned long stream = explicit_stream ? strtoul(p + 1, &p, 10) : 0;
+    if (p == buffer + 1 || *p != ' ' || stream > 0xFFFF) {
+        log_printf(LOG_LEVEL_WARN, "SEQ prefix parse error: %s", buffer);
+        return false;
+    }
+    char* command = p + 1;
+    for (char* q = command; *q; q++) {
+        *q = tolower(*q);
+    }
+
+    uint32_t ip = 0;
+    if (sender.get_ip_version() == NSAPI_IPv4) {
+        memcpy(&ip, sender.get_ip_bytes(), sizeof(ip));
+    }
+    uint32_t target = explicit_stream ? SequenceFilter::streamKey((uint16_t)stream) : SequenceFilter::targetKey(command);
+    SeqResult result = _seq_filter.check(ip, sender.get_port(), target, seq);
+    if (result != SEQ_ACCEPT) {
+        log_printf(LOG_LEVEL_DEBUG, "SEQ %s dropped: #%lu %s", result == SEQ_DUPLICATE ? "duplicate" : "stale",
+                   (unsigned long)seq, command);
+        return false;
+    }
+    memmove(buffer, command, strlen(command) + 1);
+    return true;
+}
+
+void UDPController::processSeqCommand(const char* args) {
+    if (strcmp(args, "reset") == 0) {
+        _seq_filter.reset();
+        sendResponse("seq reset,OK");
+        return;
+    }
+    if (strcmp(args, "status") == 0) {
+        SeqStats st;
+        _seq_filter.getStats(st);
+        snprintf(_send_buffer, MAX_BUFFER_SIZE, "seq status,%lu,%lu,%lu,%lu,%lu,%lu,%u,OK",
+                 (unsigned long)st.accepted, (unsigned long)st.duplicate, (unsigned long)st.stale,
+                 (unsigned long)st.lost, (unsigned long)st.resets, (unsigned long)st.evicted, st.streams);
+        sendResponse(_send_buffer);
+        return;
+    }
+    log_printf(LOG_LEVEL_WARN, "SEQ command parse error: %s", args);
+    generateErrorResponse(args);
+}
+
+void UDPController::processQueueCommand(const char* args) {
+    if (strcmp(args, "reset") == 0) {
+        _command_lanes.priority().resetStats();
+        _command_lanes.normal().resetStats();
+        _mcast_lanes.priority().resetStats();
+        _mcast_lanes.normal().resetStats();
+        sendResponse("queue reset,OK");
+        return;
+    }
+    if (strcmp(args, "status") == 0) {
+        // レーンごとに 現在/容量,最大,受付,破棄,最大待ち時間(us)（優先, 通常, マルチキャスト優先, マルチキャスト通常の順）
+        CommandQueue* lanes[] = {
+            &_command_lanes.priority(), &_command_lanes.normal(), &_mcast_lanes.priority(), &_mcast_lanes.normal()
+        };
+        int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "queue status");
+        for (size_t i = 0; i < sizeof(lanes) / sizeof(lanes[0]); i++) {
+            CommandQueueStats st;
+            lanes[i]->getStats(st);
+            len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",%u/%u,%u,%lu,%lu,%lu",
+                            st.depth, st.capacity, st.max_depth, (unsigned long)st.queued, (unsigned long)st.dropped,
+                            (unsigned long)st.max_wait_us);
+        }
+        snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",OK");
+        sendResponse(_send_buffer);
+        return;
+    }
+    log_printf(LOG_LEVEL_WARN, "QUEUE command parse error: %s", args);
+    generateErrorResponse(args);
+}
+
+const char* UDPController::getReplyModeName(uint8_t mode) {
+    static const char* const names[REPLY_MODE_COUNT] = {"all", "errors", "none", "ack"};
+    return mode < REPLY_MODE_COUNT ? names[mode] : "unknown";
+}
+
+int UDPController::parseReplyMode(const char* name) {
+    for (int i = 0; i < REPLY_MODE_COUNT; i++) {
+        if (strcmp(name, getReplyModeName(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int UDPController::findReplySession(bool create) {
+    // 送信元ごとの応答モード（満杯なら最も長く使われていない送信元を置き換え）
+    int free_slot = -1;
+    int oldest = 0;
+    for (int i = 0; i < REPLY_SESSIONS; i++) {
+        ReplySession& rs = _reply_sessions[i];
+        if (!rs.used) {
+            if (free_slot < 0) {
+                free_slot = i;
+            }
+        } else if (rs.addr == _remote_addr) {
+            return i;
+        } else if ((int32_t)(rs.last_used - _reply_sessions[oldest].last_used) < 0) {
+            oldest = i;
+        }
+    }
+    if (!create) {
+        return -1;
+    }
+    int i = free_slot >= 0 ? free_slot : oldest;
+    ReplySession& rs = _reply_sessions[i];
+    rs.addr = _remote_addr;
+    rs.used = true;
+    rs.mode = REPLY_ALL;
+    rs.ack_every = 0;
+    rs.pending = 0;
+    rs.pending_errors = 0;
+    rs.last_used = _reply_commands;
+    return i;
+}
+
+void UDPController::beginReply(char* buffer) {
+    _reply_session = findReplySession(false);
+    _reply_mode = _reply_session >= 0 ? _reply_sessions[_reply_session].mode : REPLY_ALL;
+    _reply_error = false;
+    if (_reply_session >= 0) {
+        _reply_sessions[_reply_session].last_used = _reply_commands;
+    }
+    if (buffer[0] == '!') {
+        memmove(buffer, buffer + 1, strlen(buffer));
+        _reply_mode = REPLY_NONE;
+    }
+    _reply_commands++;
+}
+
+void UDPController::endReply() {
+    if (_reply_error) {
+        _reply_errors++;
+    }
+    if (_reply_session < 0) {
+        return;
+    }
+    ReplySession& rs = _reply_sessions[_reply_session];
+    if (rs.mode != REPLY_ACK) {
+        return;
+    }
+    rs.pending++;
+    if (_reply_error) {
+        rs.pending_errors++;
+    }
+    if (rs.pending >= rs.ack_every) {
+        // ack,<コマンド数>,<エラー数>（前回の確認応答から）
+        char ack[32];
+        snprintf(ack, sizeof(ack), "ack,%lu,%lu", (unsigned long)rs.pending, (unsigned long)rs.pending_errors);
+        _reply_mode = REPLY_ALL;
+        sendResponse(ack);
+        _reply_acks++;
+        rs.pending = 0;
+        rs.pending_errors = 0;
+    }
+}
+
+void UDPController::processReplyCommand(const char* args) {
+    if (_suppress_response) {
+        return;  // 送信元のない経路（キュー・予約・マルチキャスト）では無効
+    }
+    if (strcmp(args, "status") != 0) {
+        char name[8] = {0};
+        int ack_every = 0;
+        int n = sscanf(args, "%7s %d", name, &ack_every);
+        int mode = n >= 1 ? parseReplyMode(name) : -1;
+        if (mode < 0 || (mode == REPLY_ACK && (n < 2 || ack_every < 1 || ack_every > 65535))) {
+            log_printf(LOG_LEVEL_WARN, "REPLY command parse error: %s", args);
+            generateErrorResponse(args);
+            return;
+        }
+        if (mode == REPLY_ALL) {
+            int i = findReplySession(false);
+            if (i >= 0) {
+                _reply_sessions[i].used = false;
+            }
+            _reply_session = -1;
+        } else {
+            _reply_session = findReplySession(true);
+            ReplySession& rs = _reply_sessions[_reply_session];
+            rs.mode = (uint8_t)mode;
+            rs.ack_every = (uint16_t)ack_every;
+            rs.pending = 0;
+            rs.pending_errors = 0;
+        }
+    }
+    
+    // 応答モードの変更・確認には常に応答する
+    _reply_mode = REPLY_ALL;
+    int i = findReplySession(false);
+    uint8_t mode = i >= 0 ? _reply_sessions[i].mode : REPLY_ALL;
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "reply status,%s,%u,%lu,%lu,%lu,%lu,OK", getReplyModeName(mode),
+             i >= 0 ? _reply_sessions[i].ack_every : 0, (unsigned long)_reply_commands, (unsigned long)_reply_errors,
+             (unsigned long)_reply_suppressed, (unsigned long)_reply_acks);
+    sendResponse(_send_buffer);
+}
+
+void UDPController::gatherState(StateSnapshot& st) {
+    memset(&st, 0, sizeof(st));
+    st.magic[0] = STATE_SNAPSHOT_MAGIC0;
+    st.magic[1] = STATE_SNAPSHOT_MAGIC1;
+    st.version = STATE_SNAPSHOT_VERSION;
+    st.device_us = _time_sync.now();
+
+    for (uint8_t id = 1; id <= 4; id++) {
+        // パックした構造体のメンバーは参照で渡せないため、一旦ローカル変数で受ける
+        uint8_t duty = 0;
+        bool state = false;
+        uint32_t period = 0;
+        _ssr_driver.getSSRStatus(id, duty, state, period);
+        st.ssr[id - 1].duty = duty;
+        st.ssr[id - 1].state = state ? 1 : 0;
+        st.ssr[id - 1].period_us = period;
+        st.ssr[id - 1].freq_hz = _ssr_driver.getPWMFrequency(id);
+
+        _rgb_led_driver.getColor(id, &st.rgb[id - 1].r, &st.rgb[id - 1].g, &st.rgb[id - 1].b);
+        st.rgb[id - 1].activity = (_rgb_led_driver.isTransitionActive(id) ? STATE_RGB_TRANSITION : 0) |
+                                  (_rgb_led_driver.isKeyframeActive(id) ? STATE_RGB_KEYFRAME : 0);
+    }
+
+    uint32_t zerox_count, zerox_interval;
+    float frequency;
+    _ssr_driver.getZeroCrossStats(zerox_count, zerox_interval, frequency);
+    st.zerox_count = zerox_count;
+    st.zerox_interval_us = zerox_interval;
+    st.line_freq_x10 = (uint16_t)(frequency * 10.0f + 0.5f);
+    if (_ssr_driver.isZeroCrossDetected()) {
+        st.flags |= STATE_FLAG_ZEROX;
+    }
+
+    ActuatorStatus mist, air;
+    _actuators.getStatus(ACTUATOR_MIST, mist);
+    _actuators.getStatus(ACTUATOR_AIR, air);
+    st.mist_level = (uint8_t)mist.level;
+    st.mist_queued = mist.queued;
+    st.mist_remaining_ms = mist.remaining_us / 1000;
+    st.air_level = (uint8_t)air.level;
+    st.air_queued = air.queued;
+    st.air_remaining_ms = air.remaining_us / 1000;
+
+    for (uint8_t sys = 1; sys <= WS2812_SYSTEMS; sys++) {
+        st.ws_frames[sys - 1] = _ws2812_driver.getFrameCount(sys);
+    }
+
+    TimeSyncStatus sync;
+    _time_sync.getStatus(sync);
+    if (sync.synced) {
+        st.flags |= STATE_FLAG_TIME_SYNC;
+    }
+    if (_config_manager) {
+        if (_config_manager->isSSRLinkEnabled()) {
+            st.flags |= STATE_FLAG_SSR_LINK;
+        }
+        st.unit_index = _config_manager->getUnitIndex();
+        st.debug_level = (uint8_t)_config_manager->getDebugLevel();
+        st.transition_ms = _config_manager->getSSRLinkTransitionTime();
+        st.udp_port = (uint16_t)_config_manager->getUDPPort();
+    } else {
+        st.unit_index = UNIT_INDEX_NONE;
+        st.udp_port = UDP_PORT;
+    }
+}
+
+void UDPController::processStateCommand(bool binary) {
+    StateSnapshot st;
+    gatherState(st);
+    if (binary) {
+        sendBinaryResponse(&st, sizeof(st));
+        return;
+    }
+
+    // state,<flags>,<device_us>,ssr=<duty>:<state>:<freq>:<period_us>;...,rgb=<r>:<g>:<b>:<activity>;...,
+    // zerox=<count>:<interval_us>:<freq_x10>,mist=<level>:<remaining_ms>:<queued>,air=...,ws=<frames>;...,
+    // cfg=<unit>:<debug>:<transition_ms>:<udp_port>,OK
+    int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "state,%u,%llu", st.flags, (unsigned long long)st.device_us);
+    for (int i = 0; i < 4; i++) {
+        len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "%s%u:%u:%d:%lu", i == 0 ? ",ssr=" : ";",
+                        st.ssr[i].duty, st.ssr[i].state, st.ssr[i].freq_hz, (unsigned long)st.ssr[i].period_us);
+    }
+    for (int i = 0; i < 4; i++) {
+        len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, "%s%u:%u:%u:%u", i == 0 ? ",rgb=" : ";",
+                        st.rgb[i].r, st.rgb[i].g, st.rgb[i].b, st.rgb[i].activity);
+    }
+    snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len,
+             ",zerox=%lu:%lu:%u,mist=%u:%lu:%u,air=%u:%lu:%u,ws=%lu;%lu;%lu,cfg=%d:%u:%u:%u,OK",
+             (unsigned long)st.zerox_count, (unsigned long)st.zerox_interval_us, st.line_freq_x10,
+             st.mist_level, (unsigned long)st.mist_remaining_ms, st.mist_queued,
+             st.air_level, (unsigned long)st.air_remaining_ms, st.air_queued,
+             (unsigned long)st.ws_frames[0], (unsigned long)st.ws_frames[1], (unsigned long)st.ws_frames[2],
+             st.unit_index == UNIT_INDEX_NONE ? -1 : st.unit_index, st.debug_level, st.transition_ms, st.udp_port);
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processSubscribeCommand(const char* args) {
+    if (strcmp(args, "status") == 0) {
+        int len = snprintf(_send_buffer, MAX_BUFFER_SIZE, "subscribe status");
+        for (uint8_t i = 0; i < TELEMETRY_SUBSCRIBERS; i++) {
+            TelemetrySubscription sub;
+            if (!_telemetry.getSubscription(i, sub) || len >= MAX_BUFFER_SIZE) {
+                continue;
+            }
+            char fields[32];
+            TelemetryPublisher::formatFields(sub.fields, fields, sizeof(fields));
+            len += snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",%s:%d/%lu/%s/%lu/%lu",
+                            sub.addr.get_ip_address(), sub.addr.get_port(), (unsigned long)sub.interval_ms,
+                            fields, (unsigned long)sub.remaining_s, (unsigned long)sub.sent);
+        }
+        if (len < MAX_BUFFER_SIZE) {
+            snprintf(_send_buffer + len, MAX_BUFFER_SIZE - len, ",OK");
+        }
+        sendResponse(_send_buffer);
+        return;
+    }
+    
+    // subscribe <interval_ms> <fields> [<lease_s>]（同じ送信元からの再送で期限を延長）
+    unsigned long interval_ms = 0;
+    unsigned long lease_s = TELEMETRY_DEFAULT_LEASE_S;
+    char names[32] = {0};
+    int fields = -1;
+    if (!_suppress_response && sscanf(args, "%lu %31s %lu", &interval_ms, names, &lease_s) >= 2) {
+        fields = TelemetryPublisher::parseFields(names);
+    }
+    if (fields < 0 || !_telemetry.subscribe(_remote_addr, interval_ms, (uint8_t)fields, lease_s)) {
+        log_printf(LOG_LEVEL_WARN, "SUBSCRIBE command error: %s", args);
+        generateErrorResponse(args);
+        return;
+    }
+    log_printf(LOG_LEVEL_INFO, "Telemetry subscribed: %s:%d every %lu ms for %lu s",
+               _remote_addr.get_ip_address(), _remote_addr.get_port(), interval_ms, lease_s);
+    snprintf(_send_buffer, MAX_BUFFER_SIZE, "subscribe %lu,%s,%lu,OK", interval_ms, names, lease_s);
+    sendResponse(_send_buffer);
+}
+
+void UDPController::processUnsubscribeCommand() {
+    if (_suppress_response || !_telemetry.unsubscribe(_remote_addr)) {
+        generateErrorResponse("unsubscribe");
+        return;
+    }
+    sendResponse("unsubscribe,OK");
+}
+
+int UDPController::formatTelemetry(uint8_t fields, uint32_t seq, char* buffer, size_t size) {
+    // tele,<seq>,<device_ms>[,ssr=<duty>:<state>;...][,rgb=<r>:<g>:<b>;...][,zerox=...][,ws=<frames>;...]
+    int len = snprintf(buffer, size, "tele,%lu,%llu", (unsigned long)seq, (unsigned long long)(_time_sync.now() / 1000));
+    if (fields & TELEMETRY_SSR) {
+        for (uint8_t id = 1; id <= 4 && (size_t)len < size; id++) {
+            uint8_t duty = 0;
+            bool state = false;
+            uint32_t period = 0;
+            _ssr_driver.getSSRStatus(id, duty, state, period);
+            len += snprintf(buffer + len, size - len, "%s%d:%d", id == 1 ? ",ssr=" : ";", duty, state ? 1 : 0);
+        }
+    }
+    if (fields & TELEMETRY_RGB) {
+        for (uint8_t id = 1; id <= 4 && (size_t)len < size; id++) {
+            uint8_t r = 0, g = 0, b = 0;
+            _rgb_led_driver.getColor(id, &r, &g, &b);
+            len += snprintf(buffer + len, size - len, "%s%d:%d:%d", id == 1 ? ",rgb=" : ";", r, g, b);
+        }
+    }
+    if ((fields & TELEMETRY_ZEROX) && (size_t)len < size) {
+        uint32_t count, interval;
+        float frequency;
+        _ssr_driver.getZeroCrossStats(count, interval, frequency);
+        len += snprintf(buffer + len, size - len, ",zerox=%d:%lu:%lu:%.1f", _ssr_driver.isZeroCrossDetected() ? 1 : 0,
+                        (unsigned long)count, (unsigned long)interval, frequency);
+    }
+    if (fields & TELEMETRY_WS2812) {
+        for (uint8_t sys = 1; sys <= WS2812_SYSTEMS && (size_t)len < size; sys++) {
+            len += snprintf(buffer + len, size - len, "%s%lu", sys == 1 ? ",ws=" : ";",
+                            (unsigned long)_ws2812_driver.getFrameCount(sys));
+        }
+    }
+    return (size_t)len < size ? len : (int)size - 1;
+}
+
+void UDPController::sendTelemetry(const SocketAddress& addr, const char* data, size_t length) {
+    nsapi_size_or_error_t result = _socket.sendto(addr, data, length);
+    if (result < 0) {
+        log_printf(LOG_LEVEL_DEBUG, "Telemetry send error: %d", result);
+    }
+}
+
+bool UDPController::releaseCommandLock() {
+    // 応答抑制はこのコマンドの状態のため、外している間に実行される他のコマンドへ持ち越さない
+    bool suppress = _suppress_response;
+    _suppress_response = false;
+    _command_mutex.unlock();
+    return suppress;
+}
+
+void UDPController::reacquireCommandLock(bool suppress) {
+    _command_mutex.lock();
+    _suppress_response = suppress;
+}
+
+bool UDPController::saveConfigUnlocked() {
+    // EEPROMの書き換え（1ワード5ms）の間もキュー・スケジューラのコマンドを実行できるようにする
+    // 書き込む内容は排他中に確定させる（外している間の変更は次の保存で反映）
+    ConfigData data;
+    _config_manager->getSnapshot(data);
+    bool suppress = releaseCommandLock();
+    bool saved = _config_manager->writeConfig(data);
+    reacquireCommandLock(suppress);
+    return saved;
+}
+
+bool UDPController::updateWS2812Unlocked(int system) {
+    // WS2812Driverは自身のロックで転送を保護している
+    bool suppress = releaseCommandLock();
+    bool success = _ws2812_driver.update(system);
+    reacquireCommandLock(suppress);
+    return success;
+}
+
+void UDPController::executeDeferredCommand(const char* command) {
+    // UDPスレッドのコマンド処理と同じハンドラを使用（応答は送信しない）
+    _command_mutex.lock();
+    _suppress_response = true;
+    processCommand(command, strlen(command));
+    _suppress_response = false;
+    _command_mutex.unlock();
+    
+    if (_command_callback) {
+        _command_callback(command);
+    }
+}
+
 void UDPController::sendResponse(const char* response) {
+    if (_suppress_response) {
+        log_printf(LOG_LEVEL_DEBUG, "Deferred response: %s", response);
+        return;
+    }
+    
+    // 応答モードによる抑制（送信・ログ出力の前に判定）
+    if (_reply_mode != REPLY_ALL) {
+        size_t len = strlen(response);
+        bool error = strncmp(response, "Error", 5) == 0 || (len >= 6 && strcmp(response + len - 6, ",ERROR") == 0);
+        _reply_error |= error;
+        if (!error || _reply_mode != REPLY_ERRORS) {
+            _reply_suppressed++;
+            return;
+        }
+    }
+    
     // Send UDP response
     log_printf(LOG_LEVEL_DEBUG, "UDP response send: %s", response);
     
@@ -1167,4 +3144,23 @@ void UDPController::sendResponse(const char* response) {
     if (result < 0) {
         log_printf(LOG_LEVEL_ERROR, "Response send error: %d", result);
     }
-} 
\ No newline at end of file
+}
+
+void UDPController::sendBinaryResponse(const void* data, size_t length) {
+    if (_suppress_response) {
+        return;
+    }
+    if (_reply_mode != REPLY_ALL) {
+        _reply_suppressed++;
+        return;
+    }
+    
+    // Send UDP binary response
+    log_printf(LOG_LEVEL_DEBUG, "UDP binary response send: %d bytes", (int)length);
+    
+    nsapi_size_or_error_t result = _socket.sendto(_remote_addr, data, length);
+    
+    if (result < 0) {
+        log_printf(LOG_LEVEL_ERROR, "Response send error: %d", result);
+    }
+}
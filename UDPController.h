@@ -5,6 +5,15 @@
 #include "RGBLEDDriver.h"
 #include "WS2812Driver.h"
 #include "ConfigManager.h"
+#include "CueEngine.h"
+#include "ActuatorController.h"
+#include "TriggerEngine.h"
+#include "TimeSync.h"
+#include "CommandScheduler.h"
+#include "SequenceFilter.h"
+#include "TelemetryPublisher.h"
+#include "StateSnapshot.h"
+#include "CommandQueue.h"
 #include "EthernetInterface.h"
 #include "main.h"  // log_printfの定義を含む
 #include "netsocket/NetworkInterface.h"
@@ -20,6 +29,28 @@
 // バッファサイズの定義
 #define MAX_BUFFER_SIZE 1024
 
+// 応答モードを覚えておく送信元の数
+#define REPLY_SESSIONS 8
+
+// 受信から実行までのコマンドキュー（優先: SSR・トリガ等の短いコマンド、通常: その他）
+#define PRIORITY_QUEUE_SIZE 32
+#define PRIORITY_COMMAND_SIZE 128
+#define NORMAL_QUEUE_SIZE 16
+// マルチキャスト受信スレッド→実行スレッドのコマンドキュー（応答なし）
+#define MCAST_PRIORITY_QUEUE_SIZE 16
+#define MCAST_NORMAL_QUEUE_SIZE 8
+
+/**
+ * 応答モード（送信元ごと）
+ */
+enum ReplyMode : uint8_t {
+    REPLY_ALL = 0,      // すべてのコマンドに応答（従来どおり）
+    REPLY_ERRORS,       // エラーのみ応答
+    REPLY_NONE,         // 応答しない
+    REPLY_ACK,          // 応答せず、N件ごとにまとめて確認応答
+    REPLY_MODE_COUNT
+};
+
 // デバッグ設定
 #define DEBUG_LEVEL 1
 #define DEBUG_STATUS_INTERVAL 60  // ステータス表示の間隔（秒）
@@ -45,20 +76,32 @@ public:
     void setConfigManager(ConfigManager* config_manager) {
         _config_manager = config_manager;
     }
+
+    // マスターに同期したデバイス時刻
+    const TimeSync& getTimeSync() const { return _time_sync; }
     
 private:
     // スレッド関連
     std::unique_ptr<rtos::Thread> _thread;
     bool _running;
-    void _thread_func();  // スレッドのメイン関数
+    void _thread_func();  // スレッドのメイン関数（受信してキューに追加）
+    std::unique_ptr<rtos::Thread> _exec_thread;
+    void _exec_thread_func();  // キューのコマンドを実行するスレッド
+    std::unique_ptr<rtos::Thread> _mcast_thread;
+    void _mcast_thread_func();  // マルチキャスト受信スレッド
 
     // コマンド処理
     void processCommand(const char* command, int length);
     void processSetCommand(const char* args);
+    void processSetAllCommand(const char* args);
+    void processRampCommand(const char* args);
+    void processWaveCommand(const char* args);
     void processFreqCommand(const char* args);
     void processGetCommand(const char* args);
     void processRGBCommand(const char* args);
     void processRGBGetCommand(const char* args);
+    void processKeyframeCommand(const char* args);
+    void processFadeCommand(const char* args);
     void processWS2812Command(const char* args);
     void processWS2812GetCommand(const char* args);
     void processWS2812SysCommand(const char* args);
@@ -68,8 +111,47 @@ private:
     void processMistCommand(const char* args);
     void processAirCommand(const char* args);
     void processZeroCrossCommand();
+    void processIsrStatsCommand(const char* args);
+    void processJitterCommand(const char* args);
+    void processTraceCommand(const char* args);
+    void processCueCommand(const char* args);
+    void processTriggerCommand(const char* args);
+    void processTimeCommand(const char* args);
+    void serviceTimeSync();  // 時刻同期の問い合わせ送信（実行スレッドから呼ばれる）
+    void processAtCommand(const char* args);
+    void processSchedCommand(const char* args);
+    void processUnitConfigCommand(const char* args);
+    void processMcastConfigCommand(const char* args);
+    bool selectUnitCommand(char* cmd);  // unit/sliceから自分宛てのコマンドを取り出す（自分宛てでなければfalse）
+    bool acceptSequence(char* buffer, const SocketAddress& sender);  // #<seq>を外す（古い・重複した更新はfalse）
+    void processSeqCommand(const char* args);
+    void processReplyCommand(const char* args);
+    void processStateCommand(bool binary);
+    void gatherState(StateSnapshot& st);  // ドライバーから1回で状態を読み出す
+    void processSubscribeCommand(const char* args);
+    void processUnsubscribeCommand();
+    int formatTelemetry(uint8_t fields, uint32_t seq, char* buffer, size_t size);  // テレメトリスレッドから呼ばれる
+    void sendTelemetry(const SocketAddress& addr, const char* data, size_t length);
+    void beginReply(char* buffer);  // 受信したパケットの応答モードを決める（先頭の!を外す）
+    void endReply();                // まとめた確認応答の送信
+    int findReplySession(bool create);
+    static const char* getReplyModeName(uint8_t mode);
+    static int parseReplyMode(const char* name);  // 不正な名前は-1
+    void processQueueCommand(const char* args);
+    bool executeQueued(CommandQueue& queue, bool multicast);  // キューの先頭を1つ実行（空ならfalse）
+    static bool isPriorityCommand(const char* command);
+    bool initMulticast();
+    void applyMulticastGroups();  // 設定に合わせてグループへの参加・離脱
+    void executeDeferredCommand(const char* command);  // キュー・スケジューラのスレッドと実行スレッド（マルチキャスト）から呼ばれる
+    // 時間のかかる転送の間だけコマンド処理の排他を外す（外している間はハンドラ共有の状態に触れない）
+    bool releaseCommandLock();
+    void reacquireCommandLock(bool suppress);
+    bool saveConfigUnlocked();
+    bool updateWS2812Unlocked(int system);
+    void applyActuator(uint8_t channel, uint32_t level);  // ミスト・エアー・SSR・RGBの出力切り替え
     void generateErrorResponse(const char* command);
     void sendResponse(const char* response);
+    void sendBinaryResponse(const void* data, size_t length);
     
     // コマンド解析
     bool parseSSRCommand(const char* command, int& num, int& value);
@@ -95,12 +177,70 @@ private:
     // UDP通信
     NetworkInterface* _interface;  // ネットワークインターフェース
     UDPSocket _socket;
-    SocketAddress _remote_addr;
+    SocketAddress _remote_addr;  // 実行中のコマンドの送信元（応答先）
+    SocketAddress _rx_addr;      // 受信スレッドの送信元
     char _recv_buffer[MAX_BUFFER_SIZE];
     char _send_buffer[MAX_BUFFER_SIZE];
-    
-    // ミスト制御用変数
-    bool _mist_active;
-    uint32_t _mist_start_time;
-    uint32_t _mist_duration;
+
+    // コマンド処理の排他（UDPの実行スレッドとキュースレッドが同じハンドラを使うため）
+    // EEPROM・WS2812の転送中は外し、時刻指定のコマンドを遅いコマンドの後ろで待たせない
+    Mutex _command_mutex;
+    bool _suppress_response;  // キュー実行中は応答を送信しない
+
+    // キューリスト
+    CueEngine _cue_engine;
+
+    // ミスト・エアー・SSR/RGBパルス（タイマー駆動）
+    ActuatorController _actuators;
+
+    // 事前設定したトリガ（バイナリパケットで発火）
+    TriggerEngine _triggers;
+
+    // 時刻同期
+    TimeSync _time_sync;
+    SocketAddress _time_master;
+    bool _time_master_set;
+    uint64_t _rx_local_us;  // 処理中のパケットの受信時刻（ローカル時刻）
+
+    // 実行時刻付きコマンドの予約
+    CommandScheduler _scheduler;
+
+    // マルチキャスト（全台共通・ユニット個別のグループ宛て、応答なし）
+    UDPSocket _mcast_socket;
+    bool _mcast_open;
+    uint32_t _mcast_joined[MULTICAST_GROUPS];  // 参加中のグループ（0=なし）
+    uint32_t _mcast_packets;
+    char _mcast_buffer[MAX_BUFFER_SIZE];
+
+    // シーケンス番号付きコマンドの重複・順序の入れ替わりの破棄
+    SequenceFilter _seq_filter;
+
+    // 応答モード（UDPの実行スレッドのみ）
+    struct ReplySession {
+        SocketAddress addr;
+        bool used;
+        uint8_t mode;           // ReplyMode
+        uint16_t ack_every;     // REPLY_ACK: 確認応答の間隔（コマンド数）
+        uint32_t pending;       // 前回の確認応答からのコマンド数
+        uint32_t pending_errors;
+        uint32_t last_used;
+    };
+    ReplySession _reply_sessions[REPLY_SESSIONS];
+    int _reply_session;         // 処理中のパケットの送信元（-1=応答モード未設定）
+    uint8_t _reply_mode;        // 処理中のパケットの応答モード
+    bool _reply_error;          // 処理中のパケットでエラーを応答したか
+    uint32_t _reply_commands;   // 統計（UDPで受信したコマンド）
+    uint32_t _reply_errors;
+    uint32_t _reply_suppressed;
+    uint32_t _reply_acks;
+
+    // 購読者への定期的な状態送信
+    TelemetryPublisher _telemetry;
+
+    // 受信スレッド→実行スレッドのコマンドキュー（優先レーンを先に実行）
+    CommandLanes _command_lanes;
+    CommandLanes _mcast_lanes;      // マルチキャスト受信スレッドが追加（応答なしで実行）
+    EventFlags _exec_flags;
+    static const uint32_t EXEC_FLAG_WAKE = 0x01;
+
 }; 
\ No newline at end of file
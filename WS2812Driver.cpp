@@ -7,7 +7,8 @@ WS2812Driver::WS2812Driver()
       _spi1(P11_14, NC, P11_12, NC),
       _spi3(P5_2,   NC, P5_0,   NC),
       _in_p5_3(P5_3),
-      _in_p2_14(P2_14)
+      _in_p2_14(P2_14),
+      _output_thread(osPriorityNormal, 2048)
 {
     // SPI設定（8bit, mode0, 2.4MHz）
     _spi0.format(8, 0);
@@ -34,9 +35,15 @@ WS2812Driver::WS2812Driver()
     
     // Turn off all LEDs initially
     allOff();
+    
+    _output_thread.start(callback(this, &WS2812Driver::outputThreadFunc));
 }
 
 WS2812Driver::~WS2812Driver() {
+    _output_flags.set(OUTPUT_FLAG_EXIT);
+    if (_output_thread.get_state() != Thread::Deleted) {
+        _output_thread.join();
+    }
     allOff();
 }
 
@@ -54,6 +61,7 @@ bool WS2812Driver::setColor(uint8_t system, uint8_t led_id, uint8_t r, uint8_t g
     uint8_t led_idx = led_id - 1;
     
     // Store color data
+    ScopedLock<Mutex> lock(_mutex);
     _colors[sys_idx][led_idx][0] = r;
     _colors[sys_idx][led_idx][1] = g;
     _colors[sys_idx][led_idx][2] = b;
@@ -68,6 +76,7 @@ bool WS2812Driver::setSystemColor(uint8_t system, uint8_t r, uint8_t g, uint8_t
     }
     
     // Set all LEDs in the system to the same color
+    ScopedLock<Mutex> lock(_mutex);
     for (uint8_t led_id = 1; led_id <= WS2812_LED_COUNT; led_id++) {
         if (!setColor(system, led_id, r, g, b)) {
             return false;
@@ -77,6 +86,37 @@ bool WS2812Driver::setSystemColor(uint8_t system, uint8_t r, uint8_t g, uint8_t
     return true;
 }
 
+bool WS2812Driver::requestSystemColor(uint8_t system, uint8_t r, uint8_t g, uint8_t b) {
+    if (system < 1 || system > WS2812_SYSTEMS) {
+        return false;
+    }
+    core_util_atomic_store_u32(&_requested_color[system - 1], ((uint32_t)r << 16) | ((uint32_t)g << 8) | b);
+    _output_flags.set(1u << (system - 1));
+    return true;
+}
+
+void WS2812Driver::outputThreadFunc() {
+    for (;;) {
+        uint32_t flags = _output_flags.wait_any(OUTPUT_FLAG_SYSTEMS | OUTPUT_FLAG_EXIT);
+        if (flags & osFlagsError) {
+            continue;
+        }
+        if (flags & OUTPUT_FLAG_EXIT) {
+            break;
+        }
+        // 転送中に届いた要求は次の周回で最新の色だけを送る
+        for (uint8_t system = 1; system <= WS2812_SYSTEMS; system++) {
+            if (!(flags & (1u << (system - 1)))) {
+                continue;
+            }
+            uint32_t color = core_util_atomic_load_u32(&_requested_color[system - 1]);
+            ScopedLock<Mutex> lock(_mutex);
+            setSystemColor(system, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+            update(system);
+        }
+    }
+}
+
 bool WS2812Driver::update(uint8_t system) {
     // Check system parameter
     if (system < 1 || system > WS2812_SYSTEMS) {
@@ -87,6 +127,9 @@ bool WS2812Driver::update(uint8_t system) {
     uint8_t* buffer;
     SPI* spi;
     
+    // エンコードから転送完了まで保持（同じバッファ・SPIへの転送を重ねない）
+    ScopedLock<Mutex> lock(_mutex);
+    
     // Select buffer and SPI for the system
     switch (system) {
         case 1:
@@ -132,6 +175,7 @@ bool WS2812Driver::update(uint8_t system) {
 #else
     sendWS2812Data(*spi, buffer, WS2812_LED_COUNT * 9);
 #endif
+    _frame_count[sys_idx]++;
     
     return true;
 }
@@ -154,6 +198,7 @@ bool WS2812Driver::turnOff(uint8_t system) {
 }
 
 bool WS2812Driver::allOff() {
+    ScopedLock<Mutex> lock(_mutex);
     bool success = true;
     
     // Turn off all systems
@@ -184,6 +229,7 @@ bool WS2812Driver::getColor(uint8_t system, uint8_t led_id, uint8_t* r, uint8_t*
     uint8_t led_idx = led_id - 1;
     
     // Get color data
+    ScopedLock<Mutex> lock(_mutex);
     *r = _colors[sys_idx][led_idx][0];
     *g = _colors[sys_idx][led_idx][1];
     *b = _colors[sys_idx][led_idx][2];
@@ -11,6 +11,8 @@
  * WS2812 LED driver class
  * Controls 3 systems of WS2812 LEDs using UART TX
  * Systems: P5_0, P5_3, P2_14
+ * Color data and transfers are protected by a mutex, so commands and the
+ * output thread (requestSystemColor) can drive the strips concurrently.
  */
 class WS2812Driver {
 public:
@@ -46,6 +48,18 @@ public:
      */
     bool setSystemColor(uint8_t system, uint8_t r, uint8_t g, uint8_t b);
     
+    /**
+     * Set color for entire system and send it from the output thread
+     * 呼び出し側はSPI転送（1系統約7ms）を待たない。系統ごとに最新の色のみ保持
+     * （SSR連動などアニメーションを持つスレッドから使用）
+     * @param system System number (1-3)
+     * @param r Red value (0-255)
+     * @param g Green value (0-255)
+     * @param b Blue value (0-255)
+     * @return true if successful, false otherwise
+     */
+    bool requestSystemColor(uint8_t system, uint8_t r, uint8_t g, uint8_t b);
+    
     /**
      * Update WS2812 data for specific system
      * @param system System number (1-3)
@@ -83,6 +97,15 @@ public:
      */
     bool getColor(uint8_t system, uint8_t led_id, uint8_t* r, uint8_t* g, uint8_t* b);
 
+    /**
+     * Get the number of frames sent to a system
+     * @param system System number (1-3)
+     * @return Frame count (0 for invalid systems)
+     */
+    uint32_t getFrameCount(uint8_t system) const {
+        return (system >= 1 && system <= WS2812_SYSTEMS) ? _frame_count[system - 1] : 0;
+    }
+
 private:
     // SPI for WS2812 control (1系統=1本のMOSI)
     SPI _spi0;  // SPI0: MOSI=P10_14, SCLK=P10_12
@@ -106,6 +129,20 @@ private:
     // Current color data
     uint8_t _colors[WS2812_SYSTEMS][WS2812_LED_COUNT][3];  // [system][led][r,g,b]
     
+    // 送信したフレーム数（テレメトリ用）
+    volatile uint32_t _frame_count[WS2812_SYSTEMS] = {0, 0, 0};
+    
+    // 色データ・エンコードバッファ・SPI転送の排他（コマンド処理と出力スレッド）
+    Mutex _mutex;
+    
+    // requestSystemColorの要求（0x00RRGGBB、系統ごとに最新のみ）と出力スレッド
+    volatile uint32_t _requested_color[WS2812_SYSTEMS] = {0, 0, 0};
+    static const uint32_t OUTPUT_FLAG_SYSTEMS = 0x07;  // bit0-2: 系統1-3の送信要求
+    static const uint32_t OUTPUT_FLAG_EXIT = 0x80;
+    EventFlags _output_flags;
+    Thread _output_thread;
+    void outputThreadFunc();
+    
     /**
      * Encode one LED's GRB to SPI byte stream (9 bytes per LED)
      * @param r Red value (0-255)
@@ -549,6 +549,7 @@ int main()
     // Initialize WS2812 driver
     log_printf(LOG_LEVEL_INFO, "Initializing WS2812 driver...");
     ws2812_driver = std::make_unique<WS2812Driver>();
+    rgb_led->setWS2812Driver(ws2812_driver.get());  // SSR連動のWS2812出力先
     kick_watchdog();  // 初期化中にkick
     
     // 初期化処理の完了を待機
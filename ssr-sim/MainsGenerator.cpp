@@ -0,0 +1,48 @@
+#include "MainsGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+void MainsGenerator::generate(uint64_t duration_us, std::vector<MainsEdge>& edges,
+                              std::vector<HalfCycle>& half_cycles, uint32_t& dropped) const {
+    std::mt19937 rng(_config.seed);
+    std::normal_distribution<double> jitter(0.0, _config.jitter_us > 0 ? _config.jitter_us : 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    edges.clear();
+    half_cycles.clear();
+    dropped = 0;
+
+    // 最初の立ち上がりは1周期後から（起動直後の過渡を避ける）
+    double t = 1000000.0 / _config.frequency_hz;
+    while (t < (double)duration_us) {
+        double f = _config.frequency_hz + _config.drift_hz_per_s * (t / 1000000.0);
+        double period = 1000000.0 / f;
+
+        uint64_t start = (uint64_t)llround(t);
+        uint32_t half = (uint32_t)llround(period / 2.0);
+        half_cycles.push_back({start, half});
+        half_cycles.push_back({start + half, (uint32_t)llround(period) - half});
+
+        if (_config.dropout_probability > 0 && uniform(rng) < _config.dropout_probability) {
+            dropped++;
+        } else {
+            double detected = t + (_config.jitter_us > 0 ? jitter(rng) : 0.0);
+            edges.push_back({(uint64_t)llround(std::max(0.0, detected)), false});
+        }
+        t += period;
+    }
+
+    // ノイズエッジ（ポアソン過程）
+    if (_config.noise_edges_per_s > 0) {
+        std::exponential_distribution<double> gap(_config.noise_edges_per_s / 1000000.0);
+        double n = gap(rng);
+        while (n < (double)duration_us) {
+            edges.push_back({(uint64_t)llround(n), true});
+            n += gap(rng);
+        }
+        std::stable_sort(edges.begin(), edges.end(),
+                         [](const MainsEdge& a, const MainsEdge& b) { return a.t_us < b.t_us; });
+    }
+}
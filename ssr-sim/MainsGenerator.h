@@ -0,0 +1,58 @@
+#ifndef MAINS_GENERATOR_H
+#define MAINS_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * 商用電源波形の設定
+ */
+struct MainsConfig {
+    double frequency_hz = 60.0;     // 初期周波数
+    double drift_hz_per_s = 0.0;    // 周波数ドリフト（直線）
+    double jitter_us = 0.0;         // 検出エッジ時刻の揺らぎ（標準偏差）
+    double noise_edges_per_s = 0.0; // ノイズによる偽エッジの発生率
+    double dropout_probability = 0; // 検出エッジの欠落確率
+    uint32_t seed = 1;
+};
+
+/**
+ * ゼロクロス検出入力のイベント
+ */
+struct MainsEdge {
+    uint64_t t_us;      // 検出ピンの立ち上がり時刻
+    bool noise;         // ノイズによる偽エッジ
+};
+
+/**
+ * 真の半周期（出力精度評価用）
+ */
+struct HalfCycle {
+    uint64_t start_us;  // 半周期の開始時刻（真のゼロクロス）
+    uint32_t length_us; // 半周期の長さ
+};
+
+/**
+ * Mains waveform generator
+ * Produces the rising edges seen by the zero-cross input (one per cycle)
+ * and the true half-cycle boundaries used to score the triac firing.
+ */
+class MainsGenerator {
+public:
+    explicit MainsGenerator(const MainsConfig& config) : _config(config) {}
+
+    /**
+     * Generate events for the given duration
+     * @param duration_us Simulated time span
+     * @param edges Output: detector edges in time order
+     * @param half_cycles Output: true half-cycles in time order
+     * @param dropped Output: number of dropped detector edges
+     */
+    void generate(uint64_t duration_us, std::vector<MainsEdge>& edges,
+                  std::vector<HalfCycle>& half_cycles, uint32_t& dropped) const;
+
+private:
+    MainsConfig _config;
+};
+
+#endif // MAINS_GENERATOR_H
@@ -0,0 +1,119 @@
+/**
+ * CommandQueue / CommandLanes check
+ * 受信スレッドと実行スレッドの手順を1スレッドで再現し、
+ * 優先・通常レーンやユニキャスト・マルチキャストをまたいでもコマンドが受信順に実行されることを確認する。
+ */
+
+#include "mbed.h"
+#include "CommandQueue.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// 優先スロットを小さくして、長い優先コマンドを通常レーンに入れる
+const uint16_t kPriorityCapacity = 8;
+const uint16_t kPriorityCommandSize = 32;
+const uint16_t kNormalCapacity = 8;
+const uint16_t kNormalCommandSize = 256;
+
+struct Packet {
+    std::string command;
+    bool priority;
+};
+
+// 実行スレッドと同じ順序（優先レーンを空にしてから通常レーンを1つ）で全件実行
+std::vector<std::string> drain(CommandLanes& lanes) {
+    std::vector<std::string> executed;
+    CommandQueue* queue;
+    while ((queue = lanes.next()) != NULL) {
+        SocketAddress sender;
+        uint64_t rx_us;
+        executed.push_back(queue->front(sender, rx_us));
+        queue->pop(0);
+    }
+    return executed;
+}
+
+// packetsを受信（pushのみ）したあと、実行した順がexpectedと一致するか
+bool check(const char* name, CommandLanes& lanes, const std::vector<Packet>& packets,
+           const std::vector<std::string>& expected) {
+    for (const Packet& p : packets) {
+        if (!lanes.push(p.command.c_str(), p.command.size(), p.priority, SocketAddress(5555), 0)) {
+            printf("  FAIL %s: push rejected: %s\n", name, p.command.c_str());
+            return false;
+        }
+    }
+    std::vector<std::string> executed = drain(lanes);
+    bool pass = executed == expected;
+    printf("%-28s %s\n", name, pass ? "PASS" : "FAIL");
+    if (!pass) {
+        for (size_t i = 0; i < executed.size(); i++) {
+            printf("  %zu: %s\n", i, executed[i].c_str());
+        }
+    }
+    return pass;
+}
+
+std::string longWaveLoad() {
+    std::string command = "wave 1,load,0";
+    while (command.size() < kPriorityCommandSize * 2) {
+        command += ",50";
+    }
+    return command;
+}
+
+}  // namespace
+
+int main() {
+    int failed = 0;
+    CommandLanes lanes(kPriorityCapacity, kPriorityCommandSize, kNormalCapacity, kNormalCommandSize);
+    const std::string load = longWaveLoad();
+
+    // 短い優先コマンドは先に届いた通常コマンドより先に実行
+    failed += !check("priority_first", lanes,
+                     {{"config save", false}, {"set 1,50", true}},
+                     {"set 1,50", "config save"});
+
+    // 通常レーンに入った長い優先コマンドを、後の短い優先コマンドが追い越さない
+    failed += !check("long_priority_order", lanes,
+                     {{"config save", false}, {load, true}, {"wave 1,play", true}, {"set 1,0", true}},
+                     {"config save", load, "wave 1,play", "set 1,0"});
+
+    // 長い優先コマンドより前に届いた優先コマンドは従来どおり先に実行
+    failed += !check("earlier_priority_first", lanes,
+                     {{"set 1,10", true}, {"help", false}, {load, true}, {"wave 1,play", true}},
+                     {"set 1,10", "help", load, "wave 1,play"});
+
+    // 長い優先コマンドの実行後は優先レーンに戻る
+    failed += !check("priority_lane_restored", lanes,
+                     {{"config save", false}, {"set 1,100", true}},
+                     {"set 1,100", "config save"});
+
+    // ユニキャストとマルチキャストのレーン対は、同じ種類のレーン同士で受信順
+    {
+        CommandLanes mcast(kPriorityCapacity, kPriorityCommandSize, kNormalCapacity, kNormalCommandSize);
+        SocketAddress sender(5556);
+        lanes.push("set 1,10", 8, true, sender, 100);
+        mcast.push("set 1,20", 8, true, sender, 50);
+        lanes.push("help", 4, false, sender, 10);
+        mcast.push("set 1,30", 8, true, sender, 200);
+        std::vector<std::string> executed;
+        CommandQueue* queue;
+        while ((queue = CommandLanes::next(lanes, mcast)) != NULL) {
+            uint64_t rx_us;
+            executed.push_back(std::string(mcast.contains(queue) ? "m:" : "u:") + queue->front(sender, rx_us));
+            queue->pop(0);
+        }
+        bool pass = executed == std::vector<std::string>{"m:set 1,20", "u:set 1,10", "m:set 1,30", "u:help"};
+        printf("%-28s %s\n", "multicast_order", pass ? "PASS" : "FAIL");
+        failed += !pass;
+    }
+
+    if (lanes.priority().depth() != 0 || lanes.normal().depth() != 0) {
+        printf("lanes not empty\n");
+        failed++;
+    }
+    return failed ? 1 : 0;
+}
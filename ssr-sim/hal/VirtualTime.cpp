@@ -0,0 +1,139 @@
+#include "mbed.h"
+
+#include <algorithm>
+#include <random>
+
+namespace vhal {
+
+namespace {
+uint64_t g_now_us = 0;
+std::vector<Timeout*> g_timeouts;
+std::vector<::InterruptIn*> g_inputs;
+std::vector<PinWrite> g_writes;
+TimerLatencyModel g_latency;
+std::mt19937 g_rng(1);
+uint64_t g_timeout_isr_count = 0;
+uint64_t g_pin_isr_count = 0;
+
+// 期限に達した最も早いTimeout（同時刻はattach順）
+Timeout* earliestTimeout() {
+    Timeout* best = nullptr;
+    for (Timeout* t : g_timeouts) {
+        if (!t->armed()) {
+            continue;
+        }
+        if (best == nullptr || t->due() < best->due() ||
+            (t->due() == best->due() && t->order() < best->order())) {
+            best = t;
+        }
+    }
+    return best;
+}
+}  // namespace
+
+uint64_t now_us() {
+    return g_now_us;
+}
+
+void reset() {
+    for (Timeout* t : g_timeouts) {
+        t->detach();
+    }
+    g_now_us = 0;
+    g_writes.clear();
+    g_timeout_isr_count = 0;
+    g_pin_isr_count = 0;
+    g_rng.seed(g_latency.seed);
+}
+
+void setTimerLatency(const TimerLatencyModel& model) {
+    g_latency = model;
+    g_rng.seed(model.seed);
+}
+
+uint64_t armTimeout(uint64_t delay_us) {
+    uint64_t latency = g_latency.base_us;
+    if (g_latency.tail_us > 0 && g_latency.tail_probability > 0) {
+        std::uniform_real_distribution<double> p(0.0, 1.0);
+        if (p(g_rng) < g_latency.tail_probability) {
+            std::uniform_int_distribution<uint32_t> tail(0, g_latency.tail_us);
+            latency += tail(g_rng);
+        }
+    }
+    return g_now_us + delay_us + latency;
+}
+
+bool nextTimeoutDue(uint64_t& due_us) {
+    Timeout* t = earliestTimeout();
+    if (t == nullptr) {
+        return false;
+    }
+    due_us = t->due();
+    return true;
+}
+
+void runUntil(uint64_t t_us) {
+    for (;;) {
+        Timeout* t = earliestTimeout();
+        if (t == nullptr || t->due() > t_us) {
+            break;
+        }
+        if (t->due() > g_now_us) {
+            g_now_us = t->due();
+        }
+        g_timeout_isr_count++;
+        t->fire();
+    }
+    if (t_us > g_now_us) {
+        g_now_us = t_us;
+    }
+}
+
+bool raiseRise(PinName pin) {
+    for (::InterruptIn* in : g_inputs) {
+        if (in->pin() == pin) {
+            g_pin_isr_count++;
+            in->fireRise();
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<PinWrite>& pinWrites() {
+    return g_writes;
+}
+
+void clearPinWrites() {
+    g_writes.clear();
+}
+
+uint64_t timeoutIsrCount() {
+    return g_timeout_isr_count;
+}
+
+uint64_t pinIsrCount() {
+    return g_pin_isr_count;
+}
+
+void registerTimeout(Timeout* t) {
+    g_timeouts.push_back(t);
+}
+
+void unregisterTimeout(Timeout* t) {
+    g_timeouts.erase(std::remove(g_timeouts.begin(), g_timeouts.end(), t), g_timeouts.end());
+}
+
+void registerInterruptIn(::InterruptIn* in) {
+    g_inputs.push_back(in);
+}
+
+void unregisterInterruptIn(::InterruptIn* in) {
+    g_inputs.erase(std::remove(g_inputs.begin(), g_inputs.end(), in), g_inputs.end());
+}
+
+void recordWrite(PinName pin, int value) {
+    g_writes.push_back({g_now_us, pin, value});
+}
+
+}  // namespace vhal
@@ -0,0 +1,270 @@
+#ifndef SSR_SIM_MBED_H
+#define SSR_SIM_MBED_H
+
+/**
+ * 仮想時間HAL（ホストシミュレータ用）
+ * SSRDriverが使用するMbed OS APIのみを決定的な仮想時間上で再現する。
+ * 割り込みはイベント発生時刻に1つずつ最後まで実行される（プリエンプションなし）。
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// ---------------------------------------------------------------------------
+// ピン定義
+// ---------------------------------------------------------------------------
+enum PinName {
+    P2_13, P2_14, P3_9, P4_0, P5_0, P5_3, P5_6, P5_7, P8_11,
+    NC = -1
+};
+
+enum PinMode {
+    PullNone = 0,
+    PullUp,
+    PullDown
+};
+
+typedef int IRQn_Type;
+inline void GIC_SetPriority(IRQn_Type, uint32_t) {}
+
+// ---------------------------------------------------------------------------
+// アトミック操作・クリティカルセクション（単一スレッド実行のため単純な読み書き）
+// ---------------------------------------------------------------------------
+inline void core_util_critical_section_enter() {}
+inline void core_util_critical_section_exit() {}
+inline bool core_util_atomic_load_bool(const volatile bool* p) { return *p; }
+inline void core_util_atomic_store_bool(volatile bool* p, bool v) { *p = v; }
+inline uint8_t core_util_atomic_load_u8(const volatile uint8_t* p) { return *p; }
+inline void core_util_atomic_store_u8(volatile uint8_t* p, uint8_t v) { *p = v; }
+inline uint8_t core_util_atomic_exchange_u8(volatile uint8_t* p, uint8_t v) { uint8_t o = *p; *p = v; return o; }
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t* p) { return *p; }
+inline void core_util_atomic_store_u32(volatile uint32_t* p, uint32_t v) { *p = v; }
+inline uint32_t core_util_atomic_fetch_add_u32(volatile uint32_t* p, uint32_t d) { uint32_t o = *p; *p = o + d; return o; }
+inline bool core_util_atomic_cas_u32(volatile uint32_t* p, uint32_t* e, uint32_t d) { if (*p == *e) { *p = d; return true; } *e = *p; return false; }
+
+// ---------------------------------------------------------------------------
+// RTOS
+// ---------------------------------------------------------------------------
+class Mutex {
+public:
+    void lock() {}
+    void unlock() {}
+    bool trylock() { return true; }
+};
+
+template <typename T>
+class ScopedLock {
+public:
+    explicit ScopedLock(T& m) : _m(m) { _m.lock(); }
+    ~ScopedLock() { _m.unlock(); }
+private:
+    T& _m;
+};
+
+// ---------------------------------------------------------------------------
+// Callback
+// ---------------------------------------------------------------------------
+namespace mbed {
+template <typename F>
+class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> {
+public:
+    Callback() = default;
+    Callback(std::nullptr_t) {}
+    template <typename F, typename = decltype(std::declval<F&>()(std::declval<Args>()...))>
+    Callback(F f) : _f(std::move(f)) {}
+    R operator()(Args... args) const {
+        if (_f) {
+            return _f(args...);
+        }
+        return R();
+    }
+    explicit operator bool() const { return static_cast<bool>(_f); }
+private:
+    std::function<R(Args...)> _f;
+};
+}  // namespace mbed
+
+using mbed::Callback;
+
+template <typename T, typename R, typename... Args>
+mbed::Callback<R(Args...)> callback(T* obj, R (T::*method)(Args...)) {
+    return mbed::Callback<R(Args...)>([obj, method](Args... args) { return (obj->*method)(args...); });
+}
+
+// ---------------------------------------------------------------------------
+// 仮想時間
+// ---------------------------------------------------------------------------
+class InterruptIn;
+
+namespace vhal {
+
+class Timeout;
+
+/**
+ * タイマ割り込みの遅延モデル（ネットワーク負荷等によるタイマ遅延の再現）
+ */
+struct TimerLatencyModel {
+    uint32_t base_us = 0;        // 常に加わる遅延
+    uint32_t tail_us = 0;        // 追加遅延の最大値
+    double tail_probability = 0; // 追加遅延が発生する確率
+    uint32_t seed = 1;
+};
+
+/**
+ * DigitalOutの書き込み記録
+ */
+struct PinWrite {
+    uint64_t t_us;
+    PinName pin;
+    int value;
+};
+
+// 現在の仮想時刻（マイクロ秒）
+uint64_t now_us();
+
+// 仮想時間をリセット（全Timeoutを解除し、書き込み記録を消去）
+void reset();
+
+// タイマ遅延モデルを設定
+void setTimerLatency(const TimerLatencyModel& model);
+
+// 次のTimeoutの期限を取得（なければfalse）
+bool nextTimeoutDue(uint64_t& due_us);
+
+// 指定時刻まで仮想時間を進め、期限に達したTimeoutを順に実行
+void runUntil(uint64_t t_us);
+
+// ピンの立ち上がりエッジ割り込みを発生（現在時刻で即座に実行）
+bool raiseRise(PinName pin);
+
+// 書き込み記録
+const std::vector<PinWrite>& pinWrites();
+void clearPinWrites();
+
+// 実行した割り込みの回数（Timeout / ピン）
+uint64_t timeoutIsrCount();
+uint64_t pinIsrCount();
+
+// 内部登録（HALクラスから使用）
+void registerTimeout(Timeout* t);
+void unregisterTimeout(Timeout* t);
+void registerInterruptIn(::InterruptIn* in);
+void unregisterInterruptIn(::InterruptIn* in);
+void recordWrite(PinName pin, int value);
+uint64_t armTimeout(uint64_t delay_us);
+
+}  // namespace vhal
+
+// ---------------------------------------------------------------------------
+// ドライバ
+// ---------------------------------------------------------------------------
+class DigitalOut {
+public:
+    explicit DigitalOut(PinName pin, int value = 0) : _pin(pin), _value(value) {}
+    void write(int value) {
+        _value = value ? 1 : 0;
+        vhal::recordWrite(_pin, _value);
+    }
+    int read() const { return _value; }
+    operator int() const { return _value; }
+private:
+    PinName _pin;
+    int _value;
+};
+
+class DigitalIn {
+public:
+    explicit DigitalIn(PinName pin) : _pin(pin) {}
+    int read() const { return 0; }
+    void mode(PinMode) {}
+private:
+    PinName _pin;
+};
+
+class InterruptIn {
+public:
+    explicit InterruptIn(PinName pin) : _pin(pin) { vhal::registerInterruptIn(this); }
+    ~InterruptIn() { vhal::unregisterInterruptIn(this); }
+    void rise(mbed::Callback<void()> cb) { _rise = cb; }
+    void fall(mbed::Callback<void()> cb) { _fall = cb; }
+    void mode(PinMode) {}
+    PinName pin() const { return _pin; }
+    void fireRise() const { _rise(); }
+private:
+    PinName _pin;
+    mbed::Callback<void()> _rise;
+    mbed::Callback<void()> _fall;
+};
+
+class Timer {
+public:
+    void start() {
+        if (!_running) {
+            _start_us = vhal::now_us() - _accum_us;
+            _running = true;
+        }
+    }
+    void stop() {
+        if (_running) {
+            _accum_us = vhal::now_us() - _start_us;
+            _running = false;
+        }
+    }
+    void reset() {
+        _accum_us = 0;
+        _start_us = vhal::now_us();
+    }
+    std::chrono::microseconds elapsed_time() const {
+        return std::chrono::microseconds(_running ? vhal::now_us() - _start_us : _accum_us);
+    }
+private:
+    bool _running = false;
+    uint64_t _start_us = 0;
+    uint64_t _accum_us = 0;
+};
+
+namespace vhal {
+class Timeout {
+public:
+    Timeout() { registerTimeout(this); }
+    ~Timeout() { unregisterTimeout(this); }
+    void attach(mbed::Callback<void()> cb, std::chrono::microseconds t) {
+        _cb = cb;
+        _due_us = armTimeout((uint64_t)(t.count() < 0 ? 0 : t.count()));
+        _order = ++_order_counter;
+        _armed = true;
+    }
+    void detach() { _armed = false; }
+
+    // スケジューラ用
+    bool armed() const { return _armed; }
+    uint64_t due() const { return _due_us; }
+    uint64_t order() const { return _order; }
+    void fire() {
+        // コールバック内で同じTimeoutを再attachしても安全なようにコピーして実行
+        mbed::Callback<void()> cb = _cb;
+        _armed = false;
+        cb();
+    }
+private:
+    mbed::Callback<void()> _cb;
+    uint64_t _due_us = 0;
+    uint64_t _order = 0;
+    bool _armed = false;
+    static inline uint64_t _order_counter = 0;
+};
+}  // namespace vhal
+
+using vhal::Timeout;
+
+#endif // SSR_SIM_MBED_H
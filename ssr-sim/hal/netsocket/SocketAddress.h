@@ -0,0 +1,18 @@
+#ifndef SSR_SIM_SOCKET_ADDRESS_H
+#define SSR_SIM_SOCKET_ADDRESS_H
+
+/**
+ * SocketAddress（ホストシミュレータ用）
+ * CommandQueueが送信元として保持するだけのため、ポート番号のみを持つ。
+ */
+class SocketAddress {
+public:
+    SocketAddress() : _port(0) {}
+    explicit SocketAddress(uint16_t port) : _port(port) {}
+    uint16_t get_port() const { return _port; }
+
+private:
+    uint16_t _port;
+};
+
+#endif // SSR_SIM_SOCKET_ADDRESS_H
@@ -0,0 +1,661 @@
+/**
+ * SSRDriver host simulator
+ * SSRDriver.cppを仮想時間HAL上でビルドし、仮想商用電源で駆動して
+ * 点弧精度・割り込み回数・半周期ごとの出力を評価する。
+ */
+
+#include "mbed.h"
+#include "SSRDriver.h"
+#include "MainsGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+const PinName kSSRPins[4] = {P4_0, P2_13, P5_7, P5_6};
+const uint64_t kWarmupUs = 500000;  // 周波数推定が安定するまで評価しない
+
+/**
+ * 判定基準
+ */
+struct Limits {
+    double max_abs_error_us = 0;    // 点弧誤差の最大値
+    double p99_abs_error_us = 0;    // 点弧誤差の99パーセンタイル
+    double max_missed_ratio = 0;    // 点弧欠落率
+    double max_extra_ratio = 0;     // 多重点弧率
+};
+
+/**
+ * シナリオ中の操作
+ */
+struct Action {
+    uint64_t t_us;
+    std::function<void(SSRDriver&)> run;
+};
+
+/**
+ * シナリオ定義
+ */
+struct Scenario {
+    std::string name;
+    std::string description;
+    MainsConfig mains;
+    vhal::TimerLatencyModel latency;
+    double duration_s = 10.0;
+    std::vector<Action> actions;
+    // 半周期開始時刻における期待デューティ比（-1: 評価しない）
+    std::function<int(int ch, uint64_t t_us)> expected_duty;
+    // 追加の判定（失敗時はメッセージを返す）
+    std::function<std::string(SSRDriver&, const std::vector<HalfCycle>&)> extra_check;
+    Limits limits;
+    bool benchmark = false;
+};
+
+/**
+ * チャンネルごとの評価結果
+ */
+struct ChannelResult {
+    uint32_t scored = 0;
+    uint32_t missed = 0;
+    uint32_t extra = 0;
+    uint32_t level_errors = 0;   // 0%/100%時の出力レベル不一致
+    std::vector<double> errors;  // 点弧誤差（us）
+};
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    size_t idx = (size_t)std::min<double>(v.size() - 1, std::floor(p * (v.size() - 1) + 0.5));
+    return v[idx];
+}
+
+// SSRDriver::zeroxControlHandlerと同じ換算（0〜100% → 半周期の20〜85%）
+uint32_t expectedOnDelay(uint32_t half_cycle_us, int duty) {
+    double ratio = (20.0 + duty * 0.65) / 100.0;
+    return (uint32_t)(half_cycle_us * (1.0 - ratio) + 0.5);
+}
+
+int channelOf(PinName pin) {
+    for (int i = 0; i < 4; i++) {
+        if (kSSRPins[i] == pin) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * ピン書き込み記録から立ち上がり時刻とレベル変化を抽出
+ */
+struct ChannelTimeline {
+    std::vector<uint64_t> rises;
+    std::vector<std::pair<uint64_t, int>> levels;  // レベル変化（時刻, 値）
+
+    int levelAt(uint64_t t) const {
+        int level = 0;
+        for (auto it = std::upper_bound(levels.begin(), levels.end(), std::make_pair(t, 2));
+             it != levels.begin();) {
+            --it;
+            level = it->second;
+            break;
+        }
+        return level;
+    }
+};
+
+void buildTimelines(ChannelTimeline (&tl)[4]) {
+    int last[4] = {0, 0, 0, 0};
+    for (const vhal::PinWrite& w : vhal::pinWrites()) {
+        int ch = channelOf(w.pin);
+        if (ch < 0 || w.value == last[ch]) {
+            continue;
+        }
+        if (w.value) {
+            tl[ch].rises.push_back(w.t_us);
+        }
+        tl[ch].levels.push_back({w.t_us, w.value});
+        last[ch] = w.value;
+    }
+}
+
+struct RunOptions {
+    FILE* timeline = nullptr;   // 半周期ごとの出力タイムライン（CSV）
+};
+
+bool runScenario(const Scenario& sc, const RunOptions& opt) {
+    vhal::setTimerLatency(sc.latency);
+    vhal::reset();
+
+    const uint64_t duration_us = (uint64_t)(sc.duration_s * 1000000.0);
+    std::vector<MainsEdge> edges;
+    std::vector<HalfCycle> half_cycles;
+    uint32_t dropped = 0;
+    MainsGenerator(sc.mains).generate(duration_us, edges, half_cycles, dropped);
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    SSRDriver* driver = new SSRDriver();
+    uint32_t noise = 0;
+    size_t next_action = 0;
+    std::vector<Action> actions = sc.actions;
+    std::stable_sort(actions.begin(), actions.end(),
+                     [](const Action& a, const Action& b) { return a.t_us < b.t_us; });
+
+    // エッジと操作を時刻順に投入
+    size_t e = 0;
+    while (e < edges.size() || next_action < actions.size()) {
+        bool take_action = next_action < actions.size() &&
+                           (e >= edges.size() || actions[next_action].t_us <= edges[e].t_us);
+        if (take_action) {
+            vhal::runUntil(actions[next_action].t_us);
+            actions[next_action].run(*driver);
+            next_action++;
+        } else {
+            vhal::runUntil(edges[e].t_us);
+            vhal::raiseRise(P3_9);
+            noise += edges[e].noise ? 1 : 0;
+            e++;
+        }
+    }
+    vhal::runUntil(duration_us);
+
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    // 評価
+    ChannelTimeline tl[4];
+    buildTimelines(tl);
+    ChannelResult result[4];
+
+    FILE* timeline = opt.timeline;
+
+    for (size_t h = 0; h < half_cycles.size(); h++) {
+        const HalfCycle& hc = half_cycles[h];
+        if (hc.start_us < kWarmupUs || hc.start_us + hc.length_us > duration_us) {
+            continue;
+        }
+        for (int ch = 0; ch < 4; ch++) {
+            int duty = sc.expected_duty ? sc.expected_duty(ch, hc.start_us) : -1;
+            if (duty < 0) {
+                continue;
+            }
+            ChannelResult& r = result[ch];
+
+            if (duty == 0 || duty == 100) {
+                // 全OFF/全ON: 半周期中央のレベルを確認
+                int level = tl[ch].levelAt(hc.start_us + hc.length_us / 2);
+                r.scored++;
+                if (level != (duty == 100 ? 1 : 0)) {
+                    r.level_errors++;
+                }
+                continue;
+            }
+
+            auto lo = std::lower_bound(tl[ch].rises.begin(), tl[ch].rises.end(), hc.start_us);
+            auto hi = std::lower_bound(tl[ch].rises.begin(), tl[ch].rises.end(), hc.start_us + hc.length_us);
+            size_t fires = hi - lo;
+            uint64_t expected = hc.start_us + expectedOnDelay(hc.length_us, duty);
+            double err = 0;
+
+            r.scored++;
+            if (fires == 0) {
+                r.missed++;
+            } else {
+                err = (double)((int64_t)*lo - (int64_t)expected);
+                r.errors.push_back(err);
+                if (fires > 1) {
+                    r.extra++;
+                }
+            }
+
+            if (timeline) {
+                fprintf(timeline, "%s,%zu,%llu,%u,%d,%d,%llu,", sc.name.c_str(), h,
+                        (unsigned long long)hc.start_us, hc.length_us, ch + 1, duty,
+                        (unsigned long long)expected);
+                if (fires) {
+                    fprintf(timeline, "%llu,%.0f,%zu\n", (unsigned long long)*lo, err, fires);
+                } else {
+                    fprintf(timeline, ",,0\n");
+                }
+            }
+        }
+    }
+    // レポート
+    bool pass = true;
+    printf("=== %s: %s\n", sc.name.c_str(), sc.description.c_str());
+    printf("  simulated %.1f s in %.3f s wall (%.0fx realtime)\n",
+           sc.duration_s, wall_s, wall_s > 0 ? sc.duration_s / wall_s : 0.0);
+    printf("  mains: %zu edges (%u noise, %u dropped), %zu half-cycles\n",
+           edges.size(), noise, dropped, half_cycles.size());
+    printf("  isr: pin=%llu timeout=%llu |",
+           (unsigned long long)vhal::pinIsrCount(), (unsigned long long)vhal::timeoutIsrCount());
+    for (uint8_t i = 0; i < ISR_PROF_COUNT; i++) {
+        IsrProfileStats stats;
+        driver->getIsrStats(i, stats);
+        printf(" %s=%lu", IsrProfiler::getName(i), (unsigned long)stats.count);
+    }
+    printf("\n");
+
+    for (int ch = 0; ch < 4; ch++) {
+        const ChannelResult& r = result[ch];
+        if (r.scored == 0) {
+            continue;
+        }
+        std::vector<double> abs_err;
+        double sum = 0;
+        for (double v : r.errors) {
+            abs_err.push_back(std::fabs(v));
+            sum += v;
+        }
+        double mean = r.errors.empty() ? 0 : sum / r.errors.size();
+        double p99 = percentile(abs_err, 0.99);
+        double max = abs_err.empty() ? 0 : *std::max_element(abs_err.begin(), abs_err.end());
+        double missed_ratio = (double)r.missed / r.scored;
+        double extra_ratio = (double)r.extra / r.scored;
+
+        SSRJitterStats jitter;
+        driver->getFireJitter(ch + 1, jitter);
+        printf("  ssr%d: scored=%u missed=%u extra=%u level_err=%u err_mean=%.1fus p50=%.0fus p99=%.0fus max=%.0fus"
+               " | driver jitter n=%lu max=%ldus\n",
+               ch + 1, r.scored, r.missed, r.extra, r.level_errors, mean,
+               percentile(abs_err, 0.5), p99, max,
+               (unsigned long)jitter.count, (long)jitter.max_us);
+
+        if (sc.benchmark) {
+            continue;
+        }
+        if (max > sc.limits.max_abs_error_us || p99 > sc.limits.p99_abs_error_us ||
+            missed_ratio > sc.limits.max_missed_ratio || extra_ratio > sc.limits.max_extra_ratio ||
+            r.level_errors > 0) {
+            printf("  FAIL ssr%d: limits max=%.0fus p99=%.0fus missed<=%.3f extra<=%.3f\n",
+                   ch + 1, sc.limits.max_abs_error_us, sc.limits.p99_abs_error_us,
+                   sc.limits.max_missed_ratio, sc.limits.max_extra_ratio);
+            pass = false;
+        }
+    }
+
+    if (sc.extra_check) {
+        std::string msg = sc.extra_check(*driver, half_cycles);
+        if (!msg.empty()) {
+            printf("  FAIL %s\n", msg.c_str());
+            pass = false;
+        }
+    }
+
+    printf("  %s\n", pass ? "PASS" : "FAIL");
+    delete driver;
+    return pass;
+}
+
+Action setDuty(double t_s, uint8_t id, uint8_t level) {
+    return {(uint64_t)(t_s * 1000000.0), [id, level](SSRDriver& d) { d.setDutyLevel(id, level); }};
+}
+
+std::vector<Action> setDutyAll(double t_s, const uint8_t (&duty)[4]) {
+    std::vector<Action> v;
+    for (int i = 0; i < 4; i++) {
+        v.push_back(setDuty(t_s, i + 1, duty[i]));
+    }
+    return v;
+}
+
+std::function<int(int, uint64_t)> constantDuty(const uint8_t (&duty)[4]) {
+    std::vector<int> d(duty, duty + 4);
+    return [d](int ch, uint64_t) { return d[ch]; };
+}
+
+std::vector<Scenario> buildScenarios() {
+    std::vector<Scenario> list;
+    static const uint8_t kPhase[4] = {10, 40, 70, 95};
+
+    {
+        Scenario sc;
+        sc.name = "nominal60";
+        sc.description = "60Hz ideal mains, phase control 10/40/70/95%";
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {20, 20, 0, 0};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "nominal50";
+        sc.description = "50Hz ideal mains, phase control 10/40/70/95%";
+        sc.mains.frequency_hz = 50.0;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {20, 20, 0, 0};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "drift";
+        sc.description = "59Hz -> 61Hz linear drift over 10s";
+        sc.mains.frequency_hz = 59.0;
+        sc.mains.drift_hz_per_s = 0.2;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {30, 20, 0, 0};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "jitter";
+        sc.description = "60Hz with 50us (1 sigma) zero-cross detector jitter";
+        sc.mains.jitter_us = 50.0;
+        sc.mains.seed = 7;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {450, 300, 0, 0};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "noise";
+        sc.description = "60Hz with 2 spurious detector edges per second";
+        sc.mains.noise_edges_per_s = 2.0;
+        sc.mains.seed = 11;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {9000, 9000, 0.10, 0.10};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "dropout";
+        sc.description = "60Hz with 5% missing detector edges";
+        sc.mains.dropout_probability = 0.05;
+        sc.mains.seed = 13;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {20, 20, 0.10, 0};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "timer_load";
+        sc.description = "60Hz, timer latency 5us + up to 300us on 5% of timeouts";
+        sc.latency.base_us = 5;
+        sc.latency.tail_us = 300;
+        sc.latency.tail_probability = 0.05;
+        sc.latency.seed = 17;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.limits = {650, 350, 0, 0};
+        list.push_back(sc);
+    }
+    {
+        static const uint8_t kOnOff[4] = {0, 100, 0, 100};
+        Scenario sc;
+        sc.name = "onoff";
+        sc.description = "Full OFF / full ON channels hold their level";
+        sc.actions = setDutyAll(0.0, kOnOff);
+        sc.expected_duty = constantDuty(kOnOff);
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "setall";
+        sc.description = "setAllDutyLevels switches all channels on the same half-cycle";
+        sc.duration_s = 4.0;
+        static const uint8_t kFrom[4] = {20, 20, 20, 20};
+        sc.actions = setDutyAll(0.0, kFrom);
+        const uint64_t t_switch = 2004321;
+        sc.actions.push_back({t_switch, [](SSRDriver& d) {
+            const uint8_t to[4] = {80, 60, 40, 30};
+            d.setAllDutyLevels(0x0F, to);
+        }});
+        sc.expected_duty = [t_switch](int ch, uint64_t t) {
+            static const int to[4] = {80, 60, 40, 30};
+            if (t + 20000 > t_switch && t < t_switch + 20000) {
+                return -1;  // 切り替え前後は個別判定
+            }
+            return t < t_switch ? 20 : to[ch];
+        };
+        sc.extra_check = [t_switch](SSRDriver&, const std::vector<HalfCycle>& hcs) -> std::string {
+            ChannelTimeline tl[4];
+            buildTimelines(tl);
+            static const int to[4] = {80, 60, 40, 30};
+            long first_new[4] = {-1, -1, -1, -1};
+            for (size_t h = 0; h < hcs.size(); h++) {
+                if (hcs[h].start_us + 20000 < t_switch) {
+                    continue;
+                }
+                for (int ch = 0; ch < 4; ch++) {
+                    if (first_new[ch] >= 0) {
+                        continue;
+                    }
+                    auto lo = std::lower_bound(tl[ch].rises.begin(), tl[ch].rises.end(), hcs[h].start_us);
+                    if (lo == tl[ch].rises.end() || *lo >= hcs[h].start_us + hcs[h].length_us) {
+                        continue;
+                    }
+                    int64_t expected = hcs[h].start_us + expectedOnDelay(hcs[h].length_us, to[ch]);
+                    if (std::llabs((int64_t)*lo - expected) < 50) {
+                        first_new[ch] = (long)h;
+                    }
+                }
+            }
+            for (int ch = 1; ch < 4; ch++) {
+                if (first_new[ch] != first_new[0]) {
+                    char msg[128];
+                    snprintf(msg, sizeof(msg), "channels switched on different half-cycles (%ld %ld %ld %ld)",
+                             first_new[0], first_new[1], first_new[2], first_new[3]);
+                    return msg;
+                }
+            }
+            return first_new[0] < 0 ? "new duty never applied" : "";
+        };
+        sc.limits = {20, 20, 0, 0};
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "ramp";
+        sc.description = "startRamp 0 -> 100% over 2s reaches the target monotonically";
+        sc.duration_s = 4.0;
+        sc.actions.push_back({1000000, [](SSRDriver& d) { d.startRamp(1, 100, 2000, SSR_RAMP_S_CURVE); }});
+        sc.extra_check = [](SSRDriver& d, const std::vector<HalfCycle>& hcs) -> std::string {
+            ChannelTimeline tl[4];
+            buildTimelines(tl);
+            // 点弧位置（半周期内のオフセット）は単調非増加
+            int64_t prev = -1;
+            for (const HalfCycle& hc : hcs) {
+                auto lo = std::lower_bound(tl[0].rises.begin(), tl[0].rises.end(), hc.start_us);
+                if (lo == tl[0].rises.end() || *lo >= hc.start_us + hc.length_us) {
+                    continue;
+                }
+                int64_t offset = (int64_t)(*lo - hc.start_us);
+                if (prev >= 0 && offset > prev + 20) {
+                    return "ramp firing position is not monotonic";
+                }
+                prev = offset;
+            }
+            if (d.getDutyLevel(1) != 100 || d.isRampActive(1)) {
+                return "ramp did not finish at 100%";
+            }
+            return "";
+        };
+        list.push_back(sc);
+    }
+    {
+        // 通知回数はランプの段数（値が変わった半周期）以下で、変化のない半周期では通知しない
+        static uint32_t notify_count[4];
+        Scenario sc;
+        sc.name = "notify";
+        sc.description = "Duty-change callback fires only when a level actually changes";
+        sc.duration_s = 3.0;
+        sc.actions.push_back({0, [](SSRDriver& d) {
+            memset(notify_count, 0, sizeof(notify_count));
+            d.setDutyChangeCallback([](uint8_t mask) {
+                for (int ch = 0; ch < 4; ch++) {
+                    if (mask & (1 << ch)) {
+                        notify_count[ch]++;
+                    }
+                }
+            });
+        }});
+        sc.actions.push_back({500000, [](SSRDriver& d) { d.setDutyLevel(2, 40); }});
+        sc.actions.push_back({1000000, [](SSRDriver& d) { d.startRamp(1, 50, 1000, SSR_RAMP_LINEAR); }});
+        sc.extra_check = [](SSRDriver& d, const std::vector<HalfCycle>&) -> std::string {
+            d.setDutyChangeCallback(nullptr);
+            char msg[128];
+            if (notify_count[1] != 1 || notify_count[2] != 0 || notify_count[3] != 0) {
+                snprintf(msg, sizeof(msg), "unexpected notifications (%u %u %u)",
+                         notify_count[1], notify_count[2], notify_count[3]);
+                return msg;
+            }
+            if (notify_count[0] == 0 || notify_count[0] > 50) {
+                snprintf(msg, sizeof(msg), "ramp notified %u times (expected 1-50)", notify_count[0]);
+                return msg;
+            }
+            return "";
+        };
+        list.push_back(sc);
+    }
+    {
+        // 半周期番号から予測した開始時刻が実際の半周期の開始と一致し、番号が半周期ごとに1つ進む
+        struct Sample {
+            uint64_t t_us;
+            uint32_t index;
+            uint32_t elapsed_us;
+            uint32_t half_us;
+            bool valid;
+        };
+        static Sample samples[2];
+        Scenario sc;
+        sc.name = "halfcycle";
+        sc.description = "Half-cycle index and timing predict future half-cycle starts";
+        sc.duration_s = 4.0;
+        for (int i = 0; i < 2; i++) {
+            sc.actions.push_back({1000000 + 1500000 * (uint64_t)i, [i](SSRDriver& d) {
+                Sample& smp = samples[i];
+                smp.t_us = vhal::now_us();
+                smp.valid = d.getHalfCycleTiming(smp.index, smp.elapsed_us, smp.half_us);
+            }});
+        }
+        sc.extra_check = [](SSRDriver&, const std::vector<HalfCycle>& hcs) -> std::string {
+            const uint32_t ahead = 60;
+            char msg[128];
+            for (const Sample& smp : samples) {
+                if (!smp.valid) {
+                    return "half-cycle timing not available";
+                }
+                // 予測: 現在の半周期の開始 + ahead半周期
+                uint64_t predicted = smp.t_us - smp.elapsed_us + (uint64_t)ahead * smp.half_us;
+                auto cur = std::upper_bound(hcs.begin(), hcs.end(), smp.t_us,
+                                            [](uint64_t t, const HalfCycle& hc) { return t < hc.start_us; });
+                if (cur == hcs.begin() || hcs.end() - cur < (long)ahead) {
+                    return "not enough half-cycles recorded";
+                }
+                int64_t error = (int64_t)predicted - (int64_t)(cur - 1 + ahead)->start_us;
+                if (std::llabs(error) > 500) {
+                    snprintf(msg, sizeof(msg), "predicted half-cycle start off by %lld us", (long long)error);
+                    return msg;
+                }
+            }
+            // 2回のサンプル間で番号が実際の半周期数だけ進んでいる
+            long actual = 0;
+            for (const HalfCycle& hc : hcs) {
+                if (hc.start_us > samples[0].t_us - samples[0].elapsed_us &&
+                    hc.start_us <= samples[1].t_us - samples[1].elapsed_us) {
+                    actual++;
+                }
+            }
+            if ((long)(samples[1].index - samples[0].index) != actual) {
+                snprintf(msg, sizeof(msg), "index advanced %ld, expected %ld",
+                         (long)(samples[1].index - samples[0].index), actual);
+                return msg;
+            }
+            return "";
+        };
+        list.push_back(sc);
+    }
+    {
+        Scenario sc;
+        sc.name = "bench";
+        sc.description = "10 minutes of 60Hz phase control on all channels (throughput)";
+        sc.duration_s = 600.0;
+        sc.actions = setDutyAll(0.0, kPhase);
+        sc.expected_duty = constantDuty(kPhase);
+        sc.benchmark = true;
+        list.push_back(sc);
+    }
+    return list;
+}
+
+void usage(const char* argv0) {
+    printf("Usage: %s [--list] [--scenario <name>] [--timeline <csv>] [--seed <n>]\n", argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* only = nullptr;
+    const char* timeline_path = nullptr;
+    RunOptions opt;
+    long seed = -1;
+
+    std::vector<Scenario> scenarios = buildScenarios();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            for (const Scenario& sc : scenarios) {
+                printf("%-12s %s\n", sc.name.c_str(), sc.description.c_str());
+            }
+            return 0;
+        } else if (arg == "--scenario" && i + 1 < argc) {
+            only = argv[++i];
+        } else if (arg == "--timeline" && i + 1 < argc) {
+            timeline_path = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtol(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (timeline_path) {
+        opt.timeline = fopen(timeline_path, "w");
+        if (opt.timeline == nullptr) {
+            printf("cannot open %s\n", timeline_path);
+            return 2;
+        }
+        fprintf(opt.timeline, "scenario,half_cycle,start_us,length_us,channel,duty,expected_us,actual_us,error_us,fires\n");
+    }
+
+    int failed = 0;
+    int run = 0;
+    for (Scenario& sc : scenarios) {
+        if (only ? sc.name != only : sc.benchmark) {
+            continue;  // ベンチマークは明示指定時のみ
+        }
+        if (seed >= 0) {
+            sc.mains.seed = (uint32_t)seed;
+            sc.latency.seed = (uint32_t)seed;
+        }
+        run++;
+        if (!runScenario(sc, opt)) {
+            failed++;
+        }
+    }
+
+    if (opt.timeline) {
+        fclose(opt.timeline);
+    }
+
+    if (run == 0) {
+        printf("unknown scenario: %s\n", only ? only : "");
+        return 2;
+    }
+    printf("%d/%d scenarios passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}
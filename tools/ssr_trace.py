@@ -0,0 +1,170 @@
+"""SSR edge trace dump tool.
+
+Fetches the SSR output edge trace (firmware built with SSR_TRACE_ENABLED=1)
+over UDP and renders it as an ASCII timing diagram or a VCD file
+(viewable in GTKWave / PulseView).
+
+Usage:
+    python ssr_trace.py <device-ip> [--port 5555] [--keep-running]
+                        [--width 120] [--span-us 20000] [--vcd out.vcd]
+"""
+
+import argparse
+import socket
+import struct
+import sys
+from typing import List, Tuple
+
+TRACE_ZEROX = 0xFF
+TRACE_HALF_CYCLE = 0xFE
+HEADER = struct.Struct("<2sBBIIH")
+RECORD = struct.Struct("<IBB")
+
+Record = Tuple[int, int, int]  # (t_us, channel, level)
+
+
+def command(sock: socket.socket, addr: Tuple[str, int], text: str) -> bytes:
+    sock.sendto(text.encode("ascii"), addr)
+    data, _ = sock.recvfrom(2048)
+    return data
+
+
+def fetch_trace(sock: socket.socket, addr: Tuple[str, int]) -> List[Record]:
+    records: List[Record] = []
+    seq = 0
+    while True:
+        data = command(sock, addr, f"trace dump {seq}")
+        if len(data) < HEADER.size or data[:2] != b"TR":
+            raise RuntimeError(f"unexpected response: {data[:64]!r}")
+        _, version, _flags, head, first, count = HEADER.unpack_from(data)
+        if version != 1:
+            raise RuntimeError(f"unsupported trace version {version}")
+        if first > seq and seq != 0:
+            print(f"warning: {first - seq} records overwritten while dumping", file=sys.stderr)
+        offset = HEADER.size
+        for _ in range(count):
+            records.append(RECORD.unpack_from(data, offset))
+            offset += RECORD.size
+        seq = first + count
+        if count == 0 or seq >= head:
+            return records
+
+
+def unwrap(records: List[Record]) -> List[Record]:
+    """Unwrap 32-bit microsecond timestamps and rebase to the first record."""
+    out: List[Record] = []
+    base = None
+    offset = 0
+    prev = None
+    for t, ch, level in records:
+        if prev is not None and t < prev and prev - t > 0x80000000:
+            offset += 1 << 32
+        prev = t
+        t += offset
+        if base is None:
+            base = t
+        out.append((t - base, ch, level))
+    return out
+
+
+def channel_name(ch: int) -> str:
+    if ch == TRACE_ZEROX:
+        return "ZEROX"
+    if ch == TRACE_HALF_CYCLE:
+        return "HALF"
+    return f"SSR{ch + 1}"
+
+
+def render_ascii(records: List[Record], width: int, span_us: int) -> str:
+    if not records:
+        return "(no records)"
+    start = records[0][0]
+    end = min(records[-1][0], start + span_us) if span_us > 0 else records[-1][0]
+    scale = max(1, (end - start + width - 1) // width)
+
+    rows = {}
+    for name in ["ZEROX", "HALF", "SSR1", "SSR2", "SSR3", "SSR4"]:
+        rows[name] = [" "] * width
+    levels = {f"SSR{i + 1}": 0 for i in range(4)}
+    cursor = {name: 0 for name in rows}
+
+    for t, ch, level in records:
+        if t > end:
+            break
+        col = min(width - 1, (t - start) // scale)
+        name = channel_name(ch)
+        if name in ("ZEROX", "HALF"):
+            rows[name][col] = "|"
+            continue
+        row = rows[name]
+        for c in range(cursor[name], col):
+            row[c] = "~" if levels[name] else "_"
+        row[col] = "/" if level else "\\"
+        levels[name] = level
+        cursor[name] = col + 1
+
+    for name in ("SSR1", "SSR2", "SSR3", "SSR4"):
+        for c in range(cursor[name], width):
+            rows[name][c] = "~" if levels[name] else "_"
+
+    lines = [f"t0={start}us  1 column = {scale}us"]
+    for name, row in rows.items():
+        lines.append(f"{name:>5} {''.join(row)}")
+    return "\n".join(lines)
+
+
+def write_vcd(records: List[Record], path: str) -> None:
+    ids = {TRACE_ZEROX: "z", TRACE_HALF_CYCLE: "h", 0: "a", 1: "b", 2: "c", 3: "d"}
+    with open(path, "w", encoding="ascii") as f:
+        f.write("$timescale 1us $end\n$scope module ssr $end\n")
+        for ch, ident in ids.items():
+            f.write(f"$var wire 1 {ident} {channel_name(ch)} $end\n")
+        f.write("$upscope $end\n$enddefinitions $end\n#0\n")
+        for ident in ids.values():
+            f.write(f"0{ident}\n")
+        for t, ch, level in records:
+            ident = ids.get(ch)
+            if ident is None:
+                continue
+            f.write(f"#{t}\n")
+            if ch in (TRACE_ZEROX, TRACE_HALF_CYCLE):
+                # パルスとして表示
+                f.write(f"1{ident}\n#{t + 1}\n0{ident}\n")
+            else:
+                f.write(f"{1 if level else 0}{ident}\n")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Dump and render the SSR edge trace")
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=5555)
+    parser.add_argument("--keep-running", action="store_true",
+                        help="do not stop recording while dumping")
+    parser.add_argument("--width", type=int, default=120)
+    parser.add_argument("--span-us", type=int, default=20000,
+                        help="time span of the ASCII diagram (0 = whole trace)")
+    parser.add_argument("--vcd", help="write a VCD file")
+    args = parser.parse_args()
+
+    addr = (args.host, args.port)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(2.0)
+
+    if not args.keep_running:
+        command(sock, addr, "trace stop")
+    try:
+        records = unwrap(fetch_trace(sock, addr))
+    finally:
+        if not args.keep_running:
+            command(sock, addr, "trace start")
+
+    print(f"{len(records)} records")
+    print(render_ascii(records, args.width, args.span_us))
+    if args.vcd:
+        write_vcd(records, args.vcd)
+        print(f"VCD written to {args.vcd}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,77 @@
+"""Host time master for HACC2 device time synchronization.
+
+Answers `time ping <t1>` requests with `time pong <t1>,<t2>,<t3>` where t2/t3
+are the host receive/send times in microseconds since the Unix epoch, so
+every unit that runs `time master <host-ip>[,<port>]` follows the host clock.
+With --units, the status of each unit is printed periodically.
+
+Usage:
+    python time_master.py [--port 5555] [--units 192.168.0.10 192.168.0.11 ...]
+                          [--unit-port 5555] [--interval 10]
+"""
+
+import argparse
+import select
+import socket
+import time
+from typing import List, Tuple
+
+
+def now_us() -> int:
+    return time.time_ns() // 1000
+
+
+def answer_ping(sock: socket.socket, data: bytes, addr: Tuple[str, int], t2: int) -> bool:
+    if not data.startswith(b"time ping "):
+        return False
+    t1 = data[10:].strip().decode("ascii", "replace")
+    sock.sendto(f"time pong {t1},{t2},{now_us()}".encode("ascii"), addr)
+    return True
+
+
+def print_status(sock: socket.socket, units: List[Tuple[str, int]]) -> None:
+    for addr in units:
+        sock.sendto(b"time status", addr)
+    deadline = time.monotonic() + 0.5
+    pending = set(units)
+    while pending and time.monotonic() < deadline:
+        ready, _, _ = select.select([sock], [], [], max(0.0, deadline - time.monotonic()))
+        if not ready:
+            break
+        data, addr = sock.recvfrom(2048)
+        if answer_ping(sock, data, addr, now_us()):
+            continue
+        if addr in pending and data.startswith(b"time status,"):
+            pending.discard(addr)
+            print(f"{addr[0]}: {data.decode('ascii', 'replace')}")
+    for addr in pending:
+        print(f"{addr[0]}: no response")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=5555, help="port to answer pings on")
+    parser.add_argument("--units", nargs="*", default=[], help="unit IPs to print the sync status of")
+    parser.add_argument("--unit-port", type=int, default=5555)
+    parser.add_argument("--interval", type=float, default=10.0, help="status print interval (s)")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.port))
+    units = [(ip, args.unit_port) for ip in args.units]
+    next_status = time.monotonic() + args.interval
+    print(f"time master listening on port {args.port}")
+
+    while True:
+        timeout = max(0.0, next_status - time.monotonic()) if units else None
+        ready, _, _ = select.select([sock], [], [], timeout)
+        if ready:
+            data, addr = sock.recvfrom(2048)
+            answer_ping(sock, data, addr, now_us())
+        if units and time.monotonic() >= next_status:
+            print_status(sock, units)
+            next_status = time.monotonic() + args.interval
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,132 @@
+"""UDP command throughput benchmark for HACC2 reply modes.
+
+Streams the same command burst to one unit with each reply mode and prints
+the send rate, the number of commands the unit actually processed (from
+`reply status`) and the number of replies that came back.
+
+Modes:
+    sync     reply all, wait for each reply before sending the next command
+    all      reply all, send without waiting (replies drained concurrently)
+    errors   reply errors
+    none     reply none
+    ack:<n>  reply ack <n>
+    bang     per-packet "!" prefix (no session mode)
+
+Usage:
+    python udp_bench.py 192.168.0.10 [--port 5555] [--count 2000] [--rate 0]
+                        [--command "set 1,{v}"] [--seq]
+                        [--modes sync,all,errors,none,ack:30,bang]
+"""
+
+import argparse
+import select
+import socket
+import time
+from typing import Optional, Tuple
+
+
+def request(sock: socket.socket, addr: Tuple[str, int], command: str, prefix: str, timeout: float = 1.0) -> Optional[str]:
+    """Send a command and wait for the reply starting with prefix (other replies are discarded)."""
+    sock.sendto(command.encode("ascii"), addr)
+    deadline = time.monotonic() + timeout
+    while True:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            return None
+        ready, _, _ = select.select([sock], [], [], remaining)
+        if not ready:
+            return None
+        data, _ = sock.recvfrom(2048)
+        text = data.decode("ascii", "replace")
+        if text.startswith(prefix):
+            return text
+
+
+def drain(sock: socket.socket, wait: float = 0.0) -> int:
+    count = 0
+    deadline = time.monotonic() + wait
+    while True:
+        ready, _, _ = select.select([sock], [], [], max(0.0, deadline - time.monotonic()))
+        if not ready:
+            return count
+        sock.recvfrom(2048)
+        count += 1
+
+
+def reply_stats(sock: socket.socket, addr: Tuple[str, int]) -> Tuple[int, int]:
+    """Return (commands, suppressed) counters of the unit."""
+    text = request(sock, addr, "reply status", "reply status,")
+    if text is None:
+        raise RuntimeError("no response to reply status")
+    fields = text.split(",")
+    return int(fields[3]), int(fields[5])
+
+
+def run_mode(sock: socket.socket, addr: Tuple[str, int], mode: str, args: argparse.Namespace) -> None:
+    drain(sock, 0.2)
+    start_commands, start_suppressed = reply_stats(sock, addr)
+    controls = 1  # the final reply status
+    if mode in ("errors", "none") or mode.startswith("ack:"):
+        session = "ack " + mode[4:] if mode.startswith("ack:") else mode
+        if request(sock, addr, "reply " + session, "reply status,") is None:
+            raise RuntimeError("no response to reply " + session)
+        controls += 2  # reply <mode> and reply all
+
+    interval = 1.0 / args.rate if args.rate > 0 else 0.0
+    replies = 0
+    timeouts = 0
+    begin = time.monotonic()
+    next_send = begin
+    for i in range(args.count):
+        command = args.command.format(i=i, v=i % 101)
+        if args.seq:
+            command = f"#{i} {command}"  # #0 restarts the stream on the unit for each mode
+        if mode == "bang":
+            command = "!" + command
+        if mode == "sync":
+            if request(sock, addr, command, "", timeout=0.5) is None:
+                timeouts += 1
+            else:
+                replies += 1
+            continue
+        if interval:
+            delay = next_send - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            next_send += interval
+        sock.sendto(command.encode("ascii"), addr)
+        replies += drain(sock)
+    elapsed = time.monotonic() - begin
+    replies += drain(sock, 0.3)
+
+    if controls > 1:
+        request(sock, addr, "reply all", "reply status,")
+    end_commands, end_suppressed = reply_stats(sock, addr)
+    processed = end_commands - start_commands - controls
+    suppressed = end_suppressed - start_suppressed
+    lost = args.count - processed
+    print(f"{mode:>8} {args.count:>7} {elapsed:>8.3f} {args.count / elapsed:>10.1f} "
+          f"{processed:>9} {lost:>6} {replies:>8} {suppressed:>10}" + (f"  ({timeouts} timeouts)" if timeouts else ""))
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("unit", help="unit IP address")
+    parser.add_argument("--port", type=int, default=5555)
+    parser.add_argument("--count", type=int, default=2000, help="commands per mode")
+    parser.add_argument("--rate", type=float, default=0.0, help="commands per second (0 = as fast as possible)")
+    parser.add_argument("--command", default="set 1,{v}", help="command template ({i}: index, {v}: 0-100)")
+    parser.add_argument("--seq", action="store_true", help="prefix commands with #<seq>")
+    parser.add_argument("--modes", default="sync,all,errors,none,ack:30,bang")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", 0))
+    addr = (args.unit, args.port)
+    print(f"{'mode':>8} {'sent':>7} {'time_s':>8} {'cmd/s':>10} {'processed':>9} {'lost':>6} {'replies':>8} {'suppressed':>10}")
+    for mode in args.modes.split(","):
+        run_mode(sock, addr, mode.strip(), args)
+
+
+if __name__ == "__main__":
+    main()